@@ -9,10 +9,11 @@
 
 #include "channelflow/diffops.h"
 #include "channelflow/flowfield.h"
-#include "modules/ddc/macros.h"
-#ifdef FREESLIP
+#include "modules/ddc/ddcflags.h"
 namespace chflow {
-void freeslipBC(std::vector<FlowField>& fields) {
+// imposes free-slip velocity and constant active scalars at the walls (used if flags.freeslip is set)
+inline void freeslipBC(std::vector<FlowField>& fields, const DDCFlags& flags) {
+    const DDCCoefficients coeff = flags.coefficients();
     FlowField u = fields[0];
     
     if (u.Nd() != 3) {
@@ -21,14 +22,12 @@ void freeslipBC(std::vector<FlowField>& fields) {
     }
     
     u.makePhysical();
-    #ifdef P5
     FlowField temp = fields[1];
-    temp.makePhysical();
-    #endif
-    #ifdef P6
+    if (coeff.temperature)
+        temp.makePhysical();
     FlowField salt = fields[2];
-    salt.makePhysical();
-    #endif
+    if (coeff.salinity)
+        salt.makePhysical();
 
     lint Nz = u.Nz();
     lint nxlocmin = u.nxlocmin();
@@ -43,12 +42,10 @@ void freeslipBC(std::vector<FlowField>& fields) {
                 u(nx, nylocmin, nz, 0) = u(nx, nylocmin+1, nz, 0); // du/dy=0
                 u(nx, nylocmin, nz, 1) = 0; // No-penetration
                 u(nx, nylocmin, nz, 2) = u(nx, nylocmin+1, nz, 2); // dw/dy=0
-                #ifdef P5
-                temp(nx, nylocmin, nz, 0) = 0; // constant temperature
-                #endif
-                #ifdef P6
-                salt(nx, nylocmin, nz, 0) = 0; // constant salinity
-                #endif
+                if (coeff.temperature)
+                    temp(nx, nylocmin, nz, 0) = 0; // constant temperature
+                if (coeff.salinity)
+                    salt(nx, nylocmin, nz, 0) = 0; // constant salinity
             }
         }
     }
@@ -60,27 +57,24 @@ void freeslipBC(std::vector<FlowField>& fields) {
                 u(nx, nylocmax, nz, 0) = u(nx, nylocmax-1, nz, 0); // du/dy=0
                 u(nx, nylocmax, nz, 1) = 0; // No-penetration
                 u(nx, nylocmax, nz, 2) = u(nx, nylocmax-1, nz, 2); // dw/dy=0
-                #ifdef P5
-                temp(nx, nylocmax, nz, 0) = 0; // constant temperature
-                #endif
-                #ifdef P6
-                salt(nx, nylocmax, nz, 0) = 0; // constant salinity
-                #endif
+                if (coeff.temperature)
+                    temp(nx, nylocmax, nz, 0) = 0; // constant temperature
+                if (coeff.salinity)
+                    salt(nx, nylocmax, nz, 0) = 0; // constant salinity
             }
         }
     }
 
     u.makeSpectral();
     fields[0] = u; // update velocity
-    #ifdef P5
-    temp.makeSpectral();
-    fields[1] = temp; // update velocity
-    #endif
-    #ifdef P6
-    salt.makeSpectral();
-    fields[2] = salt; // update velocity
-    #endif
+    if (coeff.temperature) {
+        temp.makeSpectral();
+        fields[1] = temp; // update velocity
+    }
+    if (coeff.salinity) {
+        salt.makeSpectral();
+        fields[2] = salt; // update velocity
+    }
 }
 }  // namespace chflow
-#endif
 #endif
\ No newline at end of file
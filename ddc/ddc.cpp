@@ -7,341 +7,213 @@
 
 namespace chflow {
 
-int field2vector_size(const FlowField& u, const FlowField& temp, const FlowField& salt) {
-    int Kx = u.kxmaxDealiased();
-    int Kz = u.kzmaxDealiased();
-    int Ny = u.Ny();
-    // FIXME: Determine array size
-    // The original formula was
-    //     int N = 4* ( Kx+2*Kx*Kz+Kz ) * ( Ny-3 ) +2* ( Ny-2 );
-    // but I've not been able to twist my head enough to adapt it do distributed FlowFields.
-    // Since it doesn't take that much time, we now perform the loops twice, once empty to
-    // determine cfarray sizes and once with the actual data copying. // Tobias
+// number of entries of the scalar s in the vector of the local process
+static int scalar2vector_size(const FlowField& s, int Kx, int Kz) {
+    int Ny = s.Ny();
     int N = 0;
-    if (u.taskid() == u.task_coeff(0, 0))
-        N += 2 * (Ny - 2);
-    for (int kx = 1; kx <= Kx; ++kx)
-        if (u.taskid() == u.task_coeff(u.mx(kx), 0))
-            N += 2 * (Ny - 2) + 2 * (Ny - 4);
-    for (int kz = 1; kz <= Kz; ++kz)
-        if (u.taskid() == u.task_coeff(0, u.mz(kz)))
-            N += 2 * (Ny - 2) + 2 * (Ny - 4);
-    for (int kx = -Kx; kx <= Kx; ++kx) {
-        if (kx == 0)
-            continue;
-        int mx = u.mx(kx);
-        for (int kz = 1; kz <= Kz; ++kz) {
-            int mz = u.mz(kz);
-            if (u.taskid() == u.task_coeff(mx, mz)) {
-                N += 2 * (Ny - 2) + 2 * (Ny - 4);
-            }
-        }
-    }
-
-    if (temp.taskid() == temp.task_coeff(0, 0))
+    if (s.taskid() == s.task_coeff(0, 0))
         N += Ny;
     for (int kx = 1; kx <= Kx; ++kx)
-        if (temp.taskid() == temp.task_coeff(temp.mx(kx), 0))
+        if (s.taskid() == s.task_coeff(s.mx(kx), 0))
             N += 2 * Ny;
     for (int kz = 1; kz <= Kz; ++kz)
-        if (temp.taskid() == temp.task_coeff(0, temp.mz(kz)))
+        if (s.taskid() == s.task_coeff(0, s.mz(kz)))
             N += 2 * Ny;
     for (int kx = -Kx; kx <= Kx; kx++) {
         if (kx == 0)
             continue;
         for (int kz = 1; kz <= Kz; kz++) {
-            if (temp.taskid() == temp.task_coeff(temp.mx(kx), temp.mz(kz))) {
+            if (s.taskid() == s.task_coeff(s.mx(kx), s.mz(kz))) {
                 N += 2 * Ny;
             }
         }
     }
-
-    if (salt.taskid() == salt.task_coeff(0, 0))
-        N += Ny;
-    for (int kx = 1; kx <= Kx; ++kx)
-        if (salt.taskid() == salt.task_coeff(salt.mx(kx), 0))
-            N += 2 * Ny;
-    for (int kz = 1; kz <= Kz; ++kz)
-        if (salt.taskid() == salt.task_coeff(0, salt.mz(kz)))
-            N += 2 * Ny;
-    for (int kx = -Kx; kx <= Kx; kx++) {
-        if (kx == 0)
-            continue;
-        for (int kz = 1; kz <= Kz; kz++) {
-            if (salt.taskid() == salt.task_coeff(salt.mx(kx), salt.mz(kz))) {
-                N += 2 * Ny;
-            }
-        }
-    }
-
     return N;
 }
 
-/** \brief Turn the three flowfields for velocity, temperature, and salinity into one Eigen vector
- * \param[in] u velocity field
- * \param[in] temp temperature field
- * \param[in] salt salinity field
- * \param[in] a vector for the linear algebra
- *
- * The vectorization of u is analog to the field2vector, temparture and salinity are piped entirely
- * into the vector (a single independent dimensions)
- */
-void field2vector(const FlowField& u, const FlowField& temp, const FlowField& salt, Eigen::VectorXd& a) {
-    Eigen::VectorXd b;
-    assert(temp.xzstate() == Spectral && temp.ystate() == Spectral);
-    assert(salt.xzstate() == Spectral && salt.ystate() == Spectral);
-    field2vector(u, b);
-    int Kx = temp.kxmaxDealiased();
-    int Kz = temp.kzmaxDealiased();
-    int Ny = temp.Ny();
-
-    int n = field2vector_size(u, temp, salt);  // b.size() +6*Kx*Kz*Ny;
-
-    if (a.size() < n)
-        a.resize(n, true);
-    setToZero(a);
-    int pos = b.size();
-    a.topRows(pos) = b;
-
-    // (0,:,0)
-    for (int ny = 0; ny < Ny; ++ny)
-        if (temp.taskid() == temp.task_coeff(0, 0))
-            a(pos++) = Re(temp.cmplx(0, ny, 0, 0));
-
-    for (int kx = 1; kx <= Kx; ++kx) {
-        int mx = temp.mx(kx);
-        if (temp.taskid() == temp.task_coeff(mx, 0)) {
-            for (int ny = 0; ny < Ny; ++ny) {
-                a(pos++) = Re(temp.cmplx(mx, ny, 0, 0));
-                a(pos++) = Im(temp.cmplx(mx, ny, 0, 0));
-            }
-        }
-    }
-    for (int kz = 1; kz <= Kz; ++kz) {
-        int mz = temp.mz(kz);
-        if (temp.taskid() == temp.task_coeff(0, mz)) {
-            for (int ny = 0; ny < Ny; ++ny) {
-                a(pos++) = Re(temp.cmplx(0, ny, mz, 0));
-                a(pos++) = Im(temp.cmplx(0, ny, mz, 0));
-            }
-        }
-    }
-    for (int kx = -Kx; kx <= Kx; kx++) {
-        if (kx == 0)
-            continue;
-        int mx = temp.mx(kx);
-        for (int kz = 1; kz <= Kz; kz++) {
-            int mz = temp.mz(kz);
-            if (u.taskid() == u.task_coeff(mx, mz)) {
-                for (int ny = 0; ny < Ny; ny++) {
-                    a(pos++) = Re(temp.cmplx(mx, ny, mz, 0));
-                    a(pos++) = Im(temp.cmplx(mx, ny, mz, 0));
-                }
-            }
-        }
-    }
-    // <<----- salt
+// copies the scalar s into a, starting at a(pos)
+static void scalar2vector(const FlowField& s, int Kx, int Kz, Eigen::VectorXd& a, int& pos) {
+    int Ny = s.Ny();
     // (0,:,0)
     for (int ny = 0; ny < Ny; ++ny)
-        if (salt.taskid() == salt.task_coeff(0, 0))
-            a(pos++) = Re(salt.cmplx(0, ny, 0, 0));
+        if (s.taskid() == s.task_coeff(0, 0))
+            a(pos++) = Re(s.cmplx(0, ny, 0, 0));
 
     for (int kx = 1; kx <= Kx; ++kx) {
-        int mx = salt.mx(kx);
-        if (salt.taskid() == salt.task_coeff(mx, 0)) {
+        int mx = s.mx(kx);
+        if (s.taskid() == s.task_coeff(mx, 0)) {
             for (int ny = 0; ny < Ny; ++ny) {
-                a(pos++) = Re(salt.cmplx(mx, ny, 0, 0));
-                a(pos++) = Im(salt.cmplx(mx, ny, 0, 0));
+                a(pos++) = Re(s.cmplx(mx, ny, 0, 0));
+                a(pos++) = Im(s.cmplx(mx, ny, 0, 0));
             }
         }
     }
     for (int kz = 1; kz <= Kz; ++kz) {
-        int mz = salt.mz(kz);
-        if (salt.taskid() == salt.task_coeff(0, mz)) {
+        int mz = s.mz(kz);
+        if (s.taskid() == s.task_coeff(0, mz)) {
             for (int ny = 0; ny < Ny; ++ny) {
-                a(pos++) = Re(salt.cmplx(0, ny, mz, 0));
-                a(pos++) = Im(salt.cmplx(0, ny, mz, 0));
+                a(pos++) = Re(s.cmplx(0, ny, mz, 0));
+                a(pos++) = Im(s.cmplx(0, ny, mz, 0));
             }
         }
     }
     for (int kx = -Kx; kx <= Kx; kx++) {
         if (kx == 0)
             continue;
-        int mx = salt.mx(kx);
+        int mx = s.mx(kx);
         for (int kz = 1; kz <= Kz; kz++) {
-            int mz = salt.mz(kz);
-            if (u.taskid() == u.task_coeff(mx, mz)) {
+            int mz = s.mz(kz);
+            if (s.taskid() == s.task_coeff(mx, mz)) {
                 for (int ny = 0; ny < Ny; ny++) {
-                    a(pos++) = Re(salt.cmplx(mx, ny, mz, 0));
-                    a(pos++) = Im(salt.cmplx(mx, ny, mz, 0));
+                    a(pos++) = Re(s.cmplx(mx, ny, mz, 0));
+                    a(pos++) = Im(s.cmplx(mx, ny, mz, 0));
                 }
             }
         }
     }
 }
 
-/** \brief Turn  one Eigen vector into the three flowfields for velocity, temperature, and salinity
- * \param[in] a vector for the linear algebra
- * \param[in] u velocity field
- * \param[in] temp temperature field
- * \param[in] salt salinity field
- *
- * The vectorization of u is analog to the field2vector, temperature and salinity are piped entirely
- * into the vector (a single independent dimension)
- */
-void vector2field(const Eigen::VectorXd& a, FlowField& u, FlowField& temp, FlowField& salt) {
-    assert(temp.xzstate() == Spectral && temp.ystate() == Spectral);
-    assert(salt.xzstate() == Spectral && salt.ystate() == Spectral);
-    temp.setToZero();
-    Eigen::VectorXd b;
-    int N = field2vector_size(u);
-    int Kx = temp.kxmaxDealiased();
-    int Kz = temp.kzmaxDealiased();
-    int Ny = temp.Ny();
-    b = a.topRows(N);
-    vector2field(b, u);
-
-    int pos = N;
+// copies a, starting at a(pos), into the scalar s
+static void vector2scalar(const Eigen::VectorXd& a, int Kx, int Kz, FlowField& s, int& pos) {
+    s.setToZero();
+    int Ny = s.Ny();
     double reval, imval;
-    Complex val;
 
-    if (temp.taskid() == temp.task_coeff(0, 0))
+    if (s.taskid() == s.task_coeff(0, 0))
         for (int ny = 0; ny < Ny; ++ny)
-            temp.cmplx(0, ny, 0, 0) = Complex(a(pos++), 0);
+            s.cmplx(0, ny, 0, 0) = Complex(a(pos++), 0);
 
     for (int kx = 1; kx <= Kx; ++kx) {
-        int mx = temp.mx(kx);
-        if (temp.taskid() == temp.task_coeff(mx, 0)) {
+        int mx = s.mx(kx);
+        if (s.taskid() == s.task_coeff(mx, 0)) {
             for (int ny = 0; ny < Ny; ++ny) {
                 reval = a(pos++);
                 imval = a(pos++);
-                temp.cmplx(mx, ny, 0, 0) = Complex(reval, imval);
+                s.cmplx(mx, ny, 0, 0) = Complex(reval, imval);
             }
         }
 
         // ------------------------------------------------------
         // Now copy conjugates of u(kx,ny,0,i) to u(-kx,ny,0,i). These are
         // redundant modes stored only for the convenience of FFTW.
-        int mxm = temp.mx(-kx);
-        int send_id = temp.task_coeff(mx, 0);
-        int rec_id = temp.task_coeff(mxm, 0);
+        int mxm = s.mx(-kx);
+        int send_id = s.task_coeff(mx, 0);
+        int rec_id = s.task_coeff(mxm, 0);
         for (int ny = 0; ny < Ny; ++ny) {
-            if (temp.taskid() == send_id && send_id == rec_id) {  // all is on the same process -> just copy
-                temp.cmplx(mxm, ny, 0, 0) = conj(temp.cmplx(mx, ny, 0, 0));
+            if (s.taskid() == send_id && send_id == rec_id) {  // all is on the same process -> just copy
+                s.cmplx(mxm, ny, 0, 0) = conj(s.cmplx(mx, ny, 0, 0));
             }
 #ifdef HAVE_MPI     // send_id != rec_id requires multiple processes
             else {  // Transfer the conjugates via MPI
-                if (temp.taskid() == send_id) {
-                    Complex tmp0 = conj(temp.cmplx(mx, ny, 0, 0));
+                if (s.taskid() == send_id) {
+                    Complex tmp0 = conj(s.cmplx(mx, ny, 0, 0));
                     MPI_Send(&tmp0, 1, MPI_DOUBLE_COMPLEX, rec_id, 0, MPI_COMM_WORLD);
                 }
-                if (u.taskid() == rec_id) {
+                if (s.taskid() == rec_id) {
                     Complex tmp0;
                     MPI_Status status;
                     MPI_Recv(&tmp0, 1, MPI_DOUBLE_COMPLEX, send_id, 0, MPI_COMM_WORLD, &status);
-                    temp.cmplx(mxm, ny, 0, 0) = tmp0;
+                    s.cmplx(mxm, ny, 0, 0) = tmp0;
                 }
             }
 #endif
         }
     }
     for (int kz = 1; kz <= Kz; ++kz) {
-        int mz = temp.mz(kz);
-        if (temp.taskid() == temp.task_coeff(0, mz)) {
+        int mz = s.mz(kz);
+        if (s.taskid() == s.task_coeff(0, mz)) {
             for (int ny = 0; ny < Ny; ++ny) {
                 reval = a(pos++);
                 imval = a(pos++);
-                temp.cmplx(0, ny, mz, 0) = Complex(reval, imval);
+                s.cmplx(0, ny, mz, 0) = Complex(reval, imval);
             }
         }
     }
     for (int kx = -Kx; kx <= Kx; kx++) {
         if (kx == 0)
             continue;
-        int mx = temp.mx(kx);
+        int mx = s.mx(kx);
         for (int kz = 1; kz <= Kz; kz++) {
-            int mz = temp.mz(kz);
-            if (u.taskid() == u.task_coeff(mx, mz)) {
+            int mz = s.mz(kz);
+            if (s.taskid() == s.task_coeff(mx, mz)) {
                 for (int ny = 0; ny < Ny; ny++) {
                     reval = a(pos++);
                     imval = a(pos++);
-                    val = Complex(reval, imval);
-                    temp.cmplx(mx, ny, mz, 0) = val;
+                    s.cmplx(mx, ny, mz, 0) = Complex(reval, imval);
                 }
             }
         }
     }
-    temp.setPadded(true);
+    s.setPadded(true);
+}
+
+int field2vector_size(const FlowField& u, const FlowField& temp, const FlowField& salt) {
+    int Kx = u.kxmaxDealiased();
+    int Kz = u.kzmaxDealiased();
+    // FIXME: Determine array size
+    // The original formula was
+    //     int N = 4* ( Kx+2*Kx*Kz+Kz ) * ( Ny-3 ) +2* ( Ny-2 );
+    // but I've not been able to twist my head enough to adapt it do distributed FlowFields.
+    // Since it doesn't take that much time, we now perform the loops twice, once empty to
+    // determine cfarray sizes and once with the actual data copying. // Tobias
+    int N = field2vector_size(u);
+    if (activeScalar(temp))
+        N += scalar2vector_size(temp, Kx, Kz);
+    if (activeScalar(salt))
+        N += scalar2vector_size(salt, Kx, Kz);
+    return N;
+}
 
+/** \brief Turn the three flowfields for velocity, temperature, and salinity into one Eigen vector
+ * The vectorization of u is analog to the field2vector, temparture and salinity are piped entirely
+ * into the vector (a single independent dimensions). Inactive (empty) scalars take no entries.
+ */
+void field2vector(const FlowField& u, const FlowField& temp, const FlowField& salt, Eigen::VectorXd& a) {
+    Eigen::VectorXd b;
+    assert(!activeScalar(temp) || (temp.xzstate() == Spectral && temp.ystate() == Spectral));
+    assert(!activeScalar(salt) || (salt.xzstate() == Spectral && salt.ystate() == Spectral));
+    field2vector(u, b);
+    int Kx = u.kxmaxDealiased();
+    int Kz = u.kzmaxDealiased();
 
-    // <<----- missing salt
-    if (salt.taskid() == salt.task_coeff(0, 0))
-        for (int ny = 0; ny < Ny; ++ny)
-            salt.cmplx(0, ny, 0, 0) = Complex(a(pos++), 0);
+    int n = field2vector_size(u, temp, salt);  // b.size() +6*Kx*Kz*Ny;
 
-    for (int kx = 1; kx <= Kx; ++kx) {
-        int mx = salt.mx(kx);
-        if (salt.taskid() == salt.task_coeff(mx, 0)) {
-            for (int ny = 0; ny < Ny; ++ny) {
-                reval = a(pos++);
-                imval = a(pos++);
-                salt.cmplx(mx, ny, 0, 0) = Complex(reval, imval);
-            }
-        }
+    if (a.size() < n)
+        a.resize(n, true);
+    setToZero(a);
+    int pos = b.size();
+    a.topRows(pos) = b;
 
-        // ------------------------------------------------------
-        // Now copy conjugates of u(kx,ny,0,i) to u(-kx,ny,0,i). These are
-        // redundant modes stored only for the convenience of FFTW.
-        int mxm = salt.mx(-kx);
-        int send_id = salt.task_coeff(mx, 0);
-        int rec_id = salt.task_coeff(mxm, 0);
-        for (int ny = 0; ny < Ny; ++ny) {
-            if (salt.taskid() == send_id && send_id == rec_id) {  // all is on the same process -> just copy
-                salt.cmplx(mxm, ny, 0, 0) = conj(salt.cmplx(mx, ny, 0, 0));
-            }
-#ifdef HAVE_MPI     // send_id != rec_id requires multiple processes
-            else {  // Transfer the conjugates via MPI
-                if (salt.taskid() == send_id) {
-                    Complex tmp0 = conj(salt.cmplx(mx, ny, 0, 0));
-                    MPI_Send(&tmp0, 1, MPI_DOUBLE_COMPLEX, rec_id, 0, MPI_COMM_WORLD);
-                }
-                if (u.taskid() == rec_id) {
-                    Complex tmp0;
-                    MPI_Status status;
-                    MPI_Recv(&tmp0, 1, MPI_DOUBLE_COMPLEX, send_id, 0, MPI_COMM_WORLD, &status);
-                    salt.cmplx(mxm, ny, 0, 0) = tmp0;
-                }
-            }
-#endif
-        }
-    }
-    for (int kz = 1; kz <= Kz; ++kz) {
-        int mz = salt.mz(kz);
-        if (salt.taskid() == salt.task_coeff(0, mz)) {
-            for (int ny = 0; ny < Ny; ++ny) {
-                reval = a(pos++);
-                imval = a(pos++);
-                salt.cmplx(0, ny, mz, 0) = Complex(reval, imval);
-            }
-        }
-    }
-    for (int kx = -Kx; kx <= Kx; kx++) {
-        if (kx == 0)
-            continue;
-        int mx = salt.mx(kx);
-        for (int kz = 1; kz <= Kz; kz++) {
-            int mz = salt.mz(kz);
-            if (u.taskid() == u.task_coeff(mx, mz)) {
-                for (int ny = 0; ny < Ny; ny++) {
-                    reval = a(pos++);
-                    imval = a(pos++);
-                    val = Complex(reval, imval);
-                    salt.cmplx(mx, ny, mz, 0) = val;
-                }
-            }
-        }
-    }
-    salt.setPadded(true);
+    if (activeScalar(temp))
+        scalar2vector(temp, Kx, Kz, a, pos);
+    if (activeScalar(salt))
+        scalar2vector(salt, Kx, Kz, a, pos);
+}
+
+/** \brief Turn  one Eigen vector into the three flowfields for velocity, temperature, and salinity
+ * \param[in] a vector for the linear algebra
+ * \param[in] u velocity field
+ * \param[in] temp temperature field
+ * \param[in] salt salinity field
+ *
+ * The vectorization of u is analog to the field2vector, temperature and salinity are piped entirely
+ * into the vector (a single independent dimension). Inactive (empty) scalars are left untouched.
+ */
+void vector2field(const Eigen::VectorXd& a, FlowField& u, FlowField& temp, FlowField& salt) {
+    assert(!activeScalar(temp) || (temp.xzstate() == Spectral && temp.ystate() == Spectral));
+    assert(!activeScalar(salt) || (salt.xzstate() == Spectral && salt.ystate() == Spectral));
+    Eigen::VectorXd b;
+    int N = field2vector_size(u);
+    int Kx = u.kxmaxDealiased();
+    int Kz = u.kzmaxDealiased();
+    b = a.topRows(N);
+    vector2field(b, u);
+
+    int pos = N;
+    if (activeScalar(temp))
+        vector2scalar(a, Kx, Kz, temp, pos);
+    if (activeScalar(salt))
+        vector2scalar(a, Kx, Kz, salt, pos);
 }
 
 // DDC::DDC()
@@ -353,7 +225,12 @@ void vector2field(const Eigen::VectorXd& a, FlowField& u, FlowField& temp, FlowF
 DDC::DDC(const std::vector<FlowField>& fields, const DDCFlags& flags)
     :  // base class constructor with no arguments is called automatically (see DNS::DNS())
       main_dde_(0),
-      init_dde_(0) {
+      init_dde_(0),
+      ddcflags_(flags),
+      dtadapt_(flags.dt),
+      errprev_(1),
+      naccepted_(0),
+      nrejected_(0) {
     main_dde_ = newDDE(fields, flags);
     // creates DNSAlgo with ptr of "nse"-daughter type "dde"
     main_algorithm_ = newAlgorithm(fields, main_dde_, flags);
@@ -376,28 +253,109 @@ DDC::DDC(const std::vector<FlowField>& fields, const DDCFlags& flags)
 
 DDC::~DDC() {}
 
-// DDCAlgo* DDC::newAlgorithm(const vector<FlowField>& fields, const shared_ptr<DDE>& dde, const DDCFlags& flags) {
-//     DDCAlgo* alg = 0;
-//     switch (flags.timestepping) {
-//         case CNFE1:
-//         case SBDF1:
-//         case SBDF2:
-//         case SBDF3:
-//         case SBDF4:
-//             alg = new MultistepDNS(fields, dde, flags);
-//             break;
-//         case CNRK2:
-//             alg = new RungeKuttaDNS(fields, dde, flags);
-//             break;
-//         case SMRK2:
-//         case CNAB2:
-//             alg = new CNABstyleDNS(fields, dde, flags);
-//             break;
-//         default:
-//             cerr << "DDC::newAlgorithm : algorithm " << flags.timestepping << " is unimplemented" << endl;
-//     }
-//     return alg;
-// }
+std::shared_ptr<DNSAlgorithm> DDC::newAlgorithm(const vector<FlowField>& fields, const shared_ptr<DDE>& dde,
+                                                const DDCFlags& flags) {
+    std::shared_ptr<DNSAlgorithm> alg;
+    if (flags.imex != NoIMEX && flags.multirate > 1)
+        cferror("DDC::newAlgorithm : the IMEX and the multirate schemes exclude each other");
+    if (flags.imex != NoIMEX)
+        return std::make_shared<IMEXRungeKuttaDDC>(fields, dde, flags);
+    if (flags.multirate > 1)
+        return std::make_shared<MultirateDDC>(fields, dde, flags);
+    switch (flags.timestepping) {
+        case CNFE1:
+        case SBDF1:
+        case SBDF2:
+        case SBDF3:
+        case SBDF4:
+            alg = std::make_shared<DDCAlgo>(fields, dde, flags);
+            break;
+        case CNRK2:
+            alg = std::make_shared<RungeKuttaDNS>(fields, dde, flags);
+            break;
+        case SMRK2:
+        case CNAB2:
+            alg = std::make_shared<CNABstyleDNS>(fields, dde, flags);
+            break;
+        default:
+            cerr << "DDC::newAlgorithm : algorithm " << flags.timestepping << " is unimplemented" << endl;
+    }
+    return alg;
+}
+
+bool DDC::imposesFreeslip() const {
+    return dynamic_cast<const DDCAlgo*>(main_algorithm_.get()) != nullptr ||
+           dynamic_cast<const IMEXRungeKuttaDDC*>(main_algorithm_.get()) != nullptr ||
+           dynamic_cast<const MultirateDDC*>(main_algorithm_.get()) != nullptr;
+}
+
+Real DDC::errorEstimate() const {
+    const IMEXRungeKuttaDDC* imex = dynamic_cast<const IMEXRungeKuttaDDC*>(main_algorithm_.get());
+    return imex ? imex->error() : -1;
+}
+
+void DDC::advanceAdaptive(vector<FlowField>& fields, Real T, std::ostream* steplog) {
+    IMEXRungeKuttaDDC* imex = dynamic_cast<IMEXRungeKuttaDDC*>(main_algorithm_.get());
+    if (!imex || ddcflags_.errortol <= 0)
+        cferror("DDC::advanceAdaptive : needs an IMEX scheme (flags.imex) and flags.errortol > 0");
+
+    // PI controller, k = order of the embedded solution + 1 (Hairer & Wanner, Solving ODEs II, IV.2)
+    const Real k = imex->order();
+    const Real kI = 0.7 / k;
+    const Real kP = 0.4 / k;
+    const Real safety = 0.9;
+    const bool log = steplog && fields[0].taskid() == 0;
+
+    // ladder T*2^(-j) capped by dtmax: every step starts at a multiple of its dt, so the steps end exactly at T
+    const Real dtmax = std::min(ddcflags_.dtmax, T);
+    auto ladder = [T](Real dt) { return T * pow(2.0, -ceil(log2(T / dt) - 1e-9)); };
+
+    Real t = 0;
+    dtadapt_ = ladder(std::min(dtadapt_, dtmax));
+    while (t < T * (1 - 1e-12)) {
+        // a step that follows smaller ones is halved until it is aligned with t
+        Real dt = dtadapt_;
+        while (std::abs(t / dt - round(t / dt)) > 1e-9)
+            dt /= 2;
+        const bool aligned = dt == dtadapt_;
+        if (dt != main_algorithm_->dt())
+            reset_dt(dt);
+
+        advance(fields, 1);
+        const Real err = imex->error() / ddcflags_.errortol;
+        if (!std::isfinite(err))
+            cferror("DDC::advanceAdaptive : the error estimate is " + r2s(err) + " at t == " + r2s(time()) +
+                    ", the fields blew up");
+        const bool accept = err <= 1;
+        if (log)
+            *steplog << time() << ' ' << dt << ' ' << err << ' ' << accept << '\n';
+
+        Real dtnew;
+        if (accept) {
+            ++naccepted_;
+            t += dt;
+            Real fac = safety * pow(std::max(err, 1e-10), -kI) * pow(errprev_, kP);
+            fac = std::min(2.0, std::max(0.2, fac));
+            errprev_ = std::max(err, 1e-4);
+            // a step shortened for alignment does not tell how far dt can grow
+            dtnew = aligned ? dt * fac : std::max(dtadapt_, dt * fac);
+            const Real cfl = CFL(fields[0]);
+            if (cfl > 0)
+                dtnew = std::min(dtnew, dt * ddcflags_.CFLmax / cfl);
+        } else {
+            ++nrejected_;
+            imex->rejectStep(fields);
+            dtnew = dt * std::max(0.2, safety * pow(err, -1 / k));
+        }
+        dtadapt_ = ladder(std::min(dtnew, dtmax));
+        if (dtadapt_ < ddcflags_.dtmin)
+            cferror("DDC::advanceAdaptive : dt < dtmin == " + r2s(ddcflags_.dtmin) + " at t == " + r2s(time()));
+    }
+}
+
+Real DDC::adaptiveDt() const { return dtadapt_; }
+int DDC::acceptedSteps() const { return naccepted_; }
+int DDC::rejectedSteps() const { return nrejected_; }
 
 // void DDC::advance(vector<FlowField>& fields, int Nsteps) {
 //     assert(main_algorithm_);
@@ -11,7 +11,6 @@
 #include "channelflow/dns.h"
 #include "channelflow/dnsalgo.h"
 #include "channelflow/flowfield.h"
-#include "modules/ddc/macros.h"
 #include "modules/ddc/ddcflags.h"
 #include "modules/ddc/dde.h"
 #include "modules/ddc/ddcdsi.h"
@@ -19,6 +18,13 @@
 using namespace std;
 namespace chflow {
 
+/** \brief true unless s is the empty FlowField standing for a scalar that is not integrated
+ *
+ * Scalars that are inactive in the selected DDCSystem (see DDCCoefficients) are carried as empty FlowFields
+ * through the Newton-Krylov and I/O paths, so they cost neither memory nor entries in the Krylov vectors.
+ */
+inline bool activeScalar(const FlowField& s) { return s.Nd() > 0; }
+
 int field2vector_size(const FlowField& u, const FlowField& temp, const FlowField& salt);
 
 /** \brief Turn the three flowfields for velocity and temperature into one Eigen vector
@@ -28,7 +34,7 @@ int field2vector_size(const FlowField& u, const FlowField& temp, const FlowField
  * \param[in] x vector for the linear algebra
  *
  * The vectorization of u is analog to the field2vector, temparture and salinity are piped entirely
- * into the vector (a single independent dimensions)
+ * into the vector (a single independent dimensions), inactive scalars are skipped
  */
 void field2vector(const FlowField& u, const FlowField& temp, const FlowField& salt, Eigen::VectorXd& x);
 
@@ -39,7 +45,7 @@ void field2vector(const FlowField& u, const FlowField& temp, const FlowField& sa
  * \param[in] salt salinity field
  *
  * The vectorization of u is analog to the field2vector, temperature and salinity are piped entirely
- * into the vector (a single independent dimension)
+ * into the vector (a single independent dimension), inactive scalars are left empty
  */
 void vector2field(const Eigen::VectorXd& x, FlowField& u, FlowField& temp, FlowField& salt);
 
@@ -74,19 +80,44 @@ class DDC : public DNS {
     const ChebyCoeff& Tbase() const;
     const ChebyCoeff& Sbase() const;
 
+    // true if the time-stepping algorithm imposes flags.freeslip itself (DDCAlgo, IMEXRungeKuttaDDC)
+    bool imposesFreeslip() const;
+
+    // embedded error estimate of the last step (see IMEXRungeKuttaDDC::error), -1 for schemes without one
+    Real errorEstimate() const;
+
+    // advances the fields by the time interval T with error-controlled steps of the IMEX scheme (flags.errortol > 0).
+    // Steps with errorEstimate() > errortol are rejected and repeated with a smaller dt, the next dt follows a PI
+    // controller on errorEstimate()/errortol and is bounded by flags.dtmax and flags.CFLmax. dt is rounded down to
+    // the ladder T*2^(-j) and each step starts at a multiple of its dt, so that the steps end exactly at T and the
+    // solver cache serves all of them. A non-finite error estimate or dt < flags.dtmin raise an error. Each step is
+    // written to steplog as "t dt err/errortol accepted".
+    void advanceAdaptive(std::vector<FlowField>& fields, Real T, std::ostream* steplog = 0);
+
+    // step size of advanceAdaptive and its accepted and rejected steps since construction
+    Real adaptiveDt() const;
+    int acceptedSteps() const;
+    int rejectedSteps() const;
+
    protected:
     std::shared_ptr<DDE> main_dde_;
     std::shared_ptr<DDE> init_dde_;
 
-   //  DDCAlgo* main_algorithm_;
-   //  DDCAlgo* init_algorithm_;
+    // state of advanceAdaptive
+    DDCFlags ddcflags_;
+    Real dtadapt_;                          // next step size
+    Real errprev_;                          // err/errortol of the last accepted step
+    int naccepted_;
+    int nrejected_;
 
     std::shared_ptr<DDE> newDDE(const std::vector<FlowField>& fields, const DDCFlags& flags);
     std::shared_ptr<DDE> newDDE(const std::vector<FlowField>& fields, const std::vector<ChebyCoeff>& base,
                                 const DDCFlags& flags);
-   
-   // DDCAlgo* newAlgorithm(const std::vector<FlowField>& fields, const std::shared_ptr<DDE>& dde,
-   //                             const DDCFlags& flags);
+
+    // IMEX schemes (flags.imex) are integrated by IMEXRungeKuttaDDC, multirate steps (flags.multirate > 1) by
+    // MultirateDDC, multistep schemes by DDCAlgo, the others by the DNSAlgorithms of channelflow
+    std::shared_ptr<DNSAlgorithm> newAlgorithm(const std::vector<FlowField>& fields, const std::shared_ptr<DDE>& dde,
+                                               const DDCFlags& flags);
 };
 
 
@@ -4,17 +4,31 @@
  */
 
 #include "modules/ddc/ddcalgo.h"
+#include "modules/ddc/boundaryCondition.h"
 
 namespace chflow {
-    
+
+DDCAlgo::DDCAlgo(const vector<FlowField>& fields, const shared_ptr<NSE>& nse, const DDCFlags& flags)
+    : MultistepDNS(fields, nse, flags), ddcflags_(flags), rhs_(nse->createRHS(fields)) {}
+
+DDCAlgo* DDCAlgo::clone(const shared_ptr<NSE>& nse) const {
+    DDCAlgo* alg = new DDCAlgo(*this);
+    alg->nse_ = nse;
+    return alg;
+}
+
 void DDCAlgo::advance(vector<FlowField>& fieldsn, int Nsteps) {
     // This calculation follows Peyret section 4.5.1(b) pg 131.
     const int J = order_ - 1;
-    vector<FlowField> rhs(nse_->createRHS(fieldsn));  // Number of fields and number of RHS's can be different
-    int len = rhs.size();
-    fields_[0] = fieldsn;
-    // Start of time stepping loop
+    const int len = rhs_.size();  // Number of fields and number of RHS's can be different
+    const bool freeslip = ddcflags_.freeslip;
+
+    // Move the caller's fields onto the top of the stack. They are swapped back after the last step,
+    // so fields_[0] holds the stale input between calls and is overwritten here.
+    for (int l = 0; l < numfields_; ++l)
+        swap(fields_[0][l], fieldsn[l]);
 
+    // Start of time stepping loop
     for (int step = 0; step < Nsteps; ++step) {
         // Calculate nonlinearity, includes dealiasing if applicable
         if (order_ > 0) {
@@ -23,15 +37,15 @@ void DDCAlgo::advance(vector<FlowField>& fieldsn, int Nsteps) {
 
         // Add up multistepping terms of linear and nonlinear terms
         for (int l = 0; l < len; ++l) {
-            rhs[l].setToZero();  // RHS must be zero before sum over multistep loop
+            rhs_[l].setToZero();  // RHS must be zero before sum over multistep loop
             for (int j = 0; j < order_; ++j) {
                 const Real a = -alpha_[j] / flags_.dt;
                 const Real b = -beta_[j];
-                rhs[l].add(a, fields_[j][l], b, nonlf_[j][l]);
+                rhs_[l].add(a, fields_[j][l], b, nonlf_[j][l]);
             }
         }
         // Solve the implicit problem
-        nse_->solve(fields_[J], rhs);
+        nse_->solve(fields_[J], rhs_);
         // The solution is currently stored in fields_[J]. Shift entire fields and nonlf vectors
         // to move it into fields_[0]. Ie shift fields_[J] <- fields_[J-1] <- ... <- fields_[0] <- fields_[J]
         for (int j = order_ - 1; j > 0; --j) {
@@ -40,16 +54,11 @@ void DDCAlgo::advance(vector<FlowField>& fieldsn, int Nsteps) {
                 swap(fields_[j][l], fields_[j - 1][l]);
             }
         }
-        #ifdef FREESLIP
-        cout <<"Step "<<step<<"/"<<Nsteps<<endl;
-        // add boundary conditions
-        freeslipBC(fields_[0]);
-        #endif
+        if (freeslip)
+            freeslipBC(fields_[0], ddcflags_);
 
         t_ += flags_.dt;
 
-        // printStack();
-        //*flags_.logstream << "} Multistep::advance(...) step == " << step << " }" <<endl;
         if (nse_->taskid() == 0) {
             if (flags_.verbosity == PrintTime || flags_.verbosity == PrintAll)
                 *flags_.logstream << t_ << ' ' << flush;
@@ -58,7 +67,8 @@ void DDCAlgo::advance(vector<FlowField>& fieldsn, int Nsteps) {
         }
     }  // End of time stepping loop
 
-    fieldsn = fields_[0];  // update velocity
+    for (int l = 0; l < numfields_; ++l)
+        swap(fields_[0][l], fieldsn[l]);  // update velocity, temperature, salinity and pressure
 
     if (nse_->taskid() == 0)
         if (flags_.verbosity == PrintTime || flags_.verbosity == PrintAll || flags_.verbosity == PrintTicks)
@@ -66,4 +76,253 @@ void DDCAlgo::advance(vector<FlowField>& fieldsn, int Nsteps) {
     return;
 }
 
-}  // namespace chflow
\ No newline at end of file
+IMEXRungeKuttaDDC::IMEXRungeKuttaDDC(const vector<FlowField>& fields, const shared_ptr<NSE>& nse, const DDCFlags& flags)
+    : DNSAlgorithm(fields, nse, flags), ddcflags_(flags), error_(0) {
+    Ninitsteps_ = 0;
+    switch (flags.imex) {
+        case ARS443: {
+            // Ascher, Ruuth & Spiteri, Appl. Numer. Math. 25 (1997), section 2.8. The embedded second order
+            // weights use stages 2 and 4 (c = 1/2) and are L-stable, R(-inf) = 0.
+            order_ = 3;
+            stages_ = 5;
+            gamma_ = 0.5;
+            aE_ = {{},
+                   {1.0 / 2},
+                   {11.0 / 18, 1.0 / 18},
+                   {5.0 / 6, -5.0 / 6, 1.0 / 2},
+                   {1.0 / 4, 7.0 / 4, 3.0 / 4, -7.0 / 4}};
+            aI_ = {{}, {0}, {0, 1.0 / 6}, {0, -1.0 / 2, 1.0 / 2}, {0, 3.0 / 2, -3.0 / 2, 1.0 / 2}};
+            bhatE_ = {0, 5.0 / 2, 0, -3.0 / 2, 0};
+            bhatI_ = bhatE_;
+            break;
+        }
+        case ARS222: {
+            // Ascher, Ruuth & Spiteri, Appl. Numer. Math. 25 (1997), section 2.6. The embedded solution takes
+            // the implicit part of the scheme and the first order explicit weights of stage 2.
+            const Real g = 1 - 1 / sqrt(2.0);
+            const Real d = 1 - 1 / (2 * g);
+            order_ = 2;
+            stages_ = 3;
+            gamma_ = g;
+            aE_ = {{}, {g}, {d, 1 - d}};
+            aI_ = {{}, {0}, {0, 1 - g}};
+            bhatE_ = {0, 1, 0};
+            bhatI_ = {0, 1 - g, g};
+            break;
+        }
+        default:
+            cferror("IMEXRungeKuttaDDC: no IMEX scheme selected in flags.imex");
+    }
+
+    // inactive scalars are left untouched by DDE and skipped here
+    const DDCCoefficients coeff = flags.coefficients();
+    active_ = {true, coeff.temperature, coeff.salinity};
+
+    ustage_ = fields;
+    rhs_ = nse->createRHS(fields);
+    nonlf_.assign(stages_ - 1, rhs_);
+    linf_.assign(stages_, rhs_);
+    for (int i = 0; i < stages_; ++i)
+        for (uint l = 0; l < rhs_.size(); ++l) {
+            if (i < stages_ - 1)
+                nonlf_[i][l].setToZero();
+            linf_[i][l].setToZero();
+        }
+
+    nse_->reset_lambda({1.0 / (gamma_ * flags_.dt)});
+}
+
+IMEXRungeKuttaDDC* IMEXRungeKuttaDDC::clone(const shared_ptr<NSE>& nse) const {
+    IMEXRungeKuttaDDC* alg = new IMEXRungeKuttaDDC(*this);
+    alg->nse_ = nse;
+    return alg;
+}
+
+bool IMEXRungeKuttaDDC::full() const { return true; }
+
+Real IMEXRungeKuttaDDC::error() const { return error_; }
+
+void IMEXRungeKuttaDDC::rejectStep(vector<FlowField>& fields) {
+    for (uint l = 0; l < fields.size(); ++l)
+        if (l >= active_.size() || active_[l])
+            swap(fields[l], ustage_[l]);
+    t_ -= flags_.dt;
+}
+
+void IMEXRungeKuttaDDC::reset_dt(Real dt) {
+    flags_.dt = dt;
+    nse_->reset_lambda({1.0 / (gamma_ * dt)});
+}
+
+void IMEXRungeKuttaDDC::advance(vector<FlowField>& fields, int Nsteps) {
+    const int len = rhs_.size();
+    const int last = stages_ - 1;
+    const Real dt = flags_.dt;
+    const Real lambda = 1.0 / (gamma_ * dt);
+    const bool freeslip = ddcflags_.freeslip;
+
+    for (int step = 0; step < Nsteps; ++step) {
+        // Stage 1 is explicit, U_1 = u_n, L(U_1) has zero weight in every stage
+        nse_->nonlinear(fields, nonlf_[0]);
+
+        for (int i = 1; i < stages_; ++i) {
+            // R_i = u_n/(gamma dt) + sum_j (aI_ij L_j - aE_ij N_j)/gamma
+            for (int l = 0; l < len; ++l) {
+                if (!active_[l])
+                    continue;
+                rhs_[l] = fields[l];
+                rhs_[l] *= lambda;
+                for (int j = 0; j < i; ++j)
+                    rhs_[l].add(-aE_[i][j] / gamma_, nonlf_[j][l], aI_[i][j] / gamma_, linf_[j][l]);
+            }
+            nse_->solve(ustage_, rhs_);
+
+            // L(U_i) = U_i/(gamma dt) - R_i
+            for (int l = 0; l < len; ++l) {
+                if (!active_[l])
+                    continue;
+                linf_[i][l] = ustage_[l];
+                linf_[i][l] *= lambda;
+                linf_[i][l] -= rhs_[l];
+            }
+            if (i < last)
+                nse_->nonlinear(ustage_, nonlf_[i]);
+        }
+
+        // u_n+1 = U_s, the embedded solution is u_n + dt sum_i (bhatI_i L_i - bhatE_i N_i)
+        error_ = 0;
+        for (int l = 0; l < len; ++l) {
+            if (!active_[l])
+                continue;
+            rhs_[l] = ustage_[l];
+            rhs_[l] -= fields[l];
+            for (int i = 0; i < stages_; ++i) {
+                if (bhatI_[i] != 0)
+                    rhs_[l].add(-dt * bhatI_[i], linf_[i][l]);
+                if (bhatE_[i] != 0)
+                    rhs_[l].add(dt * bhatE_[i], nonlf_[i][l]);
+            }
+            error_ = std::max(error_, L2Norm(rhs_[l]) / (1 + L2Norm(ustage_[l])));
+        }
+        // the stage buffer keeps u_n for rejectStep and is overwritten by the next step
+        for (uint l = 0; l < fields.size(); ++l)
+            if (l >= active_.size() || active_[l])
+                swap(fields[l], ustage_[l]);
+
+        if (freeslip)
+            freeslipBC(fields, ddcflags_);
+
+        t_ += dt;
+
+        if (nse_->taskid() == 0) {
+            if (flags_.verbosity == PrintTime || flags_.verbosity == PrintAll)
+                *flags_.logstream << t_ << ' ' << flush;
+            else if (flags_.verbosity == PrintTicks)
+                *flags_.logstream << '.' << flush;
+        }
+    }
+
+    if (nse_->taskid() == 0)
+        if (flags_.verbosity == PrintTime || flags_.verbosity == PrintAll || flags_.verbosity == PrintTicks)
+            *flags_.logstream << endl;
+}
+
+MultirateDDC::MultirateDDC(const vector<FlowField>& fields, const shared_ptr<NSE>& nse, const DDCFlags& flags)
+    : DNSAlgorithm(fields, nse, flags),
+      ddcflags_(flags),
+      dde_(dynamic_pointer_cast<DDE>(nse)),
+      nflow_(flags.multirateflow ? flags.multirate : 1),
+      nsalt_(flags.multirateflow ? 1 : flags.multirate),
+      ustart_(fields[0]),
+      uend_(fields[0]),
+      nonlf_(nse->createRHS(fields)),
+      rhs_(nse->createRHS(fields)) {
+    order_ = 1;
+    Ninitsteps_ = 0;
+
+    const DDCCoefficients coeff = flags.coefficients();
+    if (!dde_)
+        cferror("MultirateDDC: the equations must be a DDE");
+    if (flags.multirate < 1)
+        cferror("MultirateDDC: flags.multirate must be positive");
+    if (!coeff.salinity)
+        cferror("MultirateDDC: the salinity equation is not integrated in system " + ddcsystem2s(flags.system));
+    if (coeff.crossdiffusion)
+        cferror("MultirateDDC: cross-diffusion is not supported, use a single-rate scheme for " +
+                ddcsystem2s(flags.system));
+    temperature_ = coeff.temperature;
+
+    nse_->reset_lambda({nflow_ / flags_.dt, nsalt_ / flags_.dt});
+}
+
+MultirateDDC* MultirateDDC::clone(const shared_ptr<NSE>& nse) const {
+    MultirateDDC* alg = new MultirateDDC(*this);
+    alg->nse_ = nse;
+    alg->dde_ = dynamic_pointer_cast<DDE>(nse);
+    return alg;
+}
+
+bool MultirateDDC::full() const { return true; }
+
+void MultirateDDC::reset_dt(Real dt) {
+    flags_.dt = dt;
+    nse_->reset_lambda({nflow_ / dt, nsalt_ / dt});
+}
+
+void MultirateDDC::advance(vector<FlowField>& fields, int Nsteps) {
+    const Real lambdaflow = nflow_ / flags_.dt;
+    const Real lambdasalt = nsalt_ / flags_.dt;
+    const bool freeslip = ddcflags_.freeslip;
+
+    for (int step = 0; step < Nsteps; ++step) {
+        ustart_ = fields[0];
+
+        // u and T: nflow_ IMEX Euler substeps with the salinity of the beginning of the step
+        dde_->selectEquations(true, temperature_, false);
+        for (int k = 0; k < nflow_; ++k) {
+            dde_->nonlinear(fields, nonlf_);
+            for (int l = 0; l < 2; ++l) {
+                if (l == 1 && !temperature_)
+                    continue;
+                rhs_[l] = fields[l];
+                rhs_[l] *= lambdaflow;
+                rhs_[l] -= nonlf_[l];
+            }
+            dde_->solve(fields, rhs_, 0);
+        }
+
+        // S: nsalt_ IMEX Euler substeps, advected by the velocity interpolated to the midpoint of each substep
+        swap(uend_, fields[0]);
+        dde_->selectEquations(false, false, true);
+        for (int k = 0; k < nsalt_; ++k) {
+            const Real theta = (k + 0.5) / nsalt_;
+            fields[0].setToZero();
+            fields[0].add(1 - theta, ustart_, theta, uend_);
+            dde_->nonlinear(fields, nonlf_);
+            rhs_[2] = fields[2];
+            rhs_[2] *= lambdasalt;
+            rhs_[2] -= nonlf_[2];
+            dde_->solve(fields, rhs_, 1);
+        }
+        swap(uend_, fields[0]);
+        dde_->selectEquations(true, true, true);
+
+        if (freeslip)
+            freeslipBC(fields, ddcflags_);
+
+        t_ += flags_.dt;
+
+        if (nse_->taskid() == 0) {
+            if (flags_.verbosity == PrintTime || flags_.verbosity == PrintAll)
+                *flags_.logstream << t_ << ' ' << flush;
+            else if (flags_.verbosity == PrintTicks)
+                *flags_.logstream << '.' << flush;
+        }
+    }
+
+    if (nse_->taskid() == 0)
+        if (flags_.verbosity == PrintTime || flags_.verbosity == PrintAll || flags_.verbosity == PrintTicks)
+            *flags_.logstream << endl;
+}
+
+}  // namespace chflow
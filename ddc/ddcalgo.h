@@ -11,18 +11,106 @@
 #include "cfbasics/cfvector.h"
 #include "cfbasics/mathdefs.h"
 #include "channelflow/chebyshev.h"
+#include "channelflow/dnsalgo.h"
 #include "channelflow/flowfield.h"
 #include "channelflow/symmetry.h"
 #include "modules/ddc/ddcflags.h"
-#include "modules/ddc/macros.h"
 #include "modules/ddc/dde.h"
 using namespace std;
 namespace chflow {
 
-class DDCAlgo : public DNSAlgorithm {
+/** \brief multistep time integration (CNFE1, SBDF1-4) of the double-diffusive equations
+ *
+ * Same scheme as MultistepDNS, but the fields passed to advance are swapped into and out of the
+ * history stack instead of copied, the RHS is allocated once and free-slip walls are imposed
+ * after every step if flags.freeslip is set.
+ */
+class DDCAlgo : public MultistepDNS {
    public:
-    void advance(std::vector<FlowField>& fields, int nSteps = 1);
+    DDCAlgo(const std::vector<FlowField>& fields, const std::shared_ptr<NSE>& nse, const DDCFlags& flags);
+
+    void advance(std::vector<FlowField>& fields, int nSteps = 1) override;
+    DDCAlgo* clone(const std::shared_ptr<NSE>& nse) const override;
+
+   protected:
+    DDCFlags ddcflags_;              // DDC part of the flags, e.g. free-slip walls
+    std::vector<FlowField> rhs_;     // RHS of the implicit problem, reused by every step
+};
+
+/** \brief additive IMEX Runge-Kutta integration of the double-diffusive equations
+ *
+ * du/dt = L(u) - N(u), where N is DDE::nonlinear (explicit tableau) and L is DDE::linear including the
+ * pressure gradient (implicit tableau). Stage i solves L(U_i) - U_i/(gamma dt) = -R_i with the DDE solvers,
+ * so L(U_i) = U_i/(gamma dt) - R_i follows without another call of DDE::linear. All stages share the
+ * diagonal coefficient gamma, hence DDE factorizes a single solver set per dt. The first implicit column is
+ * zero, so neither L(u_n) nor the pressure passed in enter the step. Both tableaux are stiffly accurate: the
+ * new fields are the last stage, with its pressure, and N of the last stage is not needed. The caller's
+ * fields are swapped with the stage buffer, which then holds the fields of the beginning of the step until
+ * the next one. The difference to the embedded lower order solution is available through error() after each
+ * step.
+ */
+class IMEXRungeKuttaDDC : public DNSAlgorithm {
+   public:
+    IMEXRungeKuttaDDC(const std::vector<FlowField>& fields, const std::shared_ptr<NSE>& nse, const DDCFlags& flags);
+
+    void advance(std::vector<FlowField>& fields, int nSteps = 1) override;
+    void reset_dt(Real dt) override;
+    bool full() const override;
+    IMEXRungeKuttaDDC* clone(const std::shared_ptr<NSE>& nse) const override;
+
+    // max over u, T, S of L2Norm(u - uhat)/(1 + L2Norm(u)) of the last step, uhat is the embedded solution
+    Real error() const;
+
+    // takes back the last step after it has been rejected: swaps the fields of its beginning back into fields
+    void rejectStep(std::vector<FlowField>& fields);
+
+   protected:
+    DDCFlags ddcflags_;
+    int stages_;
+    Real gamma_;                             // diagonal coefficient of the implicit tableau
+    std::vector<std::vector<Real>> aE_;      // explicit tableau, strictly lower triangular
+    std::vector<std::vector<Real>> aI_;      // implicit tableau without the diagonal, zero first column
+    std::vector<Real> bhatE_;                // weights of the embedded solution for N
+    std::vector<Real> bhatI_;                // weights of the embedded solution for L
+    std::vector<bool> active_;               // u, T, S are integrated
+
+    std::vector<FlowField> ustage_;          // current stage U_i including pressure
+    std::vector<std::vector<FlowField>> nonlf_;  // N(U_i) of all but the last stage
+    std::vector<std::vector<FlowField>> linf_;   // L(U_i) of all stages
+    std::vector<FlowField> rhs_;
+    Real error_;
+};
+
+/** \brief multirate integration: salinity and flow (u, T) advanced with different time steps
+ *
+ * One step of flags.dt advances S with flags.multirate substeps and u and T with one, or the reverse if
+ * flags.multirateflow is set. Both groups use the first order IMEX Euler scheme (SBDF1) with their own solver
+ * set. u and T are advanced first with S frozen at the beginning of the step, then S is advected by the velocity
+ * interpolated linearly between the beginning and the end of the step to the midpoint of each substep.
+ * This sequential splitting is first order in dt, whatever the number of substeps, so the substeps buy
+ * stability of the stiffer group, not accuracy. Cross-diffusion (p7 != 0) couples S to the new T and is not
+ * supported.
+ */
+class MultirateDDC : public DNSAlgorithm {
+   public:
+    MultirateDDC(const std::vector<FlowField>& fields, const std::shared_ptr<NSE>& nse, const DDCFlags& flags);
+
+    void advance(std::vector<FlowField>& fields, int nSteps = 1) override;
+    void reset_dt(Real dt) override;
+    bool full() const override;
+    MultirateDDC* clone(const std::shared_ptr<NSE>& nse) const override;
+
+   protected:
+    DDCFlags ddcflags_;
+    std::shared_ptr<DDE> dde_;        // nse_, needed for DDE::selectEquations
+    int nflow_;                       // substeps of u and T per step
+    int nsalt_;                       // substeps of S per step
+    bool temperature_;                // T is integrated
 
+    FlowField ustart_;                // velocity at the beginning of the step
+    FlowField uend_;                  // velocity at the end of the step, while fields[0] holds the interpolation
+    std::vector<FlowField> nonlf_;
+    std::vector<FlowField> rhs_;
 };
 }  // namespace chflow
-#endif
\ No newline at end of file
+#endif
@@ -6,6 +6,7 @@
 
 
 #include "modules/ddc/ddcdsi.h"
+#include <mutex>
 #ifdef HAVE_MPI
 #include <mpi.h>
 #endif
@@ -21,38 +22,227 @@ namespace chflow {
 
 /*utility functions*/
 
+// w[i*N+n] = average of T_n over the partial layer [a, y_i] of a Chebyshev grid with N modes on [a,b], integrated
+// exactly. The weights of the last few grids and sets of heights are kept.
+static std::shared_ptr<const std::vector<Real>> layerAverageWeights(int N, Real a, Real b, const std::vector<Real>& y) {
+    typedef std::pair<std::vector<Real>, std::shared_ptr<const std::vector<Real>>> Entry;
+    static std::vector<Entry> cache;
+    static std::mutex cachemutex;  // the cache is shared by all threads
+    const uint cachesize = 4;
+    std::lock_guard<std::mutex> lock(cachemutex);
+
+    std::vector<Real> key = {Real(N), a, b};
+    key.insert(key.end(), y.begin(), y.end());
+    for (uint i = 0; i < cache.size(); ++i)
+        if (cache[i].first == key) {
+            std::rotate(cache.begin(), cache.begin() + i, cache.begin() + i + 1);
+            return cache[0].second;
+        }
+
+    std::shared_ptr<std::vector<Real>> w = std::make_shared<std::vector<Real>>(y.size() * N);
+    std::vector<Real> T(N + 1);
+    for (uint i = 0; i < y.size(); ++i) {
+        const Real X = (2 * y[i] - a - b) / (b - a);
+        T[0] = 1;
+        T[1] = X;
+        for (int n = 1; n < N; ++n)
+            T[n + 1] = 2 * X * T[n] - T[n - 1];
+        Real* wi = w->data() + i * N;
+        if (X + 1 < 1e-14) {
+            // empty layer, the average is the value at y = a
+            for (int n = 0; n < N; ++n)
+                wi[n] = (n % 2 == 0) ? 1 : -1;
+            continue;
+        }
+        // int_{-1}^{X} T_n dx = (T_{n+1}(X)/(n+1) - T_{n-1}(X)/(n-1))/2 + (-1)^(n+1)/(n^2-1) for n >= 2
+        wi[0] = X + 1;
+        if (N > 1)
+            wi[1] = 0.5 * (X * X - 1);
+        for (int n = 2; n < N; ++n)
+            wi[n] = 0.5 * (T[n + 1] / (n + 1) - T[n - 1] / (n - 1)) + ((n % 2 == 0) ? -1.0 : 1.0) / (n * n - 1);
+        for (int n = 0; n < N; ++n)
+            wi[n] /= X + 1;
+    }
+
+    cache.insert(cache.begin(), Entry(key, w));
+    if (cache.size() > cachesize)
+        cache.pop_back();
+    return cache[0].second;
+}
+
+// averages of the spectral profile over the partial layers [a, y_i]
+static std::vector<Real> layerAverages(const ChebyCoeff& prof, const std::vector<Real>& y) {
+    assert(prof.state() == Spectral);
+    const int N = prof.N();
+    const std::shared_ptr<const std::vector<Real>> w = layerAverageWeights(N, prof.a(), prof.b(), y);
+    std::vector<Real> av(y.size(), 0.0);
+    for (uint i = 0; i < y.size(); ++i) {
+        const Real* wi = w->data() + i * N;
+        for (int n = 0; n < N; ++n)
+            av[i] += wi[n] * prof[n];
+    }
+    return av;
+}
+
+std::vector<Real> layerAverages(const FlowField& ftot, const std::vector<Real>& y) {
+    assert(ftot.ystate() == Spectral);
+    std::vector<Real> av(y.size(), 0.0);
+    if (ftot.taskid() == ftot.task_coeff(0, 0))
+        av = layerAverages(Re(ftot.profile(0, 0, 0)), y);
+#ifdef HAVE_MPI
+    MPI_Bcast(av.data(), av.size(), MPI_DOUBLE, ftot.task_coeff(0, 0), ftot.cfmpi()->comm_world);
+#endif
+    return av;
+}
+
+// indices of the quantities summed over the Fourier modes (and, for the (0,0) profile, set by its owner only)
+enum DDCStatsSum {
+    SumU2,        // L2Norm2(u)
+    SumU3d2,      // L2Norm2 of the modes kx != 0 of u (L2Norm3d)
+    SumEcf,       // L2Norm2 of the modes kx != 0 of v, w (Ecf)
+    SumUtot2,     // L2Norm2(u+Ubase)
+    SumDissip,    // L2Norm2(curl(u+Ubase))
+    SumT2,        // L2Norm2(T)
+    SumTtot2,     // L2Norm2(T+Tbase)
+    SumS2,        // L2Norm2(S)
+    SumStot2,     // L2Norm2(S+Sbase)
+    SumWsLower,   // d(u+Ubase)/dy at y=a
+    SumWsUpper,   // d(u+Ubase)/dy at y=b
+    SumUbulk,     // mean of u_00
+    SumWbulk,     // mean of w_00
+    SumTcontent,  // average of T+Tbase over [a, ystats]
+    SumScontent,  // average of S+Sbase over [a, ystats]
+    NumStatsSums
+};
+
 std::vector<Real> ddcstats(const FlowField& u, const FlowField& temp, const FlowField& salt, const DDCFlags flags) {
-    double l2n = L2Norm(u);
-    if (std::isnan(l2n)) {
-        cferror("L2Norm(u) is nan");
+    assert(u.xzstate() == Spectral && u.ystate() == Spectral);
+    const bool heat = activeScalar(temp);
+    const bool salinity = activeScalar(salt);
+    const int Ny = u.Ny();
+    const Real a = u.a();
+    const Real b = u.b();
+    const Complex I(0.0, 1.0);
+    const std::shared_ptr<const DDCBaseFlow> base = ddcBaseFlow(Ny, a, b, flags);
+
+    // One sweep over the local Fourier modes accumulates all norms of u, T, S and of the total fields (which differ
+    // only in the (0,0) mode), the norms of the modes kx != 0 and the dissipation; the profile quantities of the
+    // (0,0) mode are added by its owner. A single reduction of the packed sums completes them.
+    std::vector<Real> sums(NumStatsSums, 0.0);
+    ComplexChebyCoeff uk(Ny, a, b, Spectral), vk(Ny, a, b, Spectral), wk(Ny, a, b, Spectral);
+    ComplexChebyCoeff uyk(Ny, a, b, Spectral), wyk(Ny, a, b, Spectral), fk(Ny, a, b, Spectral);
+    ComplexChebyCoeff ox(Ny, a, b, Spectral), oy(Ny, a, b, Spectral), oz(Ny, a, b, Spectral);
+
+    for (lint mx = u.mxlocmin(); mx < u.mxlocmin() + u.Mxloc(); ++mx) {
+        const int kx = u.kx(mx);
+        const Complex ialpha = 2 * pi * kx / u.Lx() * I;
+        for (lint mz = u.mzlocmin(); mz < u.mzlocmin() + u.Mzloc(); ++mz) {
+            const int kz = u.kz(mz);
+            const Complex ibeta = 2 * pi * kz / u.Lz() * I;
+            const Real cz = (kz == 0) ? 1.0 : 2.0;  // conjugate modes kz < 0 are not stored
+            const bool mean = (kx == 0 && kz == 0);
+
+            for (int ny = 0; ny < Ny; ++ny) {
+                uk.set(ny, u.cmplx(mx, ny, mz, 0));
+                vk.set(ny, u.cmplx(mx, ny, mz, 1));
+                wk.set(ny, u.cmplx(mx, ny, mz, 2));
+            }
+            const Real vw2 = cz * (L2Norm2(vk) + L2Norm2(wk));
+            const Real u2 = cz * L2Norm2(uk) + vw2;
+            sums[SumU2] += u2;
+            if (kx != 0) {
+                sums[SumU3d2] += u2;
+                sums[SumEcf] += vw2;
+            }
+
+            if (mean) {
+                sums[SumUbulk] += Re(uk).mean();
+                sums[SumWbulk] += Re(wk).mean();
+                // add the base flow as totalVelocity does
+                if (base->U.length() > 0)
+                    for (int ny = 0; ny < Ny; ++ny) {
+                        uk.set(ny, uk[ny] + base->U[ny]);
+                        wk.set(ny, wk[ny] + base->W[ny]);
+                    }
+                vk.set(0, vk[0] - flags.Vsuck);
+                sums[SumUtot2] += L2Norm2(uk) + L2Norm2(vk) + L2Norm2(wk);
+                const ChebyCoeff dUdy = diff(Re(uk));
+                sums[SumWsLower] += dUdy.eval_a();
+                sums[SumWsUpper] += dUdy.eval_b();
+            } else
+                sums[SumUtot2] += u2;
+
+            // curl(u) = (dw/dy - i beta v, i beta u - i alpha w, i alpha v - du/dy)
+            diff(uk, uyk);
+            diff(wk, wyk);
+            for (int ny = 0; ny < Ny; ++ny) {
+                ox.set(ny, wyk[ny] - ibeta * vk[ny]);
+                oy.set(ny, ibeta * uk[ny] - ialpha * wk[ny]);
+                oz.set(ny, ialpha * vk[ny] - uyk[ny]);
+            }
+            sums[SumDissip] += cz * (L2Norm2(ox) + L2Norm2(oy) + L2Norm2(oz));
+
+            // scalars: norms of the fluctuation and of the total field, partial-layer average of the total field
+            for (int l = 0; l < 2; ++l) {
+                if (l == 0 ? !heat : !salinity)
+                    continue;
+                const FlowField& f = (l == 0) ? temp : salt;
+                const ChebyCoeff& fbase = (l == 0) ? base->T : base->S;
+                const int i2 = (l == 0) ? SumT2 : SumS2;
+                const int itot2 = (l == 0) ? SumTtot2 : SumStot2;
+                for (int ny = 0; ny < Ny; ++ny)
+                    fk.set(ny, f.cmplx(mx, ny, mz, 0));
+                const Real f2 = cz * L2Norm2(fk);
+                sums[i2] += f2;
+                if (mean) {
+                    if (fbase.length() > 0)
+                        for (int ny = 0; ny < Ny; ++ny)
+                            fk.set(ny, fk[ny] + fbase[ny]);
+                    sums[itot2] += L2Norm2(fk);
+                    sums[(l == 0) ? SumTcontent : SumScontent] += layerAverages(Re(fk), {flags.ystats})[0];
+                } else
+                    sums[itot2] += f2;
+            }
+        }
     }
+#ifdef HAVE_MPI
+    MPI_Allreduce(MPI_IN_PLACE, sums.data(), NumStatsSums, MPI_DOUBLE, MPI_SUM, *u.comm_world());
+#endif
 
-    FlowField u_tot = totalVelocity(u, flags);
-    FlowField temp_tot = totalTemperature(temp, flags);
-    FlowField salt_tot = totalSalinity(salt, flags);
+    if (std::isnan(sums[SumU2])) {
+        cferror("L2Norm(u) is nan");
+    }
 
     std::vector<Real> stats;
-    Real KE = 0.5*L2Norm2(u); stats.push_back(KE);
-    Real PE = 0.5*flags.Ri*L2Norm2(temp); stats.push_back(PE);
+    Real KE = 0.5*sums[SumU2]; stats.push_back(KE);
+    Real PE = heat ? 0.5*flags.Ri*sums[SumT2] : 0.0; stats.push_back(PE);
     stats.push_back(KE+PE);
-    stats.push_back(dissipation(u_tot));
-
-    stats.push_back(wallshearUpper(u_tot)); // for Langham2019JFM
-    stats.push_back(wallshear(u_tot)); // I
-    stats.push_back(L2Norm(u));
-    stats.push_back(L2Norm(u_tot));
-    stats.push_back(L2Norm3d(u));
-    stats.push_back(Ecf(u));
-    stats.push_back(getUbulk(u));
-    stats.push_back(getWbulk(u));
-
-    stats.push_back(L2Norm(temp));
-    stats.push_back(L2Norm(temp_tot));
-    stats.push_back(heatcontent(temp_tot, flags));// averaged temp
-
-    stats.push_back(L2Norm(salt));
-    stats.push_back(L2Norm(salt_tot));
-    stats.push_back(saltcontent(salt_tot, flags));// averaged salt
+    stats.push_back(sums[SumDissip]);
+
+    stats.push_back(sums[SumWsUpper]); // for Langham2019JFM
+    stats.push_back(0.5 * (abs(sums[SumWsLower]) + abs(sums[SumWsUpper]))); // I
+    stats.push_back(sqrt(sums[SumU2]));
+    stats.push_back(sqrt(sums[SumUtot2]));
+    // streamwise-dependent part as in L2Norm3d and Ecf of channelflow
+    stats.push_back(sqrt(sums[SumU3d2]));
+    stats.push_back(sums[SumEcf]);
+    stats.push_back(sums[SumUbulk]);
+    stats.push_back(sums[SumWbulk]);
+
+    // inactive scalars keep their columns, filled with zeros
+    if (heat) {
+        stats.push_back(sqrt(sums[SumT2]));
+        stats.push_back(sqrt(sums[SumTtot2]));
+        stats.push_back(sums[SumTcontent]);// averaged temp
+    } else
+        stats.insert(stats.end(), 3, 0.0);
+
+    if (salinity) {
+        stats.push_back(sqrt(sums[SumS2]));
+        stats.push_back(sqrt(sums[SumStot2]));
+        stats.push_back(sums[SumScontent]);// averaged salt
+    } else
+        stats.insert(stats.end(), 3, 0.0);
     
     return stats;
 }
@@ -114,12 +304,11 @@ string ddcfieldstats_t(const FlowField& u, const FlowField& temp, const FlowFiel
 FlowField totalVelocity(const FlowField& velo, const DDCFlags flags) {
     // copy
     FlowField u(velo);
-    FlowField tmp(u.Nx(), u.Ny(), u.Nz(), 1, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi());
 
     // get base flow
-    DDC ddc({u, tmp, tmp, tmp}, flags);
-    ChebyCoeff Ubase = ddc.Ubase();
-    ChebyCoeff Wbase = ddc.Wbase();
+    const std::shared_ptr<const DDCBaseFlow> base = ddcBaseFlow(u.Ny(), u.a(), u.b(), flags);
+    const ChebyCoeff& Ubase = base->U;
+    const ChebyCoeff& Wbase = base->W;
 
     // add base flow (should be identical to code in function temperatureNL in DDE
     for (int ny = 0; ny < u.Ny(); ++ny) {
@@ -138,11 +327,10 @@ FlowField totalVelocity(const FlowField& velo, const DDCFlags flags) {
 FlowField totalTemperature(const FlowField& temp, const DDCFlags flags) {
     // copy
     FlowField T(temp);
-    FlowField tmp(T.Nx(), T.Ny(), T.Nz(), 3, T.Lx(), T.Lz(), T.a(), T.b(), T.cfmpi());
 
     // get base flow
-    DDC ddc({tmp, T, T, T}, flags);
-    ChebyCoeff Tbase = ddc.Tbase();
+    const std::shared_ptr<const DDCBaseFlow> base = ddcBaseFlow(T.Ny(), T.a(), T.b(), flags);
+    const ChebyCoeff& Tbase = base->T;
 
     // add base flow (should be identical to code in function temperatureNL in DDE
     for (int ny = 0; ny < T.Ny(); ++ny) {
@@ -156,11 +344,10 @@ FlowField totalTemperature(const FlowField& temp, const DDCFlags flags) {
 FlowField totalSalinity(const FlowField& salt, const DDCFlags flags) {
     // copy
     FlowField S(salt);
-    FlowField tmp(S.Nx(), S.Ny(), S.Nz(), 3, S.Lx(), S.Lz(), S.a(), S.b(), S.cfmpi());
 
     // get base flow
-    DDC ddc({tmp, S, S, S}, flags);
-    ChebyCoeff Sbase = ddc.Sbase();
+    const std::shared_ptr<const DDCBaseFlow> base = ddcBaseFlow(S.Ny(), S.a(), S.b(), flags);
+    const ChebyCoeff& Sbase = base->S;
 
     // add base flow (should be identical to code in function temperatureNL in DDE
     for (int ny = 0; ny < S.Ny(); ++ny) {
@@ -173,40 +360,10 @@ FlowField totalSalinity(const FlowField& salt, const DDCFlags flags) {
 
 
 Real heatcontent(const FlowField& ttot, const DDCFlags flags) {
-    assert(ttot.ystate() == Spectral);
-    int N = 100;
-    Real dy = (flags.ystats - ttot.a()) / (N - 1);
-    Real avt = 0;  // average temperature
-    if (ttot.taskid() == ttot.task_coeff(0, 0)) {
-        ChebyCoeff tprof = Re(ttot.profile(0, 0, 0));
-        for (int i = 0; i < N; ++i) {
-            Real y = ttot.a() + i * dy;
-            avt += tprof.eval(y);
-        }
-        avt *= 1.0 / N;
-    }
-#ifdef HAVE_MPI
-    MPI_Bcast(&avt, 1, MPI_DOUBLE, ttot.task_coeff(0, 0), ttot.cfmpi()->comm_world);
-#endif
-    return avt;
+    return layerAverages(ttot, {flags.ystats})[0];  // average temperature
 }
 Real saltcontent(const FlowField& stot, const DDCFlags flags) {
-    assert(stot.ystate() == Spectral);
-    int N = 100;
-    Real dy = (flags.ystats - stot.a()) / (N - 1);
-    Real avt = 0;  // average salinity
-    if (stot.taskid() == stot.task_coeff(0, 0)) {
-        ChebyCoeff sprof = Re(stot.profile(0, 0, 0));
-        for (int i = 0; i < N; ++i) {
-            Real y = stot.a() + i * dy;
-            avt += sprof.eval(y);
-        }
-        avt *= 1.0 / N;
-    }
-#ifdef HAVE_MPI
-    MPI_Bcast(&avt, 1, MPI_DOUBLE, stot.task_coeff(0, 0), stot.cfmpi()->comm_world);
-#endif
-    return avt;
+    return layerAverages(stot, {flags.ystats})[0];  // average salinity
 }
 
 
@@ -214,6 +371,18 @@ Real saltcontent(const FlowField& stot, const DDCFlags flags) {
 
 ddcDSI::ddcDSI() {}
 
+FlowField ddcDSI::newTemperature() const {
+    if (!ddcflags_.coefficients().temperature)
+        return FlowField();
+    return FlowField(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+}
+
+FlowField ddcDSI::newSalinity() const {
+    if (!ddcflags_.coefficients().salinity)
+        return FlowField();
+    return FlowField(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+}
+
 ddcDSI::ddcDSI(DDCFlags& ddcflags, FieldSymmetry sigma, PoincareCondition* h, TimeStep dt, bool Tsearch, bool xrelative,
                bool zrelative, bool Tnormalize, Real Unormalize, const FlowField& u, const FlowField& temp, const FlowField& salt, ostream* os)
     : cfDSI(ddcflags, sigma, h, dt, Tsearch, xrelative, zrelative, Tnormalize, Unormalize, u, os),
@@ -221,15 +390,15 @@ ddcDSI::ddcDSI(DDCFlags& ddcflags, FieldSymmetry sigma, PoincareCondition* h, Ti
 
 Eigen::VectorXd ddcDSI::eval(const Eigen::VectorXd& x) {
     FlowField u(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField temp = newTemperature();
+    FlowField salt = newSalinity();
 
     Real T;
     extractVectorDDC(x, u, temp, salt, sigma_, T);
 
     FlowField Gu(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField Gtemp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField Gsalt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField Gtemp = newTemperature();
+    FlowField Gsalt = newSalinity();
     G(u, temp, salt, T, h_, sigma_, Gu, Gtemp, Gsalt, ddcflags_, dt_, Tnormalize_, Unormalize_, fcount_, CFL_, *os_);
     Eigen::VectorXd Gx(Eigen::VectorXd::Zero(x.rows()));
     //   Galpha *= 1./vednsflags_.b_para;
@@ -241,18 +410,18 @@ Eigen::VectorXd ddcDSI::eval(const Eigen::VectorXd& x) {
 Eigen::VectorXd ddcDSI::eval(const Eigen::VectorXd& x0, const Eigen::VectorXd& x1, bool symopt) {
     FlowField u0(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
     FlowField u1(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp0(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp1(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt0(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt1(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField temp0 = newTemperature();
+    FlowField temp1 = newTemperature();
+    FlowField salt0 = newSalinity();
+    FlowField salt1 = newSalinity();
     Real T0, T1;
     FieldSymmetry sigma0, sigma1;
     extractVectorDDC(x0, u0, temp0, salt0, sigma0, T0);
     extractVectorDDC(x1, u1, temp1, salt1, sigma1, T1);
 
     FlowField Gu(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField Gtemp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField Gsalt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField Gtemp = newTemperature();
+    FlowField Gsalt = newSalinity();
 
     f(u0, temp0, salt0, T0, h_, Gu, Gtemp, Gsalt, ddcflags_, dt_, fcount_, CFL_, *os_);
     if (symopt) {
@@ -262,26 +431,33 @@ Eigen::VectorXd ddcDSI::eval(const Eigen::VectorXd& x0, const Eigen::VectorXd& x
             FieldSymmetry inv(-1);
             sigma0 *= inv;
         }
-        Gtemp *= sigma0;
-        Gsalt *= sigma0;
+        if (activeScalar(Gtemp))
+            Gtemp *= sigma0;
+        if (activeScalar(Gsalt))
+            Gsalt *= sigma0;
     }
     Gu -= u1;
-    Gtemp -= temp1;
-    Gsalt -= salt1;
+    if (activeScalar(Gtemp))
+        Gtemp -= temp1;
+    if (activeScalar(Gsalt))
+        Gsalt -= salt1;
 
     // normalize
+    Real c = 1.0;
     if (Tnormalize_) {
         Gu *= 1.0 / T0;
-        Gtemp *= 1.0 / T0;
-        Gsalt *= 1.0 / T0;
+        c *= 1.0 / T0;
     }
     if (Unormalize_ != 0.0) {
         Real funorm = L2Norm3d(Gu);
         Gu *= 1. / sqrt(abs(funorm * (Unormalize_ - funorm)));
         // u should stay off zero, so normalize with u for now - temp should also stay away from zero
-        Gtemp *= 1. / sqrt(abs(funorm * (Unormalize_ - funorm)));
-        Gsalt *= 1. / sqrt(abs(funorm * (Unormalize_ - funorm)));
+        c *= 1. / sqrt(abs(funorm * (Unormalize_ - funorm)));
     }
+    if (activeScalar(Gtemp))
+        Gtemp *= c;
+    if (activeScalar(Gsalt))
+        Gsalt *= c;
 
     Eigen::VectorXd Gx(Eigen::VectorXd::Zero(x0.rows()));
     field2vector(Gu, Gtemp, Gsalt, Gx);  // This does not change the size of Gx and automatically leaves the last entries zero
@@ -291,15 +467,17 @@ Eigen::VectorXd ddcDSI::eval(const Eigen::VectorXd& x0, const Eigen::VectorXd& x
 
 void ddcDSI::save(const Eigen::VectorXd& x, const string filebase, const string outdir, const bool fieldsonly) {
     FlowField u(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField temp = newTemperature();
+    FlowField salt = newSalinity();
     FieldSymmetry sigma;
     Real T;
     extractVectorDDC(x, u, temp, salt, sigma, T);
 
     u.save(outdir + "u" + filebase);
-    temp.save(outdir + "t" + filebase);
-    salt.save(outdir + "s" + filebase);
+    if (activeScalar(temp))
+        temp.save(outdir + "t" + filebase);
+    if (activeScalar(salt))
+        salt.save(outdir + "s" + filebase);
 
     if (!fieldsonly) {
         string fs = ddcfieldstats(u, temp, salt, ddcflags_);
@@ -322,8 +500,8 @@ void ddcDSI::save(const Eigen::VectorXd& x, const string filebase, const string
 
 string ddcDSI::stats(const Eigen::VectorXd& x) {
     FlowField u(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField temp = newTemperature();
+    FlowField salt = newSalinity();
     FieldSymmetry sigma;
     Real T;
     extractVectorDDC(x, u, temp, salt, sigma, T);
@@ -332,8 +510,8 @@ string ddcDSI::stats(const Eigen::VectorXd& x) {
 
 pair<string, string> ddcDSI::stats_minmax(const Eigen::VectorXd& x) {
     FlowField u(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField temp = newTemperature();
+    FlowField salt = newSalinity();
     FlowField Gu(u);
     FlowField Gtemp(temp);
     FlowField Gsalt(salt);
@@ -386,8 +564,8 @@ string ddcDSI::statsHeader() { return ddcfieldstatsheader_t(ddc_cPar2s(ddc_cPar_
 void ddcDSI::phaseShift(Eigen::VectorXd& x) {
     if (xphasehack_ || zphasehack_) {
         FlowField unew(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-        FlowField tnew(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-        FlowField snew(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+        FlowField tnew = newTemperature();
+        FlowField snew = newSalinity();
         FieldSymmetry sigma;
         Real T;
         extractVectorDDC(x, unew, tnew, snew, sigma, T);
@@ -400,15 +578,19 @@ void ddcDSI::phaseShift(Eigen::VectorXd& x) {
             FieldSymmetry tau = zfixphasehack(unew, phasehackguess, phasehackcoord, phasehackparity);
             cout << "fixing z phase of potential solution with phase shift tau == " << tau << endl;
             unew *= tau;
-            tnew *= tau;
-            snew *= tau;
+            if (activeScalar(tnew))
+                tnew *= tau;
+            if (activeScalar(snew))
+                snew *= tau;
         }
         if (xphasehack_) {
             FieldSymmetry tau = xfixphasehack(unew, phasehackguess, phasehackcoord, phasehackparity);
             cout << "fixing x phase of potential solution with phase shift tau == " << tau << endl;
             unew *= tau;
-            tnew *= tau;
-            snew *= tau;
+            if (activeScalar(tnew))
+                tnew *= tau;
+            if (activeScalar(snew))
+                snew *= tau;
         }
         if (uUbasehack_) {
             cout << "fixing u+Ubase decomposition so that <du/dy> = 0 at walls (i.e. Ubase balances mean pressure "
@@ -431,8 +613,8 @@ void ddcDSI::phaseShift(Eigen::VectorXd& x) {
 void ddcDSI::phaseShift(Eigen::MatrixXd& y) {
     if (xphasehack_ || zphasehack_) {
         FlowField unew(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-        FlowField tnew(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-        FlowField snew(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+        FlowField tnew = newTemperature();
+        FlowField snew = newSalinity();
         Eigen::VectorXd yvec;
         FieldSymmetry sigma;
         Real T;
@@ -458,11 +640,15 @@ void ddcDSI::phaseShift(Eigen::MatrixXd& y) {
         for (int i = 0; i < y.cols(); i++) {
             extractVectorDDC(y.col(i), unew, tnew, snew, sigma, T);
             unew *= taux;
-            tnew *= taux;
-            snew *= taux;
             unew *= tauz;
-            tnew *= tauz;
-            snew *= tauz;
+            if (activeScalar(tnew)) {
+                tnew *= taux;
+                tnew *= tauz;
+            }
+            if (activeScalar(snew)) {
+                snew *= taux;
+                snew *= tauz;
+            }
             makeVectorDDC(unew, tnew, snew, sigma, T, yvec);
             y.col(i) = yvec;
         }
@@ -471,8 +657,8 @@ void ddcDSI::phaseShift(Eigen::MatrixXd& y) {
 
 Real ddcDSI::extractT(const Eigen::VectorXd& x) {  // inefficient hack
     FlowField u(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField temp = newTemperature();
+    FlowField salt = newSalinity();
     FieldSymmetry sigma;
     Real T;
     extractVectorDDC(x, u, temp, salt, sigma, T);
@@ -481,8 +667,8 @@ Real ddcDSI::extractT(const Eigen::VectorXd& x) {  // inefficient hack
 
 Real ddcDSI::extractXshift(const Eigen::VectorXd& x) {  // inefficient hack
     FlowField u(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField temp = newTemperature();
+    FlowField salt = newSalinity();
     FieldSymmetry sigma;
     Real T;
     extractVectorDDC(x, u, temp, salt, sigma, T);
@@ -491,8 +677,8 @@ Real ddcDSI::extractXshift(const Eigen::VectorXd& x) {  // inefficient hack
 
 Real ddcDSI::extractZshift(const Eigen::VectorXd& x) {  // inefficient hack
     FlowField u(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField temp = newTemperature();
+    FlowField salt = newSalinity();
     FieldSymmetry sigma;
     Real T;
     extractVectorDDC(x, u, temp, salt, sigma, T);
@@ -503,20 +689,25 @@ void ddcDSI::makeVectorDDC(const FlowField& u, const FlowField& temp, const Flow
                            Eigen::VectorXd& x) {
     if (u.Nd() != 3)
         cferror("ddcDSI::makeVector(): u.Nd() = " + i2s(u.Nd()) + " != 3");
-    if (temp.Nd() != 1)
-        cferror("ddcDSI::makeVector(): temp.Nd() = " + i2s(temp.Nd()) + " != 1");
-    if (salt.Nd() != 1)
-        cferror("ddcDSI::makeVector(): salt.Nd() = " + i2s(salt.Nd()) + " != 1");
+    // scalars that are inactive in the selected system take no entries in x
+    const DDCCoefficients coeff = ddcflags_.coefficients();
+    const FlowField none;
+    const FlowField& t = coeff.temperature ? temp : none;
+    const FlowField& s = coeff.salinity ? salt : none;
+    if (activeScalar(t) && t.Nd() != 1)
+        cferror("ddcDSI::makeVector(): temp.Nd() = " + i2s(t.Nd()) + " != 1");
+    if (activeScalar(s) && s.Nd() != 1)
+        cferror("ddcDSI::makeVector(): salt.Nd() = " + i2s(s.Nd()) + " != 1");
     int taskid = u.taskid();
 
-    int uunk = field2vector_size(u, temp, salt);                   // # of variables for u and alpha unknonwn
+    int uunk = field2vector_size(u, t, s);                   // # of variables for u and alpha unknonwn
     const int Tunk = (Tsearch_ && taskid == 0) ? uunk : -1;  // index for T unknown
     const int xunk = (xrelative_ && taskid == 0) ? uunk + Tsearch_ : -1;
     const int zunk = (zrelative_ && taskid == 0) ? uunk + Tsearch_ + xrelative_ : -1;
     int Nunk = (taskid == 0) ? uunk + Tsearch_ + xrelative_ + zrelative_ : uunk;
     if (x.rows() < Nunk)
         x.resize(Nunk);
-    field2vector(u, temp, salt, x);
+    field2vector(u, t, s, x);
     if (taskid == 0) {
         if (Tsearch_)
             x(Tunk) = T;
@@ -550,14 +741,16 @@ void ddcDSI::extractVectorDDC(const Eigen::VectorXd& x, FlowField& u, FlowField&
 
 Eigen::VectorXd ddcDSI::xdiff(const Eigen::VectorXd& a) {
     FlowField u(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField temp = newTemperature();
+    FlowField salt = newSalinity();
     vector2field(a, u, temp, salt);
     Eigen::VectorXd dadx(a.size());
     dadx.setZero();
     u = chflow::xdiff(u);
-    temp = chflow::xdiff(temp);
-    salt = chflow::xdiff(salt);
+    if (activeScalar(temp))
+        temp = chflow::xdiff(temp);
+    if (activeScalar(salt))
+        salt = chflow::xdiff(salt);
     field2vector(u, temp, salt, dadx);
     dadx *= 1. / L2Norm(dadx);
     return dadx;
@@ -565,14 +758,16 @@ Eigen::VectorXd ddcDSI::xdiff(const Eigen::VectorXd& a) {
 
 Eigen::VectorXd ddcDSI::zdiff(const Eigen::VectorXd& a) {
     FlowField u(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField temp = newTemperature();
+    FlowField salt = newSalinity();
     vector2field(a, u, temp, salt);
     Eigen::VectorXd dadz(a.size());
     dadz.setZero();
     u = chflow::zdiff(u);
-    temp = chflow::zdiff(temp);
-    salt = chflow::zdiff(salt);
+    if (activeScalar(temp))
+        temp = chflow::zdiff(temp);
+    if (activeScalar(salt))
+        salt = chflow::zdiff(salt);
     field2vector(u, temp, salt, dadz);
     dadz *= 1. / L2Norm(dadz);
     return dadz;
@@ -580,8 +775,8 @@ Eigen::VectorXd ddcDSI::zdiff(const Eigen::VectorXd& a) {
 
 Eigen::VectorXd ddcDSI::tdiff(const Eigen::VectorXd& a, Real epsDt) {
     FlowField u(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField temp(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField salt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField temp = newTemperature();
+    FlowField salt = newSalinity();
     FieldSymmetry sigma;
     Real T;
     // quick hack to avoid new interface or creating simple f() for DDC
@@ -599,8 +794,10 @@ Eigen::VectorXd ddcDSI::tdiff(const Eigen::VectorXd& a, Real epsDt) {
     f(u, temp, salt, epsDt, h, edudtf, edtempdtf, edsaltdtf, ddcflags_, dt, fcount, CFL, muted_os);
     //   f (temp, 1,epsDt, edtempdtf, dnsflags_, *os_);
     edudtf -= u;
-    edtempdtf -= temp;
-    edsaltdtf -= salt;
+    if (activeScalar(temp))
+        edtempdtf -= temp;
+    if (activeScalar(salt))
+        edsaltdtf -= salt;
     Eigen::VectorXd dadt(a.size());
     field2vector(edudtf, edtempdtf, edsaltdtf, dadt);
     dadt *= 1. / L2Norm(dadt);
@@ -759,42 +956,50 @@ void ddcDSI::saveParameters(string searchdir) {
 
 void ddcDSI::saveEigenvec(const Eigen::VectorXd& ev, const string label, const string outdir) {
     FlowField efu(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField eft(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField efs(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField eft = newTemperature();
+    FlowField efs = newSalinity();
     vector2field(ev, efu, eft, efs);
     efu *= 1.0 / L2Norm(efu);
-    eft *= 1.0 / L2Norm(eft);
-    efs *= 1.0 / L2Norm(efs);
     efu.save(outdir + "efu" + label);
-    eft.save(outdir + "eft" + label);
-    efs.save(outdir + "efs" + label);
+    if (activeScalar(eft)) {
+        eft *= 1.0 / L2Norm(eft);
+        eft.save(outdir + "eft" + label);
+    }
+    if (activeScalar(efs)) {
+        efs *= 1.0 / L2Norm(efs);
+        efs.save(outdir + "efs" + label);
+    }
 }
 
 void ddcDSI::saveEigenvec(const Eigen::VectorXd& evA, const Eigen::VectorXd& evB, const string label1,
                           const string label2, const string outdir) {
     FlowField efAu(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
     FlowField efBu(Nx_, Ny_, Nz_, Nd_, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField efAt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField efBt(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField efAs(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
-    FlowField efBs(Nx_, Ny_, Nz_, 1, Lx_, Lz_, ya_, yb_, cfmpi_);
+    FlowField efAt = newTemperature();
+    FlowField efBt = newTemperature();
+    FlowField efAs = newSalinity();
+    FlowField efBs = newSalinity();
     vector2field(evA, efAu, efAt, efAs);
     vector2field(evB, efBu, efBt, efBs);
     Real cu = 1.0 / sqrt(L2Norm2(efAu) + L2Norm2(efBu));
-    Real ct = 1.0 / sqrt(L2Norm2(efAt) + L2Norm2(efBt));
-    Real cs = 1.0 / sqrt(L2Norm2(efAs) + L2Norm2(efBs));
     efAu *= cu;
     efBu *= cu;
-    efAt *= ct;
-    efBt *= ct;
-    efAs *= cs;
-    efBs *= cs;
     efAu.save(outdir + "efu" + label1);
     efBu.save(outdir + "efu" + label2);
-    efAt.save(outdir + "eft" + label1);
-    efBt.save(outdir + "eft" + label2);
-    efAs.save(outdir + "efs" + label1);
-    efBs.save(outdir + "efs" + label2);
+    if (activeScalar(efAt)) {
+        Real ct = 1.0 / sqrt(L2Norm2(efAt) + L2Norm2(efBt));
+        efAt *= ct;
+        efBt *= ct;
+        efAt.save(outdir + "eft" + label1);
+        efBt.save(outdir + "eft" + label2);
+    }
+    if (activeScalar(efAs)) {
+        Real cs = 1.0 / sqrt(L2Norm2(efAs) + L2Norm2(efBs));
+        efAs *= cs;
+        efBs *= cs;
+        efAs.save(outdir + "efs" + label1);
+        efBs.save(outdir + "efs" + label2);
+    }
 }
 
 /* OUTSIDE CLASS */
@@ -807,32 +1012,31 @@ void G(const FlowField& u, const FlowField& temp, const FlowField& salt, Real& T
     Real funorm = L2Norm3d(Gu);
     Gu *= sigma;
     Gu -= u;
+    // wall-normal mirroring in velocity requires sign change in temperature and salinity
+    FieldSymmetry ssigma(sigma);
     if (sigma.sy() == -1) {
-        // wall-normal mirroring in velocity requires sign change in temperature and salinity
-        FieldSymmetry tsigma(sigma);
-        FieldSymmetry ssigma(sigma);
         FieldSymmetry inv(-1);
-        tsigma *= inv;
         ssigma *= inv;
-        Gtemp *= tsigma;
-        Gsalt *= ssigma;
-    } else {
-        Gtemp *= sigma;
-        Gsalt *= sigma;
     }
-    Gtemp -= temp;
-    Gsalt -= salt;
-
+    Real c = 1.0;
     if (Tnormalize) {
         Gu *= 1.0 / T;
-        Gtemp *= 1.0 / T;
-        Gsalt *= 1.0 / T;
+        c *= 1.0 / T;
     }
     if (Unormalize != 0.0) {
         Gu *= 1. / sqrt(abs(funorm * (Unormalize - funorm)));
         // u should stay off zero, so normalize with u for now - temp should also stay away from zero
-        Gtemp *= 1. / sqrt(abs(funorm * (Unormalize - funorm)));
-        Gsalt *= 1. / sqrt(abs(funorm * (Unormalize - funorm)));
+        c *= 1. / sqrt(abs(funorm * (Unormalize - funorm)));
+    }
+    if (activeScalar(temp)) {
+        Gtemp *= ssigma;
+        Gtemp -= temp;
+        Gtemp *= c;
+    }
+    if (activeScalar(salt)) {
+        Gsalt *= ssigma;
+        Gsalt -= salt;
+        Gsalt *= c;
     }
 }
 
@@ -845,7 +1049,9 @@ void f(const FlowField& u, const FlowField& temp, const FlowField& salt, Real& T
     DDCFlags flags(ddcflags_);
     flags.logstream = &os;
     TimeStep dt(dt_);
-    vector<FlowField> fields = {u, temp, salt, FlowField(u.Nx(), u.Ny(), u.Nz(), 1, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi())};
+    // inactive scalars are integrated as zero fields, DNS::advance expects all fields to have the geometry of u
+    const FlowField zero(u.Nx(), u.Ny(), u.Nz(), 1, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi());
+    vector<FlowField> fields = {u, activeScalar(temp) ? temp : zero, activeScalar(salt) ? salt : zero, zero};
 
     //   f_u = u;
     //   f_temp = temp;
@@ -1006,23 +1212,23 @@ void f(const FlowField& u, const FlowField& temp, const FlowField& salt, Real& T
             }*/
     }
 
-    if (!isfinite(L2Norm(f_u))) {
+    if (!isfinite(L2Norm(fields[0]))) {
         os << "error in f: f(u,t) is not finite. exiting." << endl;
         exit(1);
     }
-    if (!isfinite(L2Norm(f_temp))) {
+    if (activeScalar(temp) && !isfinite(L2Norm(fields[1]))) {
         os << "error in f: f(temp,t) is not finite. exiting." << endl;
         exit(1);
     }
-    if (!isfinite(L2Norm(f_salt))) {
+    if (activeScalar(salt) && !isfinite(L2Norm(fields[2]))) {
         os << "error in f: f(salt,t) is not finite. exiting." << endl;
         exit(1);
     }
 
     ++fcount;
     f_u = fields[0];
-    f_temp = fields[1];
-    f_salt = fields[2];
+    f_temp = activeScalar(temp) ? fields[1] : FlowField();
+    f_salt = activeScalar(salt) ? fields[2] : FlowField();
     return;
 }
 
@@ -60,6 +60,10 @@ string ddcfieldstats_t(const FlowField& u, const FlowField& temp, const FlowFiel
 FlowField totalVelocity(const FlowField& velo, const DDCFlags flags);
 FlowField totalTemperature(const FlowField& temp, const DDCFlags flags);
 FlowField totalSalinity(const FlowField& salt, const DDCFlags flags);
+// averages of the (0,0) profile of a total field over the partial layers [a, y_i] for all heights y_i at once,
+// integrated exactly with Chebyshev weights cached per grid and set of heights (e.g. for Nusselt profiles)
+std::vector<Real> layerAverages(const FlowField& ftot, const std::vector<Real>& y);
+// average of the total temperature/salinity over [a, flags.ystats]
 Real heatcontent(const FlowField& ttot, const DDCFlags flags);
 Real saltcontent(const FlowField& stot, const DDCFlags flags);
 
@@ -115,6 +119,10 @@ class ddcDSI : public cfDSI {
    protected:
     DDCFlags ddcflags_;
     ddc_continuationParameter ddc_cPar_ = ddc_continuationParameter::none;
+
+    // scalar fields of the DSI geometry, empty if the scalar is inactive in ddcflags_.system
+    FlowField newTemperature() const;
+    FlowField newSalinity() const;
 };
 
 // G(x) = G(u,sigma) = (sigma f^T(u) - u) for orbits
@@ -30,7 +30,16 @@ DDCFlags::DDCFlags(Real Rey_, Real Pr_, Real Ra_, Real Le_, Real Rrho_, Real Rse
       supperwall(supperwall_),
 
       
-      ystats(ystats_) {
+      ystats(ystats_),
+      solvercache(4),
+      system(ShearedDDC),
+      freeslip(false),
+      savestats(false),
+      freezevelocity(false),
+      imex(NoIMEX),
+      multirate(1),
+      multirateflow(false),
+      errortol(0) {
     
     ulowerwall = ulowerwall_;
     uupperwall = uupperwall_;
@@ -47,6 +56,9 @@ DDCFlags::DDCFlags(Real Rey_, Real Pr_, Real Ra_, Real Le_, Real Rrho_, Real Rse
 DDCFlags::DDCFlags(ArgList& args, const bool laurette) {
     // DDC system parameters
     args.section("System parameters");
+    const std::string system_ = args.getstr("-sys", "--system", "sheared",
+                                            "governing equations: sheared, stationarywall, movingwall, binaryfluid, "
+                                            "couette, stratifiedcouette, rbc");
     const Real Rey_ = args.getreal("-Rey", "--Reynolds", 400, "pseudo-Reynolds number == 1/nu");
     const Real Pr_ = args.getreal("-Pr", "--Prandtl", 10, "Prandtl number == nu/kpT");
     const Real Ra_ = args.getreal("-Ra", "--Rayleigh", 1000, "Thermal Rayleigh number");
@@ -56,6 +68,21 @@ DDCFlags::DDCFlags(ArgList& args, const bool laurette) {
     const Real Ri_ = args.getreal("-Ri", "--Richardson", 10, "Richardson number");
     const Real gammax_ = args.getreal("-GammaX", "--GammaX", 0, "Gamma angle in X");
     const Real gammaz_ = args.getreal("-GammaZ", "--GammaZ", 0, "Gamma angle in Z");
+    const bool freeslip_ = args.getflag("-freeslip", "--freeslip", "impose free-slip walls after every time step");
+    const bool savestats_ = args.getflag("-stats", "--savestats", "save horizontally averaged scalar profiles");
+    const bool freezevelocity_ =
+        args.getflag("-freezeu", "--freezevelocity", "keep the initial velocity and advance only the scalars");
+    const std::string imex_ = args.getstr("-imex", "--imex", "none",
+                                          "IMEX Runge-Kutta scheme with embedded error estimate, replaces "
+                                          "--timestepping: none, ars443, ars222");
+    const int multirate_ = args.getint("-mr", "--multirate", 1,
+                                       "> 1: multirate scheme, S takes mr substeps per step of dt "
+                                       "(IMEX Euler for u,T and S), 1: single rate");
+    const bool multirateflow_ =
+        args.getflag("-mrflow", "--multirateflow", "with -mr: u and T take the mr substeps instead of S");
+    const Real errortol_ = args.getreal("-etol", "--errortol", 0,
+                                        "> 0: adapt dt to keep the embedded error estimate of the IMEX scheme "
+                                        "below etol (PI control, bounded by dtmin, dtmax and CFLmax)");
     
     // define Channelflow boundary conditions from arglist
     args2BC(args);
@@ -72,9 +99,21 @@ DDCFlags::DDCFlags(ArgList& args, const bool laurette) {
                                              "symmetric subspace, argument is the filename for a file "
                                              "listing the generators of the isotropy group");
     const Real ystats_ = args.getreal("-ys", "--ystats", 0, "y-coordinate of height dependent statistics, e.g. Nu(y)");
-    
+    const int solvercache_ = args.getint("-scache", "--solvercache", 4,
+                                         "number of factorized solver sets kept in memory, one per time-stepping "
+                                         "constant, so that returning to an earlier dt needs no refactorization");
+
     // set flags
     ystats = ystats_;
+    solvercache = solvercache_;
+    system = s2ddcsystem(system_);
+    freeslip = freeslip_;
+    savestats = savestats_;
+    freezevelocity = freezevelocity_;
+    imex = s2imexscheme(imex_);
+    multirate = multirate_;
+    multirateflow = multirateflow_;
+    errortol = errortol_;
     Rey = Rey_;
     Pr = Pr_;
     Ra = Ra_;
@@ -150,7 +189,15 @@ void DDCFlags::save(const std::string& savedir) const {
            << std::setw(REAL_IOWIDTH) << tlowerwall << "  %tlowerwall\n"
            << std::setw(REAL_IOWIDTH) << supperwall << "  %supperwall\n"
            << std::setw(REAL_IOWIDTH) << slowerwall << "  %slowerwall\n"
-           << std::setw(REAL_IOWIDTH) << ystats << "  %ystats\n";
+           << std::setw(REAL_IOWIDTH) << ystats << "  %ystats\n"
+           << std::setw(REAL_IOWIDTH) << ddcsystem2s(system) << "  %system\n"
+           << std::setw(REAL_IOWIDTH) << imexscheme2s(imex) << "  %imex\n"
+           << std::setw(REAL_IOWIDTH) << multirate << "  %multirate\n"
+           << std::setw(REAL_IOWIDTH) << multirateflow << "  %multirateflow\n"
+           << std::setw(REAL_IOWIDTH) << errortol << "  %errortol\n"
+           << std::setw(REAL_IOWIDTH) << freeslip << "  %freeslip\n"
+           << std::setw(REAL_IOWIDTH) << savestats << "  %savestats\n"
+           << std::setw(REAL_IOWIDTH) << freezevelocity << "  %freezevelocity\n";
         os.unsetf(std::ios::left);
     }
 }
@@ -181,6 +228,158 @@ void DDCFlags::load(int taskid, const std::string indir) {
     supperwall = getRealfromLine(taskid, is);
     slowerwall = getRealfromLine(taskid, is);
     ystats = getRealfromLine(taskid, is);
+    // files written before the system was selectable at runtime end here and keep the default system
+    const std::string system_ = getStringfromLine(taskid, is);
+    if (system_.length() > 0)
+        system = s2ddcsystem(system_);
+    const std::string imex_ = getStringfromLine(taskid, is);
+    if (imex_.length() > 0)
+        imex = s2imexscheme(imex_);
+    const std::string multirate_ = getStringfromLine(taskid, is);
+    if (multirate_.length() > 0)
+        multirate = std::stoi(multirate_);
+    const std::string multirateflow_ = getStringfromLine(taskid, is);
+    if (multirateflow_.length() > 0)
+        multirateflow = std::stoi(multirateflow_) != 0;
+    const std::string errortol_ = getStringfromLine(taskid, is);
+    if (errortol_.length() > 0)
+        errortol = std::stod(errortol_);
+    // the options that replaced the macros FREESLIP, SAVESTATS and FREEZEvelocity
+    const std::string freeslip_ = getStringfromLine(taskid, is);
+    if (freeslip_.length() > 0)
+        freeslip = std::stoi(freeslip_) != 0;
+    const std::string savestats_ = getStringfromLine(taskid, is);
+    if (savestats_.length() > 0)
+        savestats = std::stoi(savestats_) != 0;
+    const std::string freezevelocity_ = getStringfromLine(taskid, is);
+    if (freezevelocity_.length() > 0)
+        freezevelocity = std::stoi(freezevelocity_) != 0;
+}
+
+DDCSystem s2ddcsystem(const std::string& s) {
+    if (s == "sheared")
+        return ShearedDDC;
+    else if (s == "stationarywall")
+        return StationaryWallDDC;
+    else if (s == "movingwall")
+        return MovingWallDDC;
+    else if (s == "binaryfluid")
+        return BinaryFluid;
+    else if (s == "couette")
+        return Couette;
+    else if (s == "stratifiedcouette")
+        return StratifiedCouette;
+    else if (s == "rbc")
+        return RayleighBenard;
+    else
+        cferror("s2ddcsystem(string): unknown DDC system " + s);
+    return ShearedDDC;
+}
+
+std::string ddcsystem2s(DDCSystem system) {
+    switch (system) {
+        case ShearedDDC:
+            return "sheared";
+        case StationaryWallDDC:
+            return "stationarywall";
+        case MovingWallDDC:
+            return "movingwall";
+        case BinaryFluid:
+            return "binaryfluid";
+        case Couette:
+            return "couette";
+        case StratifiedCouette:
+            return "stratifiedcouette";
+        case RayleighBenard:
+            return "rbc";
+        default:
+            cferror("ddcsystem2s(DDCSystem): unknown DDC system");
+    }
+    return "";
+}
+
+DDCIMEXScheme s2imexscheme(const std::string& s) {
+    if (s == "none")
+        return NoIMEX;
+    else if (s == "ars443")
+        return ARS443;
+    else if (s == "ars222")
+        return ARS222;
+    else
+        cferror("s2imexscheme(string): unknown IMEX scheme " + s);
+    return NoIMEX;
+}
+
+std::string imexscheme2s(DDCIMEXScheme scheme) {
+    switch (scheme) {
+        case NoIMEX:
+            return "none";
+        case ARS443:
+            return "ars443";
+        case ARS222:
+            return "ars222";
+        default:
+            cferror("imexscheme2s(DDCIMEXScheme): unknown IMEX scheme");
+    }
+    return "";
+}
+
+DDCCoefficients DDCFlags::coefficients() const {
+    DDCCoefficients c = {0, 0, 0, 0, 0, 0, 0, false, false, false};
+    switch (system) {
+        case ShearedDDC:  // velocity is normalized by boundary velocity Ub
+            c.p1 = 1.0 / Rey;
+            c.p2 = Ri / (Rrho - 1);
+            c.p3 = 1.0;
+            c.p4 = Rrho;
+            c.p5 = 1.0 / (Rey * Pr);
+            c.p6 = 1.0 / (Le * Rey * Pr);
+            break;
+        case StationaryWallDDC:
+            c.p1 = Pr;
+            c.p2 = Pr * Ra;
+            c.p3 = 1.0;
+            c.p4 = 1.0 / Rrho;
+            c.p5 = 1.0;
+            c.p6 = 1.0 / Le;
+            break;
+        case MovingWallDDC:  // wall's boundary velocity is normalized into unit velocity, e.g. Ua=-0.5 Ub=0.5
+            c.p1 = sqrt(Pr / Ra);
+            c.p2 = Ri / (Rrho - 1);
+            c.p3 = 1.0;
+            c.p4 = Rrho;
+            c.p5 = 1.0 / sqrt(Pr * Ra);
+            c.p6 = 1.0 / (Le * sqrt(Pr * Ra));
+            break;
+        case BinaryFluid:
+            c.p1 = Pr;
+            c.p2 = Pr * Ra;
+            c.p3 = 1.0 + Rsep;
+            c.p4 = Rsep;
+            c.p5 = 1.0;
+            c.p6 = 1.0 / Le;
+            c.p7 = 1.0;
+            break;
+        case Couette:
+            c.p1 = 1.0 / Rey;
+            break;
+        case StratifiedCouette:
+            c.p1 = 1.0 / Rey;
+            c.p2 = -1.0;
+            c.p3 = Ri;
+            c.p5 = 1.0 / (Rey * Pr);
+            break;
+        case RayleighBenard:
+            c.p1 = sqrt(Pr / Ra);
+            c.p2 = 1.0;
+            c.p3 = 1.0;
+            c.p5 = 1.0 / sqrt(Pr * Ra);
+            break;
+    }
+    c.temperature = (c.p5 != 0);
+    c.salinity = (c.p6 != 0);
+    c.crossdiffusion = c.salinity && c.temperature && (c.p7 != 0);
+    return c;
 }
 
 }  // namespace chflow
@@ -14,6 +14,55 @@
 
 namespace chflow {
 
+/** \brief governing equations of a double-component system
+ *
+ * All systems have the form
+ * Momentum equation (variable U, P):           dt(U) + (U*grad)U = - grad(P) + p1*lap(U) + p2*(p3*T-p4*S)*eg
+ * First component's equation (variable T):     dt(T) + (U*grad)T =             p5*lap(T)
+ * Second component's equation (variable S):    dt(S) + (U*grad)S =             p6*lap(S) + p7*lap(T)
+ * where U = Ubase + u is the total velocity and eg = sin(gammax)*ex + cos(gammax)*ey.
+ */
+enum DDCSystem {
+    ShearedDDC,         // sheared DDC, velocity normalized by the wall velocity Ub
+    StationaryWallDDC,  // stationary-wall bounded DDC [Yang2016PNAS]
+    MovingWallDDC,      // moving-wall bounded DDC, free-fall velocity scale [Yang2021JFM]
+    BinaryFluid,        // binary fluid convection with Soret effect [Mercader2013JFM]
+    Couette,            // plane Couette flow without scalars
+    StratifiedCouette,  // stratified plane Couette flow [Langham2019JFM]
+    RayleighBenard      // Rayleigh-Benard convection [Zheng2024JFM]
+};
+
+/** \brief coefficients p1..p7 of a DDCSystem for given control parameters
+ *
+ * Coefficients of inactive equations are zero. The activity flags select the specialization of the
+ * DDE kernels, they are never tested inside the loops over grid points or Fourier modes.
+ */
+struct DDCCoefficients {
+    Real p1, p2, p3, p4, p5, p6, p7;
+    bool temperature;     // T equation is integrated (p5 != 0)
+    bool salinity;        // S equation is integrated (p6 != 0)
+    bool crossdiffusion;  // S equation contains p7*lap(T)
+};
+
+DDCSystem s2ddcsystem(const std::string& s);
+std::string ddcsystem2s(DDCSystem system);
+
+/** \brief additive IMEX Runge-Kutta schemes of IMEXRungeKuttaDDC
+ *
+ * The nonlinear terms are integrated by the explicit, the linear terms by the implicit tableau. Both schemes
+ * have a single implicit diagonal coefficient, i.e. one solver set per dt, an embedded lower order solution
+ * for error control and are stiffly accurate in both tableaux, so the new fields are the last stage, which
+ * satisfies the boundary conditions and is divergence-free.
+ */
+enum DDCIMEXScheme {
+    NoIMEX,  // use flags.timestepping
+    ARS443,  // ARS(4,4,3), 3rd order, 4 implicit stages [Ascher, Ruuth & Spiteri 1997]
+    ARS222   // ARS(2,2,2), 2nd order, 2 implicit stages [Ascher, Ruuth & Spiteri 1997]
+};
+
+DDCIMEXScheme s2imexscheme(const std::string& s);
+std::string imexscheme2s(DDCIMEXScheme scheme);
+
 /** \brief extension of the DNSFlags class for DDC
  *
  * DDCFlags class, holds all additional parameters for convective shear flows
@@ -53,6 +102,20 @@ class DDCFlags : public DNSFlags {
 
     Real ystats;
 
+    int solvercache;  // number of factorized solver sets (one per time-stepping constant) kept by DDE
+
+    DDCSystem system;     // governing equations, see DDCSystem
+    bool freeslip;        // impose free-slip walls after every time step
+    bool savestats;       // save horizontally averaged scalar profiles (needs salinity)
+    bool freezevelocity;  // keep the velocity fixed at its initial value and only advance the scalars
+    DDCIMEXScheme imex;   // IMEX Runge-Kutta scheme, replaces flags.timestepping unless NoIMEX
+    int multirate;        // > 1: MultirateDDC, one of u,T and S takes multirate substeps per step of dt
+    bool multirateflow;   // with multirate: u,T take the substeps instead of S
+    Real errortol;        // > 0: error-controlled time steps of the IMEX scheme, see DDC::advanceAdaptive
+
+    // coefficients p1..p7 of the governing equations for the current parameters
+    DDCCoefficients coefficients() const;
+
     cfarray<FieldSymmetry> tempsymmetries;  // restrict temp(t) to these symmetries
     cfarray<FieldSymmetry> saltsymmetries;
     
@@ -0,0 +1,301 @@
+/**
+ * In-situ extraction of planes and lines of DDC fields
+ */
+
+#include "modules/ddc/ddcslices.h"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+#ifdef HAVE_NETCDF_H
+#include <netcdf.h>
+#endif
+#include "modules/ddc/dde.h"
+#include "modules/ddc/ddcwriter.h"
+
+namespace chflow {
+
+namespace {
+
+#ifdef HAVE_NETCDF_H
+void nccheck(int status, const std::string& what) {
+    if (status != NC_NOERR)
+        cferror("DDCSlices: " + what + ": " + nc_strerror(status));
+}
+#endif
+
+// nearest point of the periodic grid n * L / N
+int periodicIndex(Real x, Real L, int N) {
+    const int n = int(std::lround(x / L * N)) % N;
+    return n < 0 ? n + N : n;
+}
+
+}  // namespace
+
+DDCSlices::DDCSlices(const std::string& filebase, const std::vector<std::string>& specs,
+                     const std::vector<FlowField>& fields, const DDCFlags& flags, bool total, bool append)
+    : filename_(filebase + ".nc"),
+      slicesize_(0),
+      temperature_(false),
+      salinity_(false),
+      total_(total),
+      Vsuck_(flags.Vsuck),
+      taskid_(fields[0].taskid()),
+      ncid_(-1),
+      timevar_(-1),
+      nrecords_(0) {
+#ifdef HAVE_NETCDF_H
+    const FlowField& u = fields[0];
+    const int N[3] = {u.Nx(), u.Ny(), u.Nz()};
+    const char* axes = "xyz";
+
+    const DDCCoefficients c = flags.coefficients();
+    temperature_ = c.temperature && fields[1].Nd() > 0;
+    salinity_ = c.salinity && fields[2].Nd() > 0;
+    quantities_ = {"u", "v", "w"};
+    if (temperature_)
+        quantities_.push_back("T");
+    if (salinity_)
+        quantities_.push_back("S");
+
+    // fixed coordinates of the slices, e.g. "x=1,z=0.5"
+    for (const std::string& spec : specs) {
+        Slice slice;
+        slice.spec = spec;
+        slice.fixed[0] = slice.fixed[1] = slice.fixed[2] = -1;
+        std::stringstream ss(spec);
+        std::string token;
+        while (std::getline(ss, token, ',')) {
+            const size_t eq = token.find('=');
+            const std::string axis = token.substr(0, eq);
+            if (eq == std::string::npos || axis.size() != 1 || std::string(axes).find(axis) == std::string::npos)
+                cferror("DDCSlices: cannot parse the slice " + spec + ", expected e.g. z=0.5 or x=1,z=0.5");
+            const Real value = atof(token.c_str() + eq + 1);
+            if (axis == "x")
+                slice.fixed[0] = periodicIndex(value, u.Lx(), N[0]);
+            else if (axis == "z")
+                slice.fixed[2] = periodicIndex(value, u.Lz(), N[2]);
+            else {
+                slice.fixed[1] = 0;
+                for (int ny = 1; ny < N[1]; ++ny)
+                    if (std::abs(u.y(ny) - value) < std::abs(u.y(slice.fixed[1]) - value))
+                        slice.fixed[1] = ny;
+            }
+        }
+        slice.size = 1;
+        for (int d = 0; d < 3; ++d)
+            if (slice.fixed[d] < 0) {
+                slice.free.push_back(d);
+                slice.size *= N[d];
+            }
+        if (slice.free.empty() || slice.free.size() == 3)
+            cferror("DDCSlices: the slice " + spec + " must fix one (plane) or two (line) coordinates");
+        slice.offset = slicesize_;
+        slicesize_ += slice.size;
+        slices_.push_back(slice);
+    }
+
+    // base profiles at the y grid points
+    if (total_) {
+        const std::shared_ptr<const DDCBaseFlow> base = ddcBaseFlow(u.Ny(), u.a(), u.b(), flags);
+        const ChebyCoeff* profiles[4] = {&base->U, &base->W, &base->T, &base->S};
+        std::vector<Real>* values[4] = {&Ubase_, &Wbase_, &Tbase_, &Sbase_};
+        for (int i = 0; i < 4; ++i) {
+            ChebyCoeff p = *profiles[i];
+            p.makePhysical();
+            values[i]->resize(N[1]);
+            for (int ny = 0; ny < N[1]; ++ny)
+                (*values[i])[ny] = p[ny];
+        }
+    }
+
+    u_ = FlowField(N[0], N[1], N[2], 3, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi());
+    if (temperature_)
+        temp_ = FlowField(N[0], N[1], N[2], 1, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi());
+    if (salinity_)
+        salt_ = FlowField(N[0], N[1], N[2], 1, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi());
+    buf_.resize(quantities_.size() * slicesize_);
+
+    // the first process defines the stream (or opens the stream of a restarted run) and keeps it open
+    if (taskid_ == 0 && append && std::ifstream(filename_.c_str()).good()) {
+        std::lock_guard<std::recursive_mutex> io(ddcIOMutex());  // NetCDF is not thread-safe
+        nccheck(nc_open(filename_.c_str(), NC_WRITE, &ncid_), "open " + filename_);
+        int tdim, totalattr;
+        size_t len;
+        nccheck(nc_inq_dimid(ncid_, "time", &tdim), "read " + filename_);
+        nccheck(nc_inq_dimlen(ncid_, tdim, &len), "read " + filename_);
+        nccheck(nc_inq_varid(ncid_, "time", &timevar_), "read " + filename_);
+        nccheck(nc_get_att_int(ncid_, NC_GLOBAL, "total", &totalattr), "read attributes");
+        nrecords_ = len;
+        for (int d = 0; d < 3; ++d) {
+            int dim;
+            nccheck(nc_inq_dimid(ncid_, std::string(1, axes[d]).c_str(), &dim), "read " + filename_);
+            nccheck(nc_inq_dimlen(ncid_, dim, &len), "read " + filename_);
+            if (int(len) != N[d])
+                cferror("DDCSlices: the grid of " + filename_ + " differs from the grid of the fields");
+        }
+        if (bool(totalattr) != total_)
+            cferror("DDCSlices: " + filename_ + " holds " + (totalattr ? "total" : "fluctuating") + " fields");
+        for (uint n = 0; n < slices_.size(); ++n) {
+            Slice& slice = slices_[n];
+            for (const std::string& q : quantities_) {
+                const std::string name = "slice" + i2s(n) + "_" + q;
+                int varid;
+                size_t speclen;
+                if (nc_inq_varid(ncid_, name.c_str(), &varid) != NC_NOERR ||
+                    nc_inq_attlen(ncid_, varid, "slice", &speclen) != NC_NOERR)
+                    cferror("DDCSlices: " + filename_ + " has no variable " + name + " to append " + slice.spec);
+                std::string spec(speclen, ' ');
+                nccheck(nc_get_att_text(ncid_, varid, "slice", &spec[0]), "read attributes");
+                if (spec != slice.spec)
+                    cferror("DDCSlices: " + name + " of " + filename_ + " is the slice " + spec + ", not " + slice.spec);
+                slice.varids.push_back(varid);
+            }
+        }
+    } else if (taskid_ == 0) {
+        std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+        nccheck(nc_create(filename_.c_str(), NC_CLOBBER | NC_NETCDF4, &ncid_), "create " + filename_);
+        int tdim, dims[3], coordvars[3];
+        nccheck(nc_def_dim(ncid_, "time", NC_UNLIMITED, &tdim), "define time");
+        nccheck(nc_def_var(ncid_, "time", NC_DOUBLE, 1, &tdim, &timevar_), "define time");
+        for (int d = 0; d < 3; ++d) {
+            const std::string axis(1, axes[d]);
+            nccheck(nc_def_dim(ncid_, axis.c_str(), N[d], &dims[d]), "define " + axis);
+            nccheck(nc_def_var(ncid_, axis.c_str(), NC_DOUBLE, 1, &dims[d], &coordvars[d]), "define " + axis);
+        }
+        const int totalattr = total_;
+        nccheck(nc_put_att_int(ncid_, NC_GLOBAL, "total", NC_INT, 1, &totalattr), "write attributes");
+        for (uint n = 0; n < slices_.size(); ++n) {
+            Slice& slice = slices_[n];
+            std::vector<int> vardims = {tdim};
+            for (int d : slice.free)
+                vardims.push_back(dims[d]);
+            for (const std::string& q : quantities_) {
+                const std::string name = "slice" + i2s(n) + "_" + q;
+                int varid;
+                nccheck(nc_def_var(ncid_, name.c_str(), NC_FLOAT, vardims.size(), vardims.data(), &varid),
+                        "define " + name);
+                nccheck(nc_put_att_text(ncid_, varid, "slice", slice.spec.size(), slice.spec.c_str()),
+                        "write attributes");
+                for (int d = 0; d < 3; ++d)
+                    if (slice.fixed[d] >= 0) {
+                        const Real coord = d == 0 ? u.x(slice.fixed[d]) : d == 1 ? u.y(slice.fixed[d])
+                                                                                 : u.z(slice.fixed[d]);
+                        nccheck(nc_put_att_double(ncid_, varid, std::string(1, axes[d]).c_str(), NC_DOUBLE, 1,
+                                                  &coord),
+                                "write attributes");
+                    }
+                slice.varids.push_back(varid);
+            }
+        }
+        nccheck(nc_enddef(ncid_), "define " + filename_);
+        for (int d = 0; d < 3; ++d) {
+            std::vector<Real> coords(N[d]);
+            for (int n = 0; n < N[d]; ++n)
+                coords[n] = d == 0 ? u.x(n) : d == 1 ? u.y(n) : u.z(n);
+            nccheck(nc_put_var_double(ncid_, coordvars[d], coords.data()), "write coordinates");
+        }
+    }
+#ifdef HAVE_MPI
+    if (u.numtasks() > 1)
+        MPI_Bcast(&nrecords_, 1, MPI_INT, 0, *u.comm_world());
+#endif
+#else
+    cferror("DDCSlices: channelflow is built without NetCDF (WITH_NETCDF=OFF)");
+#endif
+}
+
+DDCSlices::~DDCSlices() {
+#ifdef HAVE_NETCDF_H
+    if (ncid_ >= 0) {
+        std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+        nc_close(ncid_);
+    }
+#endif
+}
+
+void DDCSlices::extract(const std::vector<FlowField>& fields, Real t) {
+#ifdef HAVE_NETCDF_H
+    // physical fields in the reused buffers
+    const int nq = quantities_.size();
+    u_ = fields[0];
+    u_.makePhysical();
+    if (temperature_) {
+        temp_ = fields[1];
+        temp_.makePhysical();
+    }
+    if (salinity_) {
+        salt_ = fields[2];
+        salt_.makePhysical();
+    }
+
+    // local points of all slices, the others stay zero for the reduction
+    const lint nxmin = u_.nxlocmin(), nxmax = u_.nxlocmin() + u_.Nxloc();
+    const lint nymin = u_.nylocmin(), nymax = u_.nylocmax();
+    const int N[3] = {u_.Nx(), u_.Ny(), u_.Nz()};
+    std::fill(buf_.begin(), buf_.end(), 0.0);
+    for (const Slice& slice : slices_) {
+        const int d0 = slice.free[0];
+        const int n1 = slice.free.size() > 1 ? N[slice.free[1]] : 1;
+        for (lint k = 0; k < slice.size; ++k) {
+            int n[3] = {slice.fixed[0], slice.fixed[1], slice.fixed[2]};
+            n[d0] = k / n1;
+            if (slice.free.size() > 1)
+                n[slice.free[1]] = k % n1;
+            if (n[0] < nxmin || n[0] >= nxmax || n[1] < nymin || n[1] >= nymax)
+                continue;
+            Real* p = &buf_[slice.offset + k];
+            p[0] = u_(n[0], n[1], n[2], 0);
+            p[slicesize_] = u_(n[0], n[1], n[2], 1);
+            p[2 * slicesize_] = u_(n[0], n[1], n[2], 2);
+            int q = 3;
+            if (temperature_)
+                p[q++ * slicesize_] = temp_(n[0], n[1], n[2], 0);
+            if (salinity_)
+                p[q * slicesize_] = salt_(n[0], n[1], n[2], 0);
+            if (total_) {
+                p[0] += Ubase_[n[1]];
+                p[slicesize_] -= Vsuck_;
+                p[2 * slicesize_] += Wbase_[n[1]];
+                q = 3;
+                if (temperature_)
+                    p[q++ * slicesize_] += Tbase_[n[1]];
+                if (salinity_)
+                    p[q * slicesize_] += Sbase_[n[1]];
+            }
+        }
+    }
+#ifdef HAVE_MPI
+    if (u_.numtasks() > 1) {
+        if (taskid_ == 0)
+            MPI_Reduce(MPI_IN_PLACE, buf_.data(), buf_.size(), MPI_DOUBLE, MPI_SUM, 0, *u_.comm_world());
+        else
+            MPI_Reduce(buf_.data(), NULL, buf_.size(), MPI_DOUBLE, MPI_SUM, 0, *u_.comm_world());
+    }
+#endif
+
+    if (taskid_ == 0) {
+        std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+        for (const Slice& slice : slices_) {
+            std::vector<size_t> start = {size_t(nrecords_)}, count = {1};
+            for (int d : slice.free) {
+                start.push_back(0);
+                count.push_back(N[d]);
+            }
+            for (int q = 0; q < nq; ++q)
+                nccheck(nc_put_vara_double(ncid_, slice.varids[q], start.data(), count.data(),
+                                           &buf_[q * slicesize_ + slice.offset]),
+                        "write " + slice.spec);
+        }
+        const size_t start = nrecords_, count = 1;
+        nccheck(nc_put_vara_double(ncid_, timevar_, &start, &count, &t), "write time");
+        nccheck(nc_sync(ncid_), "write " + filename_);
+    }
+    ++nrecords_;
+#endif
+}
+
+}  // namespace chflow
@@ -0,0 +1,69 @@
+/**
+ * In-situ extraction of planes and lines of DDC fields
+ *
+ * DDCSlices samples the physical-space fields on a few planes and lines while the simulation runs and
+ * appends them to one NetCDF stream, instead of saving full 3d fields for visualization.
+ */
+
+#ifndef DDCSLICES_H
+#define DDCSLICES_H
+
+#include <string>
+#include <vector>
+#include "channelflow/flowfield.h"
+#include "modules/ddc/ddcflags.h"
+
+namespace chflow {
+
+/** \brief planes and lines of u, v, w, T and S appended to filebase.nc
+ *
+ * A slice is given by its fixed coordinates, e.g. "z=0.5" (x-y plane), "x=1" (y-z plane), "y=-0.4"
+ * (wall-parallel plane), "x=1,z=0.5" (line along y), "y=0,z=0.5" (line along x), "x=1,y=0" (line along z).
+ * Fixed coordinates are taken at the nearest grid point. The file has the unlimited dimension time, one
+ * single-precision variable per slice and quantity (slice0_u, slice0_T, ...) and the grid coordinates x, y, z.
+ * extract is collective, the first process gathers the slices with one reduction and writes them.
+ * A restarted run appends to the existing file, which must hold the same slices.
+ */
+class DDCSlices {
+   public:
+    // total: add the base profiles of flags to the fluctuations of the fields
+    // append: continue an existing filebase.nc (e.g. for flags.t0 > 0) instead of replacing it
+    DDCSlices(const std::string& filebase, const std::vector<std::string>& specs, const std::vector<FlowField>& fields,
+              const DDCFlags& flags, bool total = false, bool append = false);
+    DDCSlices(const DDCSlices&) = delete;
+    DDCSlices& operator=(const DDCSlices&) = delete;
+    ~DDCSlices();
+
+    // samples all slices of fields = {u, T, S, ...} and appends them as the record of time t
+    void extract(const std::vector<FlowField>& fields, Real t);
+
+    inline int numRecords() const { return nrecords_; }
+
+   private:
+    struct Slice {
+        std::string spec;
+        int fixed[3];            // grid index of the fixed x, y, z, -1 for the free directions
+        std::vector<int> free;   // free directions, 0 = x, 1 = y, 2 = z
+        lint size;               // number of points
+        lint offset;             // of the slice in the packed buffer of one quantity
+        std::vector<int> varids; // one per quantity
+    };
+
+    std::string filename_;
+    std::vector<Slice> slices_;
+    std::vector<std::string> quantities_;  // u, v, w and the active scalars
+    lint slicesize_;                       // points of all slices
+    bool temperature_, salinity_;          // T, S are extracted
+    bool total_;
+    Real Vsuck_;
+    std::vector<Real> Ubase_, Wbase_, Tbase_, Sbase_;  // base profiles on the y grid, added if total_
+    FlowField u_, temp_, salt_;                        // physical-space buffers
+    std::vector<Real> buf_;                            // [quantity][slice points], reduced at once
+    int taskid_;
+    int ncid_;
+    int timevar_;
+    int nrecords_;
+};
+
+}  // namespace chflow
+#endif
@@ -0,0 +1,607 @@
+/**
+ * Combined state file of the DDC module
+ */
+
+#include "modules/ddc/ddcstate.h"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+#ifdef HAVE_NETCDF_H
+#include <netcdf.h>
+#endif
+#ifdef HAVE_NETCDF_PAR_H
+#include <netcdf_par.h>
+#endif
+#include "modules/ddc/dde.h"
+#include "modules/ddc/ddcwriter.h"
+
+namespace chflow {
+
+namespace {
+
+const int stateversion = 1;  // value of the global attribute "ddcstate"
+
+std::string stateFilename(const std::string& filebase) {
+    const std::string ext(".nc");
+    if (filebase.size() >= ext.size() && filebase.compare(filebase.size() - ext.size(), ext.size(), ext) == 0)
+        return filebase;
+    return filebase + ext;
+}
+
+// splits "name:n" into the file name and the record n of a time series, record is -1 without ":n"
+std::string splitRecord(const std::string& name, int& record) {
+    record = -1;
+    const size_t colon = name.rfind(':');
+    if (colon == std::string::npos || colon + 1 == name.size() ||
+        name.find_first_not_of("0123456789", colon + 1) != std::string::npos)
+        return stateFilename(name);
+    record = atoi(name.c_str() + colon + 1);
+    return stateFilename(name.substr(0, colon));
+}
+
+void checkSpectral(const std::vector<FlowField>& fields) {
+    assert(fields.size() >= 3);
+    for (uint i = 0; i < fields.size(); ++i)
+        if (fields[i].Nd() > 0 && fields[i].xzstate() != Spectral)
+            cferror("DDC state file: fields must be in spectral state in x and z");
+}
+
+#ifdef HAVE_NETCDF_H
+
+void nccheck(int status, const std::string& what) {
+    if (status != NC_NOERR)
+        cferror("DDC state file: " + what + ": " + nc_strerror(status));
+}
+
+// parameters of DDCFlags stored as double attributes
+struct FlagAttribute {
+    const char* name;
+    Real DDCFlags::*value;
+};
+
+std::vector<FlagAttribute> flagAttributes() {
+    return {{"Rey", &DDCFlags::Rey},
+            {"Pr", &DDCFlags::Pr},
+            {"Ra", &DDCFlags::Ra},
+            {"Le", &DDCFlags::Le},
+            {"Rrho", &DDCFlags::Rrho},
+            {"Rsep", &DDCFlags::Rsep},
+            {"Ri", &DDCFlags::Ri},
+            {"gammax", &DDCFlags::gammax},
+            {"gammaz", &DDCFlags::gammaz},
+            {"ulowerwall", &DDCFlags::ulowerwall},
+            {"uupperwall", &DDCFlags::uupperwall},
+            {"wlowerwall", &DDCFlags::wlowerwall},
+            {"wupperwall", &DDCFlags::wupperwall},
+            {"tlowerwall", &DDCFlags::tlowerwall},
+            {"tupperwall", &DDCFlags::tupperwall},
+            {"slowerwall", &DDCFlags::slowerwall},
+            {"supperwall", &DDCFlags::supperwall},
+            {"ystats", &DDCFlags::ystats},
+            {"Vsuck", &DDCFlags::Vsuck},
+            {"dPdx", &DDCFlags::dPdx},
+            {"dPdz", &DDCFlags::dPdz},
+            {"Ubulk", &DDCFlags::Ubulk},
+            {"Wbulk", &DDCFlags::Wbulk},
+            {"nu", &DDCFlags::nu},
+            {"dt", &DDCFlags::dt}};
+}
+
+const char* fieldNames[4] = {"velocity", "temperature", "salinity", "pressure"};
+const char* baseNames[4] = {"Ubase", "Wbase", "Tbase", "Sbase"};
+const int timevar = 8;  // index of the time variable of a series in the variable ids, after fields and base
+
+// the scalars of inactive equations are left out
+std::vector<bool> storedFields(const std::vector<FlowField>& fields, const DDCFlags& flags) {
+    const DDCCoefficients c = flags.coefficients();
+    std::vector<bool> stored(std::min<size_t>(fields.size(), 4));
+    for (uint i = 0; i < stored.size(); ++i)
+        stored[i] = fields[i].Nd() > 0 && (i != 1 || c.temperature) && (i != 2 || c.salinity);
+    return stored;
+}
+
+// parallel NetCDF needs the communicator of the fields, serial runs without CfMPI use sequential I/O
+bool parallelIO(CfMPI* cfmpi) {
+#ifdef HAVE_NETCDF_PAR_H
+    return cfmpi != NULL;
+#else
+    return false;
+#endif
+}
+
+void barrier(const FlowField& u) {
+#ifdef HAVE_MPI
+    if (u.numtasks() > 1)
+        MPI_Barrier(*u.comm_world());
+#endif
+}
+
+// local Fourier modes of f, packed as [i][mx][ny][mz][re,im] like the hyperslab of the file
+void packModes(const FlowField& f, std::vector<Real>& buf) {
+    buf.resize(2 * f.Nd() * f.Mxloc() * f.Ny() * f.Mzloc());
+    lint n = 0;
+    for (int i = 0; i < f.Nd(); ++i)
+        for (lint mx = f.mxlocmin(); mx < f.mxlocmin() + f.Mxloc(); ++mx)
+            for (int ny = 0; ny < f.Ny(); ++ny)
+                for (lint mz = f.mzlocmin(); mz < f.mzlocmin() + f.Mzloc(); ++mz) {
+                    const Complex c = f.cmplx(mx, ny, mz, i);
+                    buf[n++] = c.real();
+                    buf[n++] = c.imag();
+                }
+}
+
+void unpackModes(const std::vector<Real>& buf, FlowField& f) {
+    lint n = 0;
+    for (int i = 0; i < f.Nd(); ++i)
+        for (lint mx = f.mxlocmin(); mx < f.mxlocmin() + f.Mxloc(); ++mx)
+            for (int ny = 0; ny < f.Ny(); ++ny)
+                for (lint mz = f.mzlocmin(); mz < f.mzlocmin() + f.Mzloc(); ++mz) {
+                    f.cmplx(mx, ny, mz, i) = Complex(buf[n], buf[n + 1]);
+                    n += 2;
+                }
+}
+
+// rounds buf to multiples of the largest power of two q with q/2 <= tolerance, see DDCPrecision
+void quantize(std::vector<Real>& buf, Real tolerance) {
+    if (tolerance <= 0)
+        return;
+    const Real q = std::ldexp(1.0, int(std::floor(std::log2(2 * tolerance))));
+    for (Real& v : buf)
+        v = q * std::round(v / q);
+}
+
+/* hyperslab of the local modes of fields[i] in its variable, the velocity has the leading dimension vcomp
+ * and the records of a time series (record >= 0) the leading dimension time
+ */
+void modeSlab(const FlowField& f, int i, int record, std::vector<size_t>& start, std::vector<size_t>& count) {
+    start = {size_t(f.mxlocmin()), 0, size_t(f.mzlocmin()), 0};
+    count = {size_t(f.Mxloc()), size_t(f.Ny()), size_t(f.Mzloc()), 2};
+    if (i == 0) {
+        start.insert(start.begin(), 0);
+        count.insert(count.begin(), size_t(f.Nd()));
+    }
+    if (record >= 0) {
+        start.insert(start.begin(), size_t(record));
+        count.insert(count.begin(), 1);
+    }
+}
+
+/* defines dimensions, variables and attributes, the returned vector holds the variable ids of fields, base
+ * and time. A time series has the unlimited dimension time and is chunked by records, a state file has the
+ * attribute time instead.
+ */
+std::vector<int> defineState(int ncid, const std::vector<FlowField>& fields, const std::vector<bool>& stored, Real t,
+                             const DDCFlags& flags, const DDCPrecision& precision, bool base, bool series) {
+    const FlowField& u = fields[0];
+    int tdim = -1, mxdim, nydim, mzdim, cdim, vdim;
+    if (series)
+        nccheck(nc_def_dim(ncid, "time", NC_UNLIMITED, &tdim), "define time");
+    nccheck(nc_def_dim(ncid, "mx", u.Mx(), &mxdim), "define mx");
+    nccheck(nc_def_dim(ncid, "ny", u.Ny(), &nydim), "define ny");
+    nccheck(nc_def_dim(ncid, "mz", u.Mz(), &mzdim), "define mz");
+    nccheck(nc_def_dim(ncid, "complex", 2, &cdim), "define complex");
+    nccheck(nc_def_dim(ncid, "vcomp", u.Nd(), &vdim), "define vcomp");
+
+    std::vector<int> varids(timevar + 1, -1);
+    if (series)
+        nccheck(nc_def_var(ncid, "time", NC_DOUBLE, 1, &tdim, &varids[timevar]), "define time");
+    for (uint i = 0; i < stored.size(); ++i) {
+        if (!stored[i])
+            continue;
+        std::vector<int> dims = {mxdim, nydim, mzdim, cdim};
+        std::vector<size_t> chunks = {size_t(u.Mx()), size_t(u.Ny()), size_t(u.Mz()), 2};
+        if (i == 0) {
+            dims.insert(dims.begin(), vdim);
+            chunks.insert(chunks.begin(), size_t(u.Nd()));
+        }
+        if (series) {
+            dims.insert(dims.begin(), tdim);
+            chunks.insert(chunks.begin(), 1);
+        }
+        const Real tolerance = precision.tolerance[i];
+        nccheck(nc_def_var(ncid, fieldNames[i], tolerance < 0 ? NC_FLOAT : NC_DOUBLE, dims.size(), dims.data(),
+                           &varids[i]),
+                "define field");
+        if (series || tolerance != 0)  // one record per chunk, so that a record is appended or read in one piece
+            nccheck(nc_def_var_chunking(ncid, varids[i], NC_CHUNKED, chunks.data()), "define chunks");
+        if (tolerance != 0) {
+            nccheck(nc_def_var_deflate(ncid, varids[i], 1, 1, 4), "define compression");
+            nccheck(nc_put_att_double(ncid, varids[i], "tolerance", NC_DOUBLE, 1, &tolerance), "write attributes");
+        }
+    }
+    if (base)
+        for (int i = 0; i < 4; ++i)
+            nccheck(nc_def_var(ncid, baseNames[i], NC_DOUBLE, 1, &nydim, &varids[4 + i]), "define base");
+
+    const int Nx = u.Nx(), Ny = u.Ny(), Nz = u.Nz();
+    const Real Lx = u.Lx(), Lz = u.Lz(), a = u.a(), b = u.b();
+    nccheck(nc_put_att_int(ncid, NC_GLOBAL, "ddcstate", NC_INT, 1, &stateversion), "write attributes");
+    if (!series)
+        nccheck(nc_put_att_double(ncid, NC_GLOBAL, "time", NC_DOUBLE, 1, &t), "write attributes");
+    nccheck(nc_put_att_int(ncid, NC_GLOBAL, "Nx", NC_INT, 1, &Nx), "write attributes");
+    nccheck(nc_put_att_int(ncid, NC_GLOBAL, "Ny", NC_INT, 1, &Ny), "write attributes");
+    nccheck(nc_put_att_int(ncid, NC_GLOBAL, "Nz", NC_INT, 1, &Nz), "write attributes");
+    nccheck(nc_put_att_double(ncid, NC_GLOBAL, "Lx", NC_DOUBLE, 1, &Lx), "write attributes");
+    nccheck(nc_put_att_double(ncid, NC_GLOBAL, "Lz", NC_DOUBLE, 1, &Lz), "write attributes");
+    nccheck(nc_put_att_double(ncid, NC_GLOBAL, "a", NC_DOUBLE, 1, &a), "write attributes");
+    nccheck(nc_put_att_double(ncid, NC_GLOBAL, "b", NC_DOUBLE, 1, &b), "write attributes");
+    const std::string system = ddcsystem2s(flags.system);
+    nccheck(nc_put_att_text(ncid, NC_GLOBAL, "system", system.size(), system.c_str()), "write attributes");
+    for (const FlagAttribute& f : flagAttributes())
+        nccheck(nc_put_att_double(ncid, NC_GLOBAL, f.name, NC_DOUBLE, 1, &(flags.*f.value)), "write attributes");
+    nccheck(nc_enddef(ncid), "define state");
+    return varids;
+}
+
+void writeBase(int ncid, const DDCBaseFlow& base, const std::vector<int>& varids) {
+    const ChebyCoeff* profiles[4] = {&base.U, &base.W, &base.T, &base.S};
+    for (int i = 0; i < 4; ++i) {
+        std::vector<Real> p(profiles[i]->N());
+        for (int ny = 0; ny < profiles[i]->N(); ++ny)
+            p[ny] = (*profiles[i])[ny];
+        nccheck(nc_put_var_double(ncid, varids[4 + i], p.data()), "write base");
+    }
+}
+
+// creates and defines filename, the base profiles (of flags unless given) are written right away
+void createState(const std::string& filename, const std::vector<FlowField>& fields, const std::vector<bool>& stored,
+                 Real t, const DDCFlags& flags, const DDCPrecision& precision, bool series,
+                 std::shared_ptr<const DDCBaseFlow> base) {
+    const FlowField& u = fields[0];
+
+    // base profiles exist for the laminar and zero base flows only
+    if (!base && (flags.baseflow == LaminarBase || flags.baseflow == ZeroBase))
+        base = ddcBaseFlow(u.Ny(), u.a(), u.b(), flags);
+
+    int ncid;
+#ifdef HAVE_NETCDF_PAR_H
+    if (parallelIO(u.cfmpi())) {
+        nccheck(nc_create_par(filename.c_str(), NC_CLOBBER | NC_NETCDF4 | NC_MPIIO, *u.comm_world(),
+                              MPI_INFO_NULL, &ncid),
+                "create " + filename);
+        const std::vector<int> varids = defineState(ncid, fields, stored, t, flags, precision, bool(base), series);
+        if (base && u.taskid() == 0)
+            writeBase(ncid, *base, varids);
+        nccheck(nc_close(ncid), "close " + filename);
+        return;
+    }
+#endif
+    if (u.taskid() == 0) {
+        nccheck(nc_create(filename.c_str(), NC_CLOBBER | NC_NETCDF4, &ncid), "create " + filename);
+        const std::vector<int> varids = defineState(ncid, fields, stored, t, flags, precision, bool(base), series);
+        if (base)
+            writeBase(ncid, *base, varids);
+        nccheck(nc_close(ncid), "close " + filename);
+    }
+    barrier(u);
+}
+
+void writeModes(int ncid, const std::vector<FlowField>& fields, const std::vector<bool>& stored,
+                const DDCPrecision& precision, int record, bool collective) {
+    std::vector<Real> buf;
+    std::vector<size_t> start, count;
+    for (uint i = 0; i < stored.size(); ++i) {
+        if (!stored[i])
+            continue;
+        int varid;
+        nccheck(nc_inq_varid(ncid, fieldNames[i], &varid), "find field");
+#ifdef HAVE_NETCDF_PAR_H
+        if (collective)
+            nccheck(nc_var_par_access(ncid, varid, NC_COLLECTIVE), "set parallel access");
+#endif
+        packModes(fields[i], buf);
+        quantize(buf, precision.tolerance[i]);
+        modeSlab(fields[i], i, record, start, count);
+        nccheck(nc_put_vara_double(ncid, varid, start.data(), count.data(), buf.data()), "write field");
+    }
+}
+
+void writeTime(int ncid, int record, Real t, bool collective) {
+    int varid;
+    nccheck(nc_inq_varid(ncid, "time", &varid), "find time");
+#ifdef HAVE_NETCDF_PAR_H
+    if (collective)
+        nccheck(nc_var_par_access(ncid, varid, NC_COLLECTIVE), "set parallel access");
+#endif
+    const size_t start = record, count = 1;
+    nccheck(nc_put_vara_double(ncid, varid, &start, &count, &t), "write time");
+}
+
+/* writes the modes of all processes into the existing filename, collectively with parallel NetCDF, otherwise
+ * one process after the other. A record >= 0 of a time series is appended together with its time t.
+ */
+void writeState(const std::string& filename, const std::vector<FlowField>& fields, const std::vector<bool>& stored,
+                const DDCPrecision& precision, int record, Real t) {
+    const FlowField& u = fields[0];
+    int ncid;
+#ifdef HAVE_NETCDF_PAR_H
+    if (parallelIO(u.cfmpi())) {
+        nccheck(nc_open_par(filename.c_str(), NC_WRITE | NC_MPIIO, *u.comm_world(), MPI_INFO_NULL, &ncid),
+                "open " + filename);
+        writeModes(ncid, fields, stored, precision, record, true);
+        if (record >= 0)
+            writeTime(ncid, record, t, true);
+        nccheck(nc_close(ncid), "close " + filename);
+        return;
+    }
+#endif
+    for (int task = 0; task < u.numtasks(); ++task) {
+        if (u.taskid() == task) {
+            nccheck(nc_open(filename.c_str(), NC_WRITE, &ncid), "open " + filename);
+            writeModes(ncid, fields, stored, precision, record, false);
+            if (record >= 0 && task == 0)
+                writeTime(ncid, record, t, false);
+            nccheck(nc_close(ncid), "close " + filename);
+        }
+        barrier(u);
+    }
+}
+
+int openState(const std::string& filename, CfMPI* cfmpi) {
+    int ncid;
+#ifdef HAVE_NETCDF_PAR_H
+    if (parallelIO(cfmpi))
+        nccheck(nc_open_par(filename.c_str(), NC_NOWRITE | NC_MPIIO, cfmpi->comm_world, MPI_INFO_NULL, &ncid),
+                "open " + filename);
+    else
+#endif
+        nccheck(nc_open(filename.c_str(), NC_NOWRITE, &ncid), "open " + filename);
+    int version = 0;
+    if (nc_get_att_int(ncid, NC_GLOBAL, "ddcstate", &version) != NC_NOERR || version > stateversion)
+        cferror("DDC state file: " + filename + " is not a DDC state file of a supported version");
+    return ncid;
+}
+
+// times of the records of a time series, empty for a state file
+std::vector<Real> readTimes(int ncid) {
+    int tdim;
+    if (nc_inq_dimid(ncid, "time", &tdim) != NC_NOERR)
+        return std::vector<Real>();
+    size_t len;
+    nccheck(nc_inq_dimlen(ncid, tdim, &len), "read dimensions");
+    std::vector<Real> times(len);
+    if (len > 0) {
+        int varid;
+        nccheck(nc_inq_varid(ncid, "time", &varid), "find time");
+        nccheck(nc_get_var_double(ncid, varid, times.data()), "read time");
+    }
+    return times;
+}
+
+// grid attributes Nx, Ny, Nz
+std::vector<int> readGrid(int ncid) {
+    std::vector<int> N(3);
+    nccheck(nc_get_att_int(ncid, NC_GLOBAL, "Nx", &N[0]), "read attributes");
+    nccheck(nc_get_att_int(ncid, NC_GLOBAL, "Ny", &N[1]), "read attributes");
+    nccheck(nc_get_att_int(ncid, NC_GLOBAL, "Nz", &N[2]), "read attributes");
+    return N;
+}
+
+// stored fields and their precision
+void readPrecision(int ncid, std::vector<bool>& stored, DDCPrecision& precision) {
+    stored.resize(4);
+    for (int i = 0; i < 4; ++i) {
+        int varid;
+        stored[i] = nc_inq_varid(ncid, fieldNames[i], &varid) == NC_NOERR;
+        precision.tolerance[i] = 0;
+        if (stored[i])
+            nc_get_att_double(ncid, varid, "tolerance", &precision.tolerance[i]);  // lossless without it
+    }
+}
+
+// reads the fields (of the record >= 0 of a time series) and, if flags is given, the parameters
+void readState(int ncid, int record, std::vector<FlowField>& fields, CfMPI* cfmpi, DDCFlags* flags) {
+    const std::vector<int> N = readGrid(ncid);
+    Real Lx, Lz, a, b;
+    size_t len;
+    nccheck(nc_get_att_double(ncid, NC_GLOBAL, "Lx", &Lx), "read attributes");
+    nccheck(nc_get_att_double(ncid, NC_GLOBAL, "Lz", &Lz), "read attributes");
+    nccheck(nc_get_att_double(ncid, NC_GLOBAL, "a", &a), "read attributes");
+    nccheck(nc_get_att_double(ncid, NC_GLOBAL, "b", &b), "read attributes");
+    int vdim;
+    nccheck(nc_inq_dimid(ncid, "vcomp", &vdim), "read dimensions");
+    nccheck(nc_inq_dimlen(ncid, vdim, &len), "read dimensions");
+    const int Nd = int(len);
+
+    if (flags != NULL) {
+        nccheck(nc_inq_attlen(ncid, NC_GLOBAL, "system", &len), "read attributes");
+        std::string system(len, ' ');
+        nccheck(nc_get_att_text(ncid, NC_GLOBAL, "system", &system[0]), "read attributes");
+        flags->system = s2ddcsystem(system);
+        for (const FlagAttribute& f : flagAttributes())
+            nccheck(nc_get_att_double(ncid, NC_GLOBAL, f.name, &(flags->*f.value)), "read attributes");
+    }
+
+    fields.resize(4);
+    std::vector<Real> buf;
+    std::vector<size_t> start, count;
+    for (int i = 0; i < 4; ++i) {
+        int varid;
+        if (nc_inq_varid(ncid, fieldNames[i], &varid) != NC_NOERR) {
+            fields[i] = FlowField();
+            continue;
+        }
+        fields[i] = FlowField(N[0], N[1], N[2], i == 0 ? Nd : 1, Lx, Lz, a, b, cfmpi, Spectral, Spectral);
+#ifdef HAVE_NETCDF_PAR_H
+        if (parallelIO(cfmpi))
+            nccheck(nc_var_par_access(ncid, varid, NC_COLLECTIVE), "set parallel access");
+#endif
+        modeSlab(fields[i], i, record, start, count);
+        buf.resize(2 * fields[i].Nd() * fields[i].Mxloc() * N[1] * fields[i].Mzloc());
+        nccheck(nc_get_vara_double(ncid, varid, start.data(), count.data(), buf.data()), "read field");
+        unpackModes(buf, fields[i]);
+    }
+}
+
+#endif  // HAVE_NETCDF_H
+
+}  // namespace
+
+DDCPrecision::DDCPrecision(Real utol, Real ttol, Real stol, Real ptol) {
+    tolerance[0] = utol;
+    tolerance[1] = ttol;
+    tolerance[2] = stol;
+    tolerance[3] = ptol;
+}
+
+bool DDCPrecision::lossless() const {
+    return tolerance[0] == 0 && tolerance[1] == 0 && tolerance[2] == 0 && tolerance[3] == 0;
+}
+
+void saveDDCState(const std::string& filebase, const std::vector<FlowField>& fields, Real t, const DDCFlags& flags,
+                  const DDCPrecision& precision, const std::shared_ptr<const DDCBaseFlow>& base) {
+#ifdef HAVE_NETCDF_H
+    std::lock_guard<std::recursive_mutex> io(ddcIOMutex());  // NetCDF is not thread-safe
+    checkSpectral(fields);
+    const std::string filename = stateFilename(filebase);
+    const std::vector<bool> stored = storedFields(fields, flags);
+    createState(filename, fields, stored, t, flags, precision, false, base);
+    writeState(filename, fields, stored, precision, -1, t);
+#else
+    cferror("saveDDCState: channelflow is built without NetCDF (WITH_NETCDF=OFF)");
+#endif  // HAVE_NETCDF_H
+}
+
+Real loadDDCState(const std::string& filebase, std::vector<FlowField>& fields, CfMPI* cfmpi, DDCFlags* flags) {
+#ifdef HAVE_NETCDF_H
+    std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+    int record;
+    const std::string filename = splitRecord(filebase, record);
+    const int ncid = openState(filename, cfmpi);
+
+    // a time series gives its last record unless the record is selected by name:n
+    Real t;
+    const std::vector<Real> times = readTimes(ncid);
+    if (!times.empty()) {
+        if (record < 0)
+            record = times.size() - 1;
+        if (record >= int(times.size()))
+            cferror("loadDDCState: " + filename + " has " + i2s(times.size()) + " records, requested " +
+                    i2s(record));
+        t = times[record];
+    } else {
+        if (record >= 0)
+            cferror("loadDDCState: " + filename + " is not a time series, cannot read record " + i2s(record));
+        nccheck(nc_get_att_double(ncid, NC_GLOBAL, "time", &t), "read attributes");
+    }
+    readState(ncid, record, fields, cfmpi, flags);
+    nccheck(nc_close(ncid), "close " + filename);
+    return t;
+#else
+    cferror("loadDDCState: channelflow is built without NetCDF (WITH_NETCDF=OFF)");
+    return 0;
+#endif  // HAVE_NETCDF_H
+}
+
+bool isDDCState(const std::string& filebase) {
+#ifdef HAVE_NETCDF_H
+    std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+    int record;
+    const std::string filename = splitRecord(filebase, record);
+    if (!std::ifstream(filename.c_str()).good())
+        return false;
+    int ncid, version;
+    if (nc_open(filename.c_str(), NC_NOWRITE, &ncid) != NC_NOERR)
+        return false;
+    const bool state = nc_get_att_int(ncid, NC_GLOBAL, "ddcstate", &version) == NC_NOERR;
+    nc_close(ncid);
+    return state;
+#else
+    return false;
+#endif
+}
+
+void loadDDCFields(const std::string& uname, const std::string& tname, const std::string& sname, FlowField& u,
+                   FlowField& temp, FlowField& salt, CfMPI* cfmpi) {
+    std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+    if (isDDCState(uname)) {
+        std::vector<FlowField> fields;
+        loadDDCState(uname, fields, cfmpi);
+        u = fields[0];
+        // inactive scalars are not stored, they are zero on the grid of u
+        temp = fields[1].Nd() > 0 ? fields[1]
+                                  : FlowField(u.Nx(), u.Ny(), u.Nz(), 1, u.Lx(), u.Lz(), u.a(), u.b(), cfmpi);
+        salt = fields[2].Nd() > 0 ? fields[2]
+                                  : FlowField(u.Nx(), u.Ny(), u.Nz(), 1, u.Lx(), u.Lz(), u.a(), u.b(), cfmpi);
+    } else {
+        u = FlowField(uname, cfmpi);
+        temp = FlowField(tname, cfmpi);
+        salt = FlowField(sname, cfmpi);
+    }
+}
+
+DDCTimeSeries::DDCTimeSeries(const std::string& filebase, const std::vector<FlowField>& fields,
+                             const DDCFlags& flags, const DDCPrecision& precision)
+    : filename_(stateFilename(filebase)), cfmpi_(fields[0].cfmpi()), precision_(precision) {
+#ifdef HAVE_NETCDF_H
+    std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+    checkSpectral(fields);
+    stored_ = storedFields(fields, flags);
+    if (std::ifstream(filename_.c_str()).good()) {
+        // continue an existing series of the same grid
+        const int ncid = openState(filename_, cfmpi_);
+        times_ = readTimes(ncid);
+        readPrecision(ncid, stored_, precision_);
+        const std::vector<int> N = readGrid(ncid);
+        nccheck(nc_close(ncid), "close " + filename_);
+        const FlowField& u = fields[0];
+        if (N[0] != u.Nx() || N[1] != u.Ny() || N[2] != u.Nz())
+            cferror("DDCTimeSeries: the grid of " + filename_ + " differs from the grid of the fields");
+    } else {
+        createState(filename_, fields, stored_, 0.0, flags, precision_, true, nullptr);
+    }
+#else
+    cferror("DDCTimeSeries: channelflow is built without NetCDF (WITH_NETCDF=OFF)");
+#endif
+}
+
+DDCTimeSeries::DDCTimeSeries(const std::string& filebase, CfMPI* cfmpi)
+    : filename_(stateFilename(filebase)), cfmpi_(cfmpi) {
+#ifdef HAVE_NETCDF_H
+    std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+    const int ncid = openState(filename_, cfmpi_);
+    times_ = readTimes(ncid);
+    readPrecision(ncid, stored_, precision_);
+    nccheck(nc_close(ncid), "close " + filename_);
+#else
+    cferror("DDCTimeSeries: channelflow is built without NetCDF (WITH_NETCDF=OFF)");
+#endif
+}
+
+void DDCTimeSeries::append(const std::vector<FlowField>& fields, Real t) {
+#ifdef HAVE_NETCDF_H
+    std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+    checkSpectral(fields);
+    for (uint i = 0; i < stored_.size(); ++i)
+        if (stored_[i] && (i >= fields.size() || fields[i].Nd() == 0))
+            cferror("DDCTimeSeries::append: " + std::string(fieldNames[i]) + " is stored in " + filename_ +
+                    " but missing");
+    writeState(filename_, fields, stored_, precision_, times_.size(), t);
+    times_.push_back(t);
+#endif
+}
+
+int DDCTimeSeries::record(Real t) const {
+    int n = -1;
+    for (uint i = 0; i < times_.size(); ++i)
+        if (n < 0 || abs(times_[i] - t) < abs(times_[n] - t))
+            n = i;
+    return n;
+}
+
+Real DDCTimeSeries::read(int n, std::vector<FlowField>& fields, DDCFlags* flags) const {
+    if (n < 0 || n >= length())
+        cferror("DDCTimeSeries::read: " + filename_ + " has " + i2s(length()) + " records, requested " + i2s(n));
+#ifdef HAVE_NETCDF_H
+    std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+    const int ncid = openState(filename_, cfmpi_);
+    readState(ncid, n, fields, cfmpi_, flags);
+    nccheck(nc_close(ncid), "close " + filename_);
+#endif
+    return times_[n];
+}
+
+}  // namespace chflow
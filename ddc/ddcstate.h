@@ -0,0 +1,109 @@
+/**
+ * Combined state file of the DDC module
+ *
+ * A single NetCDF file per time instant holds velocity, temperature, salinity and pressure together with the
+ * time, the parameters of the DDCFlags and the base profiles, instead of one file per field. A DDCTimeSeries
+ * holds many such instants as records of one file.
+ */
+
+#ifndef DDCSTATE_H
+#define DDCSTATE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "channelflow/flowfield.h"
+#include "modules/ddc/ddcflags.h"
+
+namespace chflow {
+
+struct DDCBaseFlow;
+
+/** \brief storage precision of u, T, S and p in state files and time series
+ *
+ * tolerance[i] == 0: field i is stored losslessly in double precision, as needed for restarts.
+ * tolerance[i] > 0: the spectral coefficients are rounded to multiples of the largest power of two q with
+ * q/2 <= tolerance[i], i.e. with an absolute error of at most tolerance[i] per coefficient, and deflated.
+ * The zeroed low-order mantissa bits make the shuffled data compress well.
+ * tolerance[i] < 0: the coefficients are stored in single precision (relative error ~ 6e-8) and deflated.
+ */
+struct DDCPrecision {
+    DDCPrecision(Real utol = 0, Real ttol = 0, Real stol = 0, Real ptol = 0);
+
+    bool lossless() const;
+
+    Real tolerance[4];  // of u, T, S, p
+};
+
+/** \brief writes fields = {u, T, S[, p]} at time t to filebase.nc
+ *
+ * The fields are stored as spectral coefficients (indexed by mx, ny, mz) with the given precision, empty fields
+ * (inactive scalars, missing pressure) are left out. The global attributes hold the grid, t and the physical
+ * parameters of flags, the base profiles of flags are stored as Chebyshev coefficients. With parallel NetCDF
+ * every process writes its Fourier modes collectively, otherwise the processes write their modes one after the
+ * other. The base profiles are looked up with ddcBaseFlow unless base is given, which lets a DDCSnapshotWriter
+ * thread write the state without computing profiles.
+ */
+void saveDDCState(const std::string& filebase, const std::vector<FlowField>& fields, Real t, const DDCFlags& flags,
+                  const DDCPrecision& precision = DDCPrecision(),
+                  const std::shared_ptr<const DDCBaseFlow>& base = nullptr);
+
+/** \brief reads a file of saveDDCState into fields = {u, T, S, p}, distributed by cfmpi
+ *
+ * Quantities that are not stored are returned as empty FlowFields. Returns the time of the state. If flags is
+ * given, the stored parameters (system, Reynolds, Prandtl, ... numbers and wall values) are set in it.
+ * A DDCTimeSeries is read at its last record, or at record n if filebase is given as "name:n".
+ */
+Real loadDDCState(const std::string& filebase, std::vector<FlowField>& fields, CfMPI* cfmpi = NULL,
+                  DDCFlags* flags = NULL);
+
+// true if filebase(.nc) is a file written by saveDDCState
+bool isDDCState(const std::string& filebase);
+
+/** \brief reads u, temp and salt from a state file or from three FlowField files
+ *
+ * If uname is a state file all fields are read from it and tname, sname are ignored, otherwise u, temp and salt
+ * are read from uname, tname and sname. Used by the programs to accept both kinds of input.
+ */
+void loadDDCFields(const std::string& uname, const std::string& tname, const std::string& sname, FlowField& u,
+                   FlowField& temp, FlowField& salt, CfMPI* cfmpi = NULL);
+
+/** \brief appendable time series of DDC states in one NetCDF file
+ *
+ * The records have the layout of saveDDCState along the unlimited dimension time, one record per chunk, so
+ * that appending a snapshot or reading record n touches a single chunk. The grid, the parameters and the base
+ * profiles are stored once. Replaces one file per snapshot and field (u0, u1, ...) for long runs.
+ */
+class DDCTimeSeries {
+   public:
+    /* appends to filebase.nc, which is created with the grid of fields, the parameters of flags and the given
+     * precision if missing. An existing series keeps the precision it was created with.
+     */
+    DDCTimeSeries(const std::string& filebase, const std::vector<FlowField>& fields, const DDCFlags& flags,
+                  const DDCPrecision& precision = DDCPrecision());
+
+    // opens filebase.nc for reading, the records are distributed by cfmpi
+    explicit DDCTimeSeries(const std::string& filebase, CfMPI* cfmpi = NULL);
+
+    // appends fields = {u, T, S[, p]} at time t as a new record, collective like saveDDCState
+    void append(const std::vector<FlowField>& fields, Real t);
+
+    // reads record n into fields = {u, T, S, p} (and the parameters into flags if given), returns its time
+    Real read(int n, std::vector<FlowField>& fields, DDCFlags* flags = NULL) const;
+
+    inline int length() const { return times_.size(); }  // number of records
+    inline Real time(int n) const { return times_[n]; }
+    int record(Real t) const;  // index of the record closest to t, -1 if there is none
+    inline const std::string& filename() const { return filename_; }
+    inline const DDCPrecision& precision() const { return precision_; }
+
+   private:
+    std::string filename_;
+    CfMPI* cfmpi_;
+    DDCPrecision precision_;
+    std::vector<Real> times_;  // times of the records
+    std::vector<bool> stored_;  // u, T, S, p are stored
+};
+
+}  // namespace chflow
+#endif
@@ -0,0 +1,225 @@
+/**
+ * Asynchronous output of DDC snapshots
+ */
+
+#include "modules/ddc/ddcwriter.h"
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
+
+namespace chflow {
+
+namespace {
+
+// FlowField::save writes .ff and .asc files from the spectral coefficients, NetCDF and HDF5 files on the grid
+bool savesPhysical(const std::string& filebase) {
+    for (const std::string ext : {".ff", ".asc"})
+        if (filebase.size() >= ext.size() && filebase.compare(filebase.size() - ext.size(), ext.size(), ext) == 0)
+            return false;
+    return true;
+}
+
+#ifdef HAVE_MPI
+// copies the Fourier modes range = [mxmin, Mx, mzmin, Mz] of g from buf, packed as [i][mx][ny][mz][re,im]
+void unpackModes(const std::vector<Real>& buf, const int range[4], FlowField& g) {
+    lint n = 0;
+    for (int i = 0; i < g.Nd(); ++i)
+        for (lint mx = range[0]; mx < range[0] + range[1]; ++mx)
+            for (int ny = 0; ny < g.Ny(); ++ny)
+                for (lint mz = range[2]; mz < range[2] + range[3]; ++mz, n += 2)
+                    g.cmplx(mx, ny, mz, i) = Complex(buf[n], buf[n + 1]);
+}
+
+/* assembles the spectral field f, distributed over all processes, in the serial field g of process 0. The other
+ * processes send their local modes one after the other, g is left untouched there.
+ */
+void gatherModes(const FlowField& f, FlowField& g, std::vector<Real>& buf) {
+    MPI_Comm comm = *f.comm_world();
+    int range[4] = {int(f.mxlocmin()), int(f.Mxloc()), int(f.mzlocmin()), int(f.Mzloc())};
+    if (f.taskid() != 0) {
+        buf.resize(2 * f.Nd() * f.Mxloc() * f.Ny() * f.Mzloc());
+        lint n = 0;
+        for (int i = 0; i < f.Nd(); ++i)
+            for (lint mx = f.mxlocmin(); mx < f.mxlocmin() + f.Mxloc(); ++mx)
+                for (int ny = 0; ny < f.Ny(); ++ny)
+                    for (lint mz = f.mzlocmin(); mz < f.mzlocmin() + f.Mzloc(); ++mz, n += 2) {
+                        const Complex c = f.cmplx(mx, ny, mz, i);
+                        buf[n] = Re(c);
+                        buf[n + 1] = Im(c);
+                    }
+        MPI_Send(range, 4, MPI_INT, 0, 0, comm);
+        MPI_Send(buf.data(), buf.size(), MPI_DOUBLE, 0, 1, comm);
+        return;
+    }
+    for (int i = 0; i < f.Nd(); ++i)
+        for (lint mx = f.mxlocmin(); mx < f.mxlocmin() + f.Mxloc(); ++mx)
+            for (int ny = 0; ny < f.Ny(); ++ny)
+                for (lint mz = f.mzlocmin(); mz < f.mzlocmin() + f.Mzloc(); ++mz)
+                    g.cmplx(mx, ny, mz, i) = f.cmplx(mx, ny, mz, i);
+    for (int task = 1; task < f.numtasks(); ++task) {
+        MPI_Recv(range, 4, MPI_INT, task, 0, comm, MPI_STATUS_IGNORE);
+        buf.resize(2 * f.Nd() * range[1] * f.Ny() * range[3]);
+        MPI_Recv(buf.data(), buf.size(), MPI_DOUBLE, task, 1, comm, MPI_STATUS_IGNORE);
+        unpackModes(buf, range, g);
+    }
+}
+#endif
+
+}  // namespace
+
+std::recursive_mutex& ddcIOMutex() {
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+DDCSnapshotWriter::DDCSnapshotWriter(int depth) : depth_(depth > 0 ? depth : 0), stop_(false), busy_(false) {
+    // at most depth queued snapshots and the one being written exist, so spare_ never reallocates. Reallocation
+    // could copy the FlowFields (the move of Snapshot is not noexcept) on the writer thread.
+    spare_.reserve(depth_ + 1);
+    if (depth_ > 0)
+        writer_ = std::thread(&DDCSnapshotWriter::run, this);
+}
+
+DDCSnapshotWriter::~DDCSnapshotWriter() {
+    if (writer_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        writer_.join();
+    }
+}
+
+void DDCSnapshotWriter::rethrow() {
+    if (error_) {
+        std::exception_ptr e = error_;
+        error_ = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+void DDCSnapshotWriter::save(const std::vector<FlowField>& fields, const std::vector<std::string>& filebases) {
+    assert(fields.size() == filebases.size());
+    std::vector<bool> copy(fields.size()), physical(fields.size());
+    for (uint i = 0; i < fields.size(); ++i) {
+        copy[i] = !filebases[i].empty();
+        physical[i] = copy[i] && savesPhysical(filebases[i]);
+    }
+    enqueue(fields, copy, physical, [filebases](const std::vector<FlowField>& f) {
+        for (uint i = 0; i < f.size(); ++i)
+            if (!filebases[i].empty())
+                f[i].save(filebases[i]);
+    });
+}
+
+void DDCSnapshotWriter::save(const std::vector<FlowField>& fields, const Write& write) {
+    std::vector<bool> copy(fields.size());
+    for (uint i = 0; i < fields.size(); ++i)
+        copy[i] = fields[i].Nd() > 0;
+    enqueue(fields, copy, std::vector<bool>(fields.size(), false), write);
+}
+
+void DDCSnapshotWriter::enqueue(const std::vector<FlowField>& fields, const std::vector<bool>& copy,
+                                const std::vector<bool>& physical, const Write& write) {
+    // fields distributed over several processes are gathered in serial copies, written by process 0 only
+    bool distributed = false;
+    bool writer = true;
+    for (uint i = 0; i < fields.size(); ++i)
+        if (copy[i] && fields[i].numtasks() > 1) {
+            distributed = true;
+            writer = fields[i].taskid() == 0;
+        }
+
+    if (depth_ == 0) {
+        flush();
+        std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+        write(fields);
+        return;
+    }
+
+    Snapshot snap;
+    if (writer) {
+        // back-pressure: wait for a free slot, then take recycled buffers if there are any
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return int(queue_.size()) < depth_ || error_; });
+        rethrow();
+        if (!spare_.empty()) {
+            snap = std::move(spare_.back());
+            spare_.pop_back();
+        }
+    }
+    snap.fields.resize(fields.size());
+    snap.write = write;
+    for (uint i = 0; i < fields.size(); ++i) {
+        if (!copy[i]) {
+            snap.fields[i] = FlowField();
+            continue;
+        }
+        if (distributed) {
+#ifdef HAVE_MPI
+            // the modes are gathered in spectral state, all processes transform alike
+            const FlowField* f = &fields[i];
+            if (f->xzstate() != Spectral || f->ystate() != Spectral) {
+                spectral_ = fields[i];
+                spectral_.makeSpectral();
+                f = &spectral_;
+            }
+            FlowField& g = snap.fields[i];
+            if (writer) {
+                if (g.cfmpi() != NULL || !g.congruent(*f))
+                    g = FlowField(f->Nx(), f->Ny(), f->Nz(), f->Nd(), f->Lx(), f->Lz(), f->a(), f->b());
+                g.setState(Spectral, Spectral);
+            }
+            gatherModes(*f, g, gatherbuf_);
+#endif
+        } else {
+            snap.fields[i] = fields[i];
+        }
+        if (writer && physical[i])
+            snap.fields[i].makePhysical();
+    }
+    if (!writer)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(snap));
+    }
+    cond_.notify_all();
+}
+
+void DDCSnapshotWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return (queue_.empty() && !busy_) || error_; });
+    rethrow();
+}
+
+void DDCSnapshotWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cond_.wait(lock, [this] { return !queue_.empty() || stop_; });
+        if (queue_.empty())
+            return;  // stop_ is set and everything is written
+        Snapshot snap = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            std::lock_guard<std::recursive_mutex> io(ddcIOMutex());
+            snap.write(snap.fields);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        busy_ = false;
+        if (error)
+            error_ = error;
+        spare_.push_back(std::move(snap));
+        cond_.notify_all();
+    }
+}
+
+}  // namespace chflow
@@ -0,0 +1,97 @@
+/**
+ * Asynchronous output of DDC snapshots
+ *
+ * DDCSnapshotWriter copies the fields of a snapshot into buffers that are recycled between snapshots and
+ * writes them from a dedicated thread, so that the time stepping continues while the files are written.
+ * Neither NetCDF-C nor the FFTW planner is thread-safe: all copies, transforms and FFTW plans are made by the
+ * calling thread, and the file accesses of both threads are serialized by ddcIOMutex.
+ */
+
+#ifndef DDCWRITER_H
+#define DDCWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "channelflow/flowfield.h"
+
+namespace chflow {
+
+/** \brief process-wide lock of the NetCDF library
+ *
+ * Held by every NetCDF access of the DDC module (state files, time series, slices) and by every job of a
+ * DDCSnapshotWriter. It is recursive, so that a job may call functions that take it again.
+ */
+std::recursive_mutex& ddcIOMutex();
+
+/** \brief bounded queue of snapshots written by a writer thread
+ *
+ * save returns as soon as the fields are copied. At most depth snapshots wait for the writer, a further save
+ * blocks until the oldest one is written (back-pressure), so the memory is bounded by depth+1 copies.
+ * FlowField::save is collective for distributed fields, which must not overlap with the collectives of the
+ * time stepping. Hence fields distributed over several MPI processes are gathered by the calling threads into
+ * serial copies on process 0, whose writer thread alone writes them; the other processes continue right after
+ * sending their modes, and the writer thread makes no MPI calls. Process 0 then holds up to depth+1 copies of
+ * the complete snapshot, and the write functions run only there. With depth 0 every snapshot is written
+ * synchronously by the calling thread. Errors of the writer thread are rethrown by the next save or flush.
+ * Every write holds ddcIOMutex. It runs on copies that the calling thread has already brought into the state
+ * the write needs, so the writer thread never transforms a field or creates an FFTW plan.
+ */
+class DDCSnapshotWriter {
+   public:
+    explicit DDCSnapshotWriter(int depth = 2);
+    DDCSnapshotWriter(const DDCSnapshotWriter&) = delete;
+    DDCSnapshotWriter& operator=(const DDCSnapshotWriter&) = delete;
+    ~DDCSnapshotWriter();  // writes all queued snapshots
+
+    /* writes the copied fields of a snapshot, e.g. into a single state file with saveDDCState. Runs on the writer
+     * thread, hence it must not construct, copy or transform FlowFields (FFTW planning is not thread-safe).
+     */
+    typedef std::function<void(const std::vector<FlowField>&)> Write;
+
+    /* queues fields[i] to be saved as filebases[i], fields with an empty filebase are skipped. The copies are
+     * transformed to physical state here, in which FlowField::save writes NetCDF and HDF5 files as they are
+     * (.ff and .asc files keep the spectral state).
+     */
+    void save(const std::vector<FlowField>& fields, const std::vector<std::string>& filebases);
+
+    // queues the non-empty fields to be written by write, the copies keep the state of the fields
+    void save(const std::vector<FlowField>& fields, const Write& write);
+
+    // blocks until all queued snapshots are written
+    void flush();
+
+    inline int depth() const { return depth_; }
+
+   private:
+    struct Snapshot {
+        std::vector<FlowField> fields;
+        Write write;
+    };
+
+    // copies the fields marked in copy (those marked in physical in physical state) into a snapshot written by write
+    void enqueue(const std::vector<FlowField>& fields, const std::vector<bool>& copy,
+                 const std::vector<bool>& physical, const Write& write);
+    void run();  // loop of the writer thread
+    void rethrow();
+
+    int depth_;
+    bool stop_;
+    bool busy_;                     // the writer thread is writing a snapshot
+    std::deque<Snapshot> queue_;    // snapshots waiting for the writer
+    std::vector<Snapshot> spare_;   // written snapshots, their buffers are reused by save, never reallocated
+    FlowField spectral_;            // spectral copy of a distributed field saved in physical state
+    std::vector<Real> gatherbuf_;   // local modes sent to or received by process 0
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable cond_;  // signals changes of queue_, busy_ and stop_
+    std::thread writer_;
+};
+
+}  // namespace chflow
+#endif
@@ -1,174 +1,173 @@
 /**
  * Original author: Duc Nguyen
  */
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <mutex>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 using namespace std;
-#include "modules/ddc/macros.h"
-#include "modules/ddc/boundaryCondition.h"
 #include "modules/ddc/dde.h"
 
 namespace chflow {
 
-void momentumNL(const FlowField& u, const FlowField& T, const FlowField& S, 
-                ChebyCoeff Ubase, ChebyCoeff Wbase, 
-                FlowField& f, FlowField& tmp, DDCFlags flags) {
+DDCNLContext::DDCNLContext(const ChebyCoeff& Ubase_, const ChebyCoeff& Wbase_, const ChebyCoeff& Tbase_,
+                           const ChebyCoeff& Sbase_, DDCFlags& flags_)
+    : Ubase(Ubase_),
+      Wbase(Wbase_),
+      Tbase(Tbase_),
+      Sbase(Sbase_),
+      flags(flags_),
+      p1(0),
+      p2(0),
+      p3(0),
+      p4(0),
+      p5(0),
+      p6(0),
+      p7(0),
+      temperature(false),
+      salinity(false),
+      crossdiffusion(false),
+      sgammax(0),
+      cgammax(1) {
+    update();
+}
+
+void DDCNLContext::update() {
+    const DDCCoefficients c = flags.coefficients();
+    p1 = c.p1;
+    p2 = c.p2;
+    p3 = c.p3;
+    p4 = c.p4;
+    p5 = c.p5;
+    p6 = c.p6;
+    p7 = c.p7;
+    temperature = c.temperature;
+    salinity = c.salinity;
+    crossdiffusion = c.crossdiffusion;
+    sgammax = sin(flags.gammax);
+    cgammax = cos(flags.gammax);
+
+    // values of the base profiles (or of their derivatives) on the Chebyshev points
+    const int Ny = std::max(std::max(Ubase.length(), Wbase.length()), std::max(Tbase.length(), Sbase.length()));
+    auto gridded = [Ny](const ChebyCoeff& c, bool derivative) {
+        std::vector<Real> v(Ny, 0.0);
+        if (c.length() == 0)
+            return v;
+        ChebyCoeff cphys = derivative ? diff(c) : c;
+        cphys.makePhysical();
+        for (int ny = 0; ny < Ny; ++ny)
+            v[ny] = cphys[ny];
+        return v;
+    };
+    U = gridded(Ubase, false);
+    W = gridded(Wbase, false);
+    dUdy = gridded(Ubase, true);
+    dWdy = gridded(Wbase, true);
+    dTdy = gridded(Tbase, true);
+    dSdy = gridded(Sbase, true);
+}
+
+void momentumNL(const FlowField& u, const FlowField& T, const FlowField& S,
+                FlowField& f, FlowField& tmp, const DDCNLContext& ctx) {
     // goal: (u*grad)u - P2*(P3*T-P4*S)*(sin(gammax)*ex+cos(gammax)*ey)
-    Real Rey = flags.Rey;
-    Real Pr = flags.Pr;
-    Real Ra = flags.Ra;
-    Real Rrho = flags.Rrho;
-    Real Rsep = flags.Rsep;
-    Real Ri = flags.Ri;
-    Real sgammax = sin(flags.gammax);
-    Real cgammax = cos(flags.gammax);
 
     // compute the nonlinear term of NSE in the usual Channelflow style
-    navierstokesNL(u, Ubase, Wbase, f, tmp, flags);
+    navierstokesNL(u, ctx.Ubase, ctx.Wbase, f, tmp, ctx.flags);
+
+    // substract the linear temperature+salinity coupling term
+    buoyancyNL(T, S, f, ctx);
+
+    // dealiasing modes
+    if (ctx.flags.dealias_xz())
+        f.zeroPaddedModes();
+}
+
+template <bool Salt>
+static void buoyancyKernel(const FlowField& T, const FlowField& S, FlowField& f, const DDCNLContext& ctx) {
+    const Real cT = ctx.p2 * ctx.p3;
+    const Real cS = ctx.p2 * ctx.p4;
+    const Real sgammax = ctx.sgammax;
+    const Real cgammax = ctx.cgammax;
 
-    #if defined(P5)||defined(P6)
     // substract the linear temperature+salinity coupling term
     // f -= P2(P3*T-P4*S)*(sin(gammax)*ex+cos(gammax)*ey)
     #ifdef HAVE_MPI
     for (int mz = f.mzlocmin(); mz < f.mzlocmin() + f.Mzloc(); mz++)
         for (int mx = f.mxlocmin(); mx < f.mxlocmin() + f.Mxloc(); mx++)
             for (int ny = 0; ny < f.Ny(); ny++) {
-                #if defined(P6)
-                f.cmplx(mx, ny, mz, 0) -= P2*(P3*T.cmplx(mx, ny, mz, 0)-P4*S.cmplx(mx, ny, mz, 0))*sgammax;
-                f.cmplx(mx, ny, mz, 1) -= P2*(P3*T.cmplx(mx, ny, mz, 0)-P4*S.cmplx(mx, ny, mz, 0))*cgammax;
-                #elif defined(P5)
-                f.cmplx(mx, ny, mz, 0) -= P2*P3*T.cmplx(mx, ny, mz, 0)*sgammax;
-                f.cmplx(mx, ny, mz, 1) -= P2*P3*T.cmplx(mx, ny, mz, 0)*cgammax;
-                #endif
+                Complex b = cT*T.cmplx(mx, ny, mz, 0);
+                if (Salt)
+                    b -= cS*S.cmplx(mx, ny, mz, 0);
+                f.cmplx(mx, ny, mz, 0) -= b*sgammax;
+                f.cmplx(mx, ny, mz, 1) -= b*cgammax;
             }
     #else
     for (int ny = 0; ny < f.Ny(); ny++)
         for (int mx = f.mxlocmin(); mx < f.mxlocmin() + f.Mxloc(); mx++)
             for (int mz = f.mzlocmin(); mz < f.mzlocmin() + f.Mzloc(); mz++) {
-                #if defined(P6)
-                f.cmplx(mx, ny, mz, 0) -= P2*(P3*T.cmplx(mx, ny, mz, 0)-P4*S.cmplx(mx, ny, mz, 0))*sgammax;
-                f.cmplx(mx, ny, mz, 1) -= P2*(P3*T.cmplx(mx, ny, mz, 0)-P4*S.cmplx(mx, ny, mz, 0))*cgammax;
-                #elif defined(P5)
-                f.cmplx(mx, ny, mz, 0) -= P2*P3*T.cmplx(mx, ny, mz, 0)*sgammax;
-                f.cmplx(mx, ny, mz, 1) -= P2*P3*T.cmplx(mx, ny, mz, 0)*cgammax;
-                #endif
+                Complex b = cT*T.cmplx(mx, ny, mz, 0);
+                if (Salt)
+                    b -= cS*S.cmplx(mx, ny, mz, 0);
+                f.cmplx(mx, ny, mz, 0) -= b*sgammax;
+                f.cmplx(mx, ny, mz, 1) -= b*cgammax;
             }
     #endif
-    #endif
-    
-    // dealiasing modes
-    if (flags.dealias_xz())
-        f.zeroPaddedModes();
 }
 
-void temperatureNL(const FlowField& u_, const FlowField& T_, 
-                   ChebyCoeff Ubase, ChebyCoeff Wbase, ChebyCoeff Tbase,
-                   FlowField& f, FlowField& tmp, DDCFlags flags) {
-    FlowField& u = const_cast<FlowField&>(u_);
-    FlowField& T = const_cast<FlowField&>(T_);
-    // goal: (u*grad)T
-
-    // f += Base;
-    for (int ny = 0; ny < u.Ny(); ++ny) {
-        if (u.taskid() == u.task_coeff(0, 0)) {
-            u.cmplx(0, ny, 0, 0) += Complex(Ubase(ny), 0.0);
-            u.cmplx(0, ny, 0, 2) += Complex(Wbase(ny), 0.0);
-        }
-        if (u.taskid() == u.task_coeff(0, 0))
-            T.cmplx(0, ny, 0, 0) += Complex(Tbase(ny), 0.0);
-    }
-    if (u.taskid() == u.task_coeff(0, 0)) {
-        u.cmplx(0, 0, 0, 1) -= Complex(flags.Vsuck, 0.);
-    }
+void buoyancyNL(const FlowField& T, const FlowField& S, FlowField& f, const DDCNLContext& ctx) {
+    // goal: f -= P2*(P3*T-P4*S)*(sin(gammax)*ex+cos(gammax)*ey)
+    if (ctx.salinity)
+        buoyancyKernel<true>(T, S, f, ctx);
+    else if (ctx.temperature)
+        buoyancyKernel<false>(T, S, f, ctx);
+}
 
-    // compute the nonlinearity (temperature advection (u*grad)T ) analogous to the convectiveNL and store in f
-    dotgradScalar(u, T, f, tmp);
+void baseflowAdvectionNL(const FlowField& u, const FlowField& s, const std::vector<Real>& dsbasedy, FlowField& f,
+                         const DDCNLContext& ctx) {
+    // goal: (U*grad)S with U = u + Ubase*ex - Vsuck*ey + Wbase*ez and S = s + sbase
+    FlowField uphys(u);
+    FlowField grads(s.Nx(), s.Ny(), s.Nz(), 3, s.Lx(), s.Lz(), s.a(), s.b(), s.cfmpi());
+    grad(s, grads);
+    uphys.makePhysical();
+    grads.makePhysical();
+
+    const Real Vsuck = ctx.flags.Vsuck;
+    f.setState(Physical, Physical);
+    for (lint nx = uphys.nxlocmin(); nx < uphys.nxlocmin() + uphys.Nxloc(); ++nx)
+        for (lint ny = uphys.nylocmin(); ny < uphys.nylocmax(); ++ny)
+            for (lint nz = 0; nz < uphys.Nz(); ++nz)
+                f(nx, ny, nz, 0) = (uphys(nx, ny, nz, 0) + ctx.U[ny]) * grads(nx, ny, nz, 0) +
+                                   (uphys(nx, ny, nz, 1) - Vsuck) * (grads(nx, ny, nz, 1) + dsbasedy[ny]) +
+                                   (uphys(nx, ny, nz, 2) + ctx.W[ny]) * grads(nx, ny, nz, 2);
+    f.makeSpectral();
+}
 
-    // f -= Base;
-    for (int ny = 0; ny < u.Ny(); ++ny) {
-        if (u.taskid() == u.task_coeff(0, 0)) {
-            u.cmplx(0, ny, 0, 0) -= Complex(Ubase(ny), 0.0);
-            u.cmplx(0, ny, 0, 2) -= Complex(Wbase(ny), 0.0);
-        }
-        if (u.taskid() == u.task_coeff(0, 0))
-            T.cmplx(0, ny, 0, 0) -= Complex(Tbase(ny), 0.0);
-    }
-    if (u.taskid() == u.task_coeff(0, 0)) {
-        u.cmplx(0, 0, 0, 1) += Complex(flags.Vsuck, 0.);
-    }
-    
+void temperatureNL(const FlowField& u, const FlowField& T, FlowField& f, const DDCNLContext& ctx) {
+    // goal: (u*grad)T
+    baseflowAdvectionNL(u, T, ctx.dTdy, f, ctx);
 
     // dealiasing modes
-    if (flags.dealias_xz())
+    if (ctx.flags.dealias_xz())
         f.zeroPaddedModes();
 }
 
-void salinityNL(const FlowField& u_, const FlowField& T_, const FlowField& S_, 
-                ChebyCoeff Ubase, ChebyCoeff Wbase, ChebyCoeff Sbase,
-                   FlowField& f, FlowField& tmp, DDCFlags flags) {
-    FlowField& u = const_cast<FlowField&>(u_);
-    FlowField& T = const_cast<FlowField&>(T_);
-    FlowField& S = const_cast<FlowField&>(S_);
-    
-     // goal: (u*grad)s
-
-    // f += Base;
-    for (int ny = 0; ny < u.Ny(); ++ny) {
-        if (u.taskid() == u.task_coeff(0, 0)) {
-            u.cmplx(0, ny, 0, 0) += Complex(Ubase(ny), 0.0);
-            u.cmplx(0, ny, 0, 2) += Complex(Wbase(ny), 0.0);
-        }
-        if (u.taskid() == u.task_coeff(0, 0))
-            S.cmplx(0, ny, 0, 0) += Complex(Sbase(ny), 0.0);
-    }
-    if (u.taskid() == u.task_coeff(0, 0)) {
-        u.cmplx(0, 0, 0, 1) -= Complex(flags.Vsuck, 0.);
-    }
-
-    // compute the nonlinearity (temperature advection (u*grad)S ) analogous to the convectiveNL and store in f
-    dotgradScalar(u, S, f, tmp);
-
-    #ifdef P7
-        for (int mz = f.mzlocmin(); mz < f.mzlocmin() + f.Mzloc(); mz++)
-            for (int mx = f.mxlocmin(); mx < f.mxlocmin() + f.Mxloc(); mx++){
-                ComplexChebyCoeff Tk_(f.Ny(), f.a(), f.b(), Spectral);
-                ComplexChebyCoeff Rtk_(f.Ny(), f.a(), f.b(), Spectral);
-                ComplexChebyCoeff Pyk_(f.Ny(), f.a(), f.b(), Spectral);
-                // Extract relevant Fourier modes of T: use Pk and Rxk
-                for (int ny = 0; ny < f.Ny(); ++ny)
-                    Tk_.set(ny, T.cmplx(mx, ny, mz, 0));
-
-                // (1) Put T" into in R. (Pyk_ is used as tmp workspace)
-                diff2(Tk_, Rtk_, Pyk_);
-
-                for (int ny = 0; ny < f.Ny(); ny++) {
-                    f.cmplx(mx, ny, mz, 0) -= P7*Rtk_[ny];
-                }
-            }
-    #endif
-
-    // f -= Base;
-    for (int ny = 0; ny < u.Ny(); ++ny) {
-        if (u.taskid() == u.task_coeff(0, 0)) {
-            u.cmplx(0, ny, 0, 0) -= Complex(Ubase(ny), 0.0);
-            u.cmplx(0, ny, 0, 2) -= Complex(Wbase(ny), 0.0);
-        }
-        if (u.taskid() == u.task_coeff(0, 0))
-            S.cmplx(0, ny, 0, 0) -= Complex(Sbase(ny), 0.0);
-    }
-    if (u.taskid() == u.task_coeff(0, 0)) {
-        u.cmplx(0, 0, 0, 1) += Complex(flags.Vsuck, 0.);
-    }
+void salinityNL(const FlowField& u, const FlowField& T, const FlowField& S, FlowField& f, const DDCNLContext& ctx) {
+    // goal: (u*grad)S, the cross-diffusion P7*lap(T) is part of the linear term (see DDE::linear)
+    baseflowAdvectionNL(u, S, ctx.dSdy, f, ctx);
 
     // dealiasing modes
-    if (flags.dealias_xz())
+    if (ctx.flags.dealias_xz())
         f.zeroPaddedModes();
 }
 
 DDE::DDE(const std::vector<FlowField>& fields, const DDCFlags& flags)
     : NSE(fields, flags),
-      heatsolver_(0),  // heatsolvers are allocated when reset_lambda is called for the first time
-      saltsolver_(0),
+      solvercache_(),  // solvers are factorized when reset_lambda is called for the first time
+      substepsolver_(),
+      solveruse_(0),
       flags_(flags),
       Tbase_(),
       Tbaseyy_(),
@@ -183,28 +182,32 @@ DDE::DDE(const std::vector<FlowField>& fields, const DDCFlags& flags)
       nonzCw_(false),
       nonzCt_(false),
       nonzCs_(false),
-      Tk_(Nyd_, a_, b_, Spectral),
-      Rtk_(Nyd_, a_, b_, Spectral),
-      Sk_(Nyd_, a_, b_, Spectral),
-      Rsk_(Nyd_, a_, b_, Spectral),
+      nlctx_(Ubase_, Wbase_, Tbase_, Sbase_, flags_),
       baseflow_(false),
-      constraint_(false) {
+      constraint_(false),
+      selmomentum_(true),
+      selheat_(true),
+      selsalt_(true) {
     
     // set member variables for base flow
     createDDCBaseFlow();
-    Pbasey_ = hydrostaticPressureGradientY(Tbase_, Sbase_, flags_);
 
     // set member variables for contraint
     initDDCConstraint(fields[0]);
 
     // define the constant terms of the DDE
     createConstants();
+
+    // allocate the workspace of the fused nonlinear term and of the Fourier-mode loops
+    initNLWorkspace(fields[0]);
+    initModeWorkspace();
 }
 
 DDE::DDE(const std::vector<FlowField>& fields, const std::vector<ChebyCoeff>& base, const DDCFlags& flags)
     : NSE(fields, base, flags),
-      heatsolver_(0),  // heatsolvers are allocated when reset_lambda is called for the first time
-      saltsolver_(0),
+      solvercache_(),  // solvers are factorized when reset_lambda is called for the first time
+      substepsolver_(),
+      solveruse_(0),
       flags_(flags),
       Tbase_(base[2]),
       Tbaseyy_(),
@@ -219,12 +222,12 @@ DDE::DDE(const std::vector<FlowField>& fields, const std::vector<ChebyCoeff>& ba
       nonzCw_(false),
       nonzCt_(false),
       nonzCs_(false),
-      Tk_(Nyd_, a_, b_, Spectral),
-      Rtk_(Nyd_, a_, b_, Spectral),
-      Sk_(Nyd_, a_, b_, Spectral),
-      Rsk_(Nyd_, a_, b_, Spectral),
+      nlctx_(Ubase_, Wbase_, Tbase_, Sbase_, flags_),
       baseflow_(false),
-      constraint_(false) {
+      constraint_(false),
+      selmomentum_(true),
+      selheat_(true),
+      selsalt_(true) {
     
 
     baseflow_ = true;  // base flow is passed to constructor
@@ -235,61 +238,168 @@ DDE::DDE(const std::vector<FlowField>& fields, const std::vector<ChebyCoeff>& ba
 
     // define the constant terms of the DDE
     createConstants();
+
+    // allocate the workspace of the fused nonlinear term and of the Fourier-mode loops
+    initNLWorkspace(fields[0]);
+    initModeWorkspace();
 }
 
 DDE::~DDE() {
-    if (tausolver_) {
-        for (uint j = 0; j < lambda_t_.size(); ++j) {
-            for (int mx = 0; mx < Mxloc_; ++mx) {
-                delete[] tausolver_[j][mx];  // undo new #3
-                tausolver_[j][mx] = 0;
-            }
-            delete[] tausolver_[j];  // undo new #2
-            tausolver_[j] = 0;
-        }
-        delete[] tausolver_;  // undo new #1
-        tausolver_ = 0;
-    }
-    #ifdef P5
-    if (heatsolver_) {
-        for (uint j = 0; j < lambda_t_.size(); ++j) {
-            for (int mx = 0; mx < Mxloc_; ++mx) {
-                delete[] heatsolver_[j][mx];  // undo new #3
-                heatsolver_[j][mx] = 0;
-            }
-            delete[] heatsolver_[j];  // undo new #2
-            heatsolver_[j] = 0;
-        }
-        delete[] heatsolver_;  // undo new #1
-        heatsolver_ = 0;
-    }
-    #endif
-    #ifdef P6
-    if (saltsolver_) {
-        for (uint j = 0; j < lambda_t_.size(); ++j) {
-            for (int mx = 0; mx < Mxloc_; ++mx) {
-                delete[] saltsolver_[j][mx];  // undo new #3
-                saltsolver_[j][mx] = 0;
-            }
-            delete[] saltsolver_[j];  // undo new #2
-            saltsolver_[j] = 0;
-        }
-        delete[] saltsolver_;  // undo new #1
-        saltsolver_ = 0;
-    }
-    #endif
+    // the solver sets release their memory themselves,
+    // NSE::tausolver_ is never allocated by DDE
 }
 
 void DDE::nonlinear(const std::vector<FlowField>& infields, std::vector<FlowField>& outfields) {//infields=[u,T,S,p] and outfields[u,T,S]
     // The first entry in vector must be velocity FlowField, the second a temperature FlowField, and third is salinity FlowField.
     // Pressure as third entry in in/outfields is not touched.
-    momentumNL(infields[0], infields[1], infields[2], Ubase_,Wbase_, outfields[0], tmp_, flags_);
-    #ifdef P5
-    temperatureNL(infields[0], infields[1], Ubase_,Wbase_,Tbase_, outfields[1], tmp_, flags_);
-    #endif
-    #ifdef P6
-    salinityNL(infields[0], infields[1], infields[2], Ubase_,Wbase_,Sbase_, outfields[2], tmp_, flags_);
-    #endif
+    if (flags_.nonlinearity == Convection || flags_.nonlinearity == Rotational) {
+        // fused evaluation: one transform of u, T, S and their gradients, one backward transform of all results
+        advectionNL(infields, outfields, selmomentum_);
+        if (selmomentum_)
+            buoyancyNL(infields[1], infields[2], outfields[0], nlctx_);
+    } else {
+        // other forms of the momentum nonlinearity are evaluated by channelflow, the scalars are advected as above
+        if (selmomentum_)
+            momentumNL(infields[0], infields[1], infields[2], outfields[0], tmp_, nlctx_);
+        advectionNL(infields, outfields, false);
+    }
+
+    // dealiasing modes
+    if (flags_.dealias_xz()) {
+        if (selmomentum_)
+            outfields[0].zeroPaddedModes();
+        if (nlctx_.temperature && selheat_)
+            outfields[1].zeroPaddedModes();
+        if (nlctx_.salinity && selsalt_)
+            outfields[2].zeroPaddedModes();
+    }
+}
+
+void DDE::advectionNL(const std::vector<FlowField>& infields, std::vector<FlowField>& outfields, bool momentum) {
+    // select the specialization for the active and selected equations, the sweep below has no branches on them
+    const bool heat = nlctx_.temperature && selheat_;
+    const bool salt = nlctx_.salinity && selsalt_;
+    if (momentum) {
+        if (heat && salt)
+            advectionKernel<true, true, true>(infields, outfields);
+        else if (heat)
+            advectionKernel<true, true, false>(infields, outfields);
+        else if (salt)
+            advectionKernel<true, false, true>(infields, outfields);
+        else
+            advectionKernel<true, false, false>(infields, outfields);
+    } else {
+        if (heat && salt)
+            advectionKernel<false, true, true>(infields, outfields);
+        else if (heat)
+            advectionKernel<false, true, false>(infields, outfields);
+        else if (salt)
+            advectionKernel<false, false, true>(infields, outfields);
+    }
+}
+
+template <bool Momentum, bool Heat, bool Salt>
+void DDE::advectionKernel(const std::vector<FlowField>& infields, std::vector<FlowField>& outfields) {
+    // goal: f = [(U*grad)U, (U*grad)T, (U*grad)S] with total fields U=u+Ubase, T=T'+Tbase, S=S'+Sbase
+    // The convective form gives (U*grad)U, the rotational form (curl U) x U.
+    // The base flow is added inside the physical-space products, the input fields are not modified.
+    const bool rotational = (flags_.nonlinearity == Rotational);
+
+    // gradients of the fluctuations in spectral space (the workspace is still physical from the previous call)
+    if (Momentum) {
+        nlgradu_.setState(Spectral, Spectral);
+        grad(infields[0], nlgradu_);
+    }
+    if (Heat) {
+        nlgradt_.setState(Spectral, Spectral);
+        grad(infields[1], nlgradt_);
+    }
+    if (Salt) {
+        nlgrads_.setState(Spectral, Spectral);
+        grad(infields[2], nlgrads_);
+    }
+
+    // one forward transform of every input
+    nlu_ = infields[0];
+    nlu_.makePhysical();
+    if (Momentum)
+        nlgradu_.makePhysical();
+    if (Heat)
+        nlgradt_.makePhysical();
+    if (Salt)
+        nlgrads_.makePhysical();
+
+    // base profiles on the Chebyshev points
+    const std::vector<Real>& Ub = nlctx_.U;
+    const std::vector<Real>& Wb = nlctx_.W;
+    const std::vector<Real>& dUbdy = nlctx_.dUdy;
+    const std::vector<Real>& dWbdy = nlctx_.dWdy;
+    const std::vector<Real>& dTbdy = nlctx_.dTdy;
+    const std::vector<Real>& dSbdy = nlctx_.dSdy;
+    const Real Vsuck = flags_.Vsuck;
+
+    // single sweep through physical space
+    nlf_.setState(Physical, Physical);
+    const lint nxlocmin = nlu_.nxlocmin();
+    const lint nxlocmax = nlu_.nxlocmin() + nlu_.Nxloc();
+    const lint nylocmin = nlu_.nylocmin();
+    const lint nylocmax = nlu_.nylocmax();
+    const lint Nz = nlu_.Nz();
+    for (lint nx = nxlocmin; nx < nxlocmax; ++nx)
+        for (lint ny = nylocmin; ny < nylocmax; ++ny)
+            for (lint nz = 0; nz < Nz; ++nz) {
+                // total velocity
+                const Real u = nlu_(nx, ny, nz, 0) + Ub[ny];
+                const Real v = nlu_(nx, ny, nz, 1) - Vsuck;
+                const Real w = nlu_(nx, ny, nz, 2) + Wb[ny];
+
+                if (Momentum) {
+                    // total velocity gradient, the base flow only contributes dUbase/dy and dWbase/dy
+                    Real g[9];
+                    for (int k = 0; k < 9; ++k)
+                        g[k] = nlgradu_(nx, ny, nz, k);
+                    g[i3j(0, 1)] += dUbdy[ny];
+                    g[i3j(2, 1)] += dWbdy[ny];
+
+                    if (rotational) {
+                        // omega = curl(U), f = omega x U
+                        const Real omx = g[i3j(2, 1)] - g[i3j(1, 2)];
+                        const Real omy = g[i3j(0, 2)] - g[i3j(2, 0)];
+                        const Real omz = g[i3j(1, 0)] - g[i3j(0, 1)];
+                        nlf_(nx, ny, nz, 0) = omy * w - omz * v;
+                        nlf_(nx, ny, nz, 1) = omz * u - omx * w;
+                        nlf_(nx, ny, nz, 2) = omx * v - omy * u;
+                    } else {
+                        for (int i = 0; i < 3; ++i)
+                            nlf_(nx, ny, nz, i) = u * g[i3j(i, 0)] + v * g[i3j(i, 1)] + w * g[i3j(i, 2)];
+                    }
+                }
+                if (Heat)
+                    nlf_(nx, ny, nz, 3) = u * nlgradt_(nx, ny, nz, 0) + v * (nlgradt_(nx, ny, nz, 1) + dTbdy[ny]) +
+                                          w * nlgradt_(nx, ny, nz, 2);
+                if (Salt)
+                    nlf_(nx, ny, nz, nlf_.Nd() - 1) = u * nlgrads_(nx, ny, nz, 0) +
+                                                      v * (nlgrads_(nx, ny, nz, 1) + dSbdy[ny]) +
+                                                      w * nlgrads_(nx, ny, nz, 2);
+            }
+
+    // one backward transform of all results
+    nlf_.makeSpectral();
+
+    // unstack the results
+    for (int mx = nlf_.mxlocmin(); mx < nlf_.mxlocmin() + nlf_.Mxloc(); ++mx)
+        for (int mz = nlf_.mzlocmin(); mz < nlf_.mzlocmin() + nlf_.Mzloc(); ++mz)
+            for (int ny = 0; ny < nlf_.Ny(); ++ny) {
+                if (Momentum) {
+                    outfields[0].cmplx(mx, ny, mz, 0) = nlf_.cmplx(mx, ny, mz, 0);
+                    outfields[0].cmplx(mx, ny, mz, 1) = nlf_.cmplx(mx, ny, mz, 1);
+                    outfields[0].cmplx(mx, ny, mz, 2) = nlf_.cmplx(mx, ny, mz, 2);
+                }
+                if (Heat)
+                    outfields[1].cmplx(mx, ny, mz, 0) = nlf_.cmplx(mx, ny, mz, 3);
+                if (Salt)
+                    outfields[2].cmplx(mx, ny, mz, 0) = nlf_.cmplx(mx, ny, mz, nlf_.Nd() - 1);
+            }
 }
 
 void DDE::linear(const std::vector<FlowField>& infields, std::vector<FlowField>& outfields) {//infields=[u,T,S,p] and outfields[u,T,S]
@@ -297,98 +407,123 @@ void DDE::linear(const std::vector<FlowField>& infields, std::vector<FlowField>&
 
     // Make sure user does not expect a pressure output. Outfields should be created outside DDE with DDE::createRHS()
     assert(infields.size() == (outfields.size() + 1));
+
+    // select the specialization for the active equations, the mode loop has no branches on them
+    if (nlctx_.crossdiffusion)
+        linearKernel<true, true, true>(infields, outfields);
+    else if (nlctx_.salinity)
+        linearKernel<true, true, false>(infields, outfields);
+    else if (nlctx_.temperature)
+        linearKernel<true, false, false>(infields, outfields);
+    else
+        linearKernel<false, false, false>(infields, outfields);
+}
+
+template <bool Heat, bool Salt, bool Soret>
+void DDE::linearKernel(const std::vector<FlowField>& infields, std::vector<FlowField>& outfields) {
     const int kxmax = infields[0].kxmax();
     const int kzmax = infields[0].kzmax();
-    const Real Rey = flags_.Rey;
-    const Real Pr = flags_.Pr;
-    const Real Ra = flags_.Ra;
-    const Real Le = flags_.Le;
-    const Real Rrho = flags_.Rrho;
-    const Real Ri = flags_.Ri;
-    
+    const Real p1 = nlctx_.p1;
+    const Real p5 = nlctx_.p5;
+    const Real p6 = nlctx_.p6;
+    const Real p7 = nlctx_.p7;
 
     // Loop over Fourier modes. 2nd derivative and summation of linear term
     // is most sufficient on ComplexChebyCoeff. Therefore, the old loop structure is kept.
-    for (lint mx = mxlocmin_; mx < mxlocmin_ + Mxloc_; ++mx) {
+    // The modes are independent, so with OpenMP the (mx,mz) pairs are distributed over the threads,
+    // each thread working on its own scratch profiles. Every mode is computed exactly as in the serial loop.
+    const lint Nmodes = Mxloc_ * Mzloc_;
+#ifdef _OPENMP
+    const int nthreads = modeThreads();
+#pragma omp parallel for schedule(dynamic, 16) num_threads(nthreads)
+#endif
+    for (lint imode = 0; imode < Nmodes; ++imode) {
+        const lint mx = mxlocmin_ + imode / Mzloc_;
+        const lint mz = mzlocmin_ + imode % Mzloc_;
         const int kx = infields[0].kx(mx);
-        for (lint mz = mzlocmin_; mz < mzlocmin_ + Mzloc_; ++mz) {
-            const int kz = infields[0].kz(mz);
-
-            // Skip last and aliased modes
-            if ((kx == kxmax || kz == kzmax) || (flags_.dealias_xz() && isAliasedMode(kx, kz)))
-                break;
-
-            // Compute linear momentum terms
-            //================================
-            // Goal is to compute
-            // L = Pr*u" - Pr*kappa^2*u - grad(p) [+ d2y2Ubase - grad(p0)]
+        const int kz = infields[0].kz(mz);
 
-            // Extract relevant Fourier modes of uj and qj
-            // get (u) into u_(uk_,vk_,wk_) and get p_
-            for (int ny = 0; ny < Nyd_; ++ny) {
-                uk_.set(ny, infields[0].cmplx(mx, ny, mz, 0)); // uk = u
-                vk_.set(ny, infields[0].cmplx(mx, ny, mz, 1)); // vk = v
-                wk_.set(ny, infields[0].cmplx(mx, ny, mz, 2)); // wk = w
-                Pk_.set(ny, infields[3].cmplx(mx, ny, mz, 0));  // pressure is 4. entry in fields, Pk = p
-            }
+        // Skip last and aliased modes
+        if ((kx == kxmax || kz == kzmax) || (flags_.dealias_xz() && isAliasedMode(kx, kz)))
+            continue;
 
-            // (1) Put nu uj" into in R. (Pyk_ is used as tmp workspace)
-            // get (\nu*u"=(\nu*u)") into variable R(Ruk_,Rvk_,Rwk_)
-            // diff2(in,out,temp) --> out = d2(in)/dy2
-            diff2(uk_, Ruk_, Pyk_); // Ruk = d2(u)/dy2
-            diff2(vk_, Rvk_, Pyk_); // Rvk = d2(v)/dy2
-            diff2(wk_, Rwk_, Pyk_); // Rwk = d2(w)/dy2
+#ifdef _OPENMP
+        DDEModeWorkspace& ws = modews_[omp_get_thread_num()];
+#else
+        DDEModeWorkspace& ws = modews_[0];
+#endif
 
-            // (2) Put qn' into Pyk (compute y-comp of pressure gradient).
-            // get grad(p(y))=(dx*p_=Dx*pk_,dy*p_=dpk_/dy,dz*p_=Dz*pk_)
-            // diff(in,out) --> out=d(in)/dy
-            diff(Pk_, Pyk_); // Pk = dp/dy
+        // Compute linear momentum terms
+        //================================
+        // Goal is to compute
+        // L = Pr*u" - Pr*kappa^2*u - grad(p) [+ d2y2Ubase - grad(p0)]
+
+        // Extract relevant Fourier modes of uj and qj
+        // get (u) into u_(ws.uk,ws.vk,ws.wk) and get p_
+        for (int ny = 0; ny < Nyd_; ++ny) {
+            ws.uk.set(ny, infields[0].cmplx(mx, ny, mz, 0)); // uk = u
+            ws.vk.set(ny, infields[0].cmplx(mx, ny, mz, 1)); // vk = v
+            ws.wk.set(ny, infields[0].cmplx(mx, ny, mz, 2)); // wk = w
+            ws.Pk.set(ny, infields[3].cmplx(mx, ny, mz, 0));  // pressure is 4. entry in fields, Pk = p
+        }
 
-            // (3) Summation of all derivative terms and assignment to output velocity field.
-            const Real k2 = 4 * pi * pi * (square(kx / Lx_) + square(kz / Lz_));
-            const Complex Dx = infields[0].Dx(mx); // get dx
-            const Complex Dz = infields[0].Dz(mz); // get dz
-            for (int ny = 0; ny < Nyd_; ++ny) {
-                outfields[0].cmplx(mx, ny, mz, 0) = P1*Ruk_[ny] - P1*k2*uk_[ny] - Dx * Pk_[ny]; // Pr*d2(u)/dy2-Pr*nablaxz^2*(u)-dp/dx
-                outfields[0].cmplx(mx, ny, mz, 1) = P1*Rvk_[ny] - P1*k2*vk_[ny] - Pyk_[ny];     // Pr*d2(v)/dy2-Pr*nablaxz^2*(v)-dp/dy
-                outfields[0].cmplx(mx, ny, mz, 2) = P1*Rwk_[ny] - P1*k2*wk_[ny] - Dz * Pk_[ny]; // Pr*d2(w)/dy2-Pr*nablaxz^2*(w)-dp/dz
+        // (1) Put nu uj" into in R. (ws.Pyk is used as tmp workspace)
+        // get (\nu*u"=(\nu*u)") into variable R(ws.Ruk,ws.Rvk,ws.Rwk)
+        // diff2(in,out,temp) --> out = d2(in)/dy2
+        diff2(ws.uk, ws.Ruk, ws.Pyk); // Ruk = d2(u)/dy2
+        diff2(ws.vk, ws.Rvk, ws.Pyk); // Rvk = d2(v)/dy2
+        diff2(ws.wk, ws.Rwk, ws.Pyk); // Rwk = d2(w)/dy2
+
+        // (2) Put qn' into Pyk (compute y-comp of pressure gradient).
+        // get grad(p(y))=(dx*p_=Dx*pk_,dy*p_=dpk_/dy,dz*p_=Dz*pk_)
+        // diff(in,out) --> out=d(in)/dy
+        diff(ws.Pk, ws.Pyk); // Pk = dp/dy
+
+        // (3) Summation of all derivative terms and assignment to output velocity field.
+        const Real k2 = 4 * pi * pi * (square(kx / Lx_) + square(kz / Lz_));
+        const Complex Dx = infields[0].Dx(mx); // get dx
+        const Complex Dz = infields[0].Dz(mz); // get dz
+        for (int ny = 0; ny < Nyd_; ++ny) {
+            outfields[0].cmplx(mx, ny, mz, 0) = p1*ws.Ruk[ny] - p1*k2*ws.uk[ny] - Dx * ws.Pk[ny]; // Pr*d2(u)/dy2-Pr*nablaxz^2*(u)-dp/dx
+            outfields[0].cmplx(mx, ny, mz, 1) = p1*ws.Rvk[ny] - p1*k2*ws.vk[ny] - ws.Pyk[ny];     // Pr*d2(v)/dy2-Pr*nablaxz^2*(v)-dp/dy
+            outfields[0].cmplx(mx, ny, mz, 2) = p1*ws.Rwk[ny] - p1*k2*ws.wk[ny] - Dz * ws.Pk[ny]; // Pr*d2(w)/dy2-Pr*nablaxz^2*(w)-dp/dz
+        }
+        // (4) Add const. terms Cu=d2y2Ubase-dPdx
+        if (kx == 0 && kz == 0) {
+            // L includes const dissipation term of Ubase and Wbase: nu Uyy, nu Wyy
+            if (Ubaseyy_.length() > 0)
+                for (int ny = 0; ny < My_; ++ny)
+                    outfields[0].cmplx(mx, ny, mz, 0) += Complex(p1 * Ubaseyy_[ny], 0);
+            if (Wbaseyy_.length() > 0)
+                for (int ny = 0; ny < My_; ++ny)
+                    outfields[0].cmplx(mx, ny, mz, 2) += Complex(p1 * Wbaseyy_[ny], 0);
+
+            // Add base pressure gradient depending on the constraint
+            if (flags_.constraint == PressureGradient) {
+                // dPdx [is grad(p0)] is supplied as dPdxRef []
+                outfields[0].cmplx(mx, 0, mz, 0) -= Complex(dPdxRef_, 0);
+                outfields[0].cmplx(mx, 0, mz, 2) -= Complex(dPdzRef_, 0);
+            } else {  // const bulk velocity [is pressure gradient grad(p0) constructed from input velocity field]
+                // actual dPdx is unknown but defined by constraint of bulk velocity
+                // Determine actual dPdx from Ubase + u.
+                Real Ly = b_ - a_;
+                diff(ws.uk, ws.Ruk);
+                diff(ws.wk, ws.Rwk);
+                Real dPdxAct = Re(ws.Ruk.eval_b() - ws.Ruk.eval_a()) / Ly;
+                Real dPdzAct = Re(ws.Rwk.eval_b() - ws.Rwk.eval_a()) / Ly;
+                ChebyCoeff Ubasey = diff(Ubase_);
+                ChebyCoeff Wbasey = diff(Wbase_);
+                if (Ubase_.length() != 0)
+                    dPdxAct += p1 * (Ubasey.eval_b() - Ubasey.eval_a()) / Ly;
+                if (Wbase_.length() != 0)
+                    dPdzAct += p1 * (Wbasey.eval_b() - Wbasey.eval_a()) / Ly;
+                // add press. gradient to linear term
+                outfields[0].cmplx(mx, 0, mz, 0) -= Complex(dPdxAct, 0);
+                outfields[0].cmplx(mx, 0, mz, 2) -= Complex(dPdzAct, 0);
             }
-            // (4) Add const. terms Cu=d2y2Ubase-dPdx
-            if (kx == 0 && kz == 0) {
-                // L includes const dissipation term of Ubase and Wbase: nu Uyy, nu Wyy
-                if (Ubaseyy_.length() > 0)
-                    for (int ny = 0; ny < My_; ++ny)
-                        outfields[0].cmplx(mx, ny, mz, 0) += Complex(P1 * Ubaseyy_[ny], 0);
-                if (Wbaseyy_.length() > 0)
-                    for (int ny = 0; ny < My_; ++ny)
-                        outfields[0].cmplx(mx, ny, mz, 2) += Complex(P1 * Wbaseyy_[ny], 0);
-
-                // Add base pressure gradient depending on the constraint
-                if (flags_.constraint == PressureGradient) {
-                    // dPdx [is grad(p0)] is supplied as dPdxRef []
-                    outfields[0].cmplx(mx, 0, mz, 0) -= Complex(dPdxRef_, 0);
-                    outfields[0].cmplx(mx, 0, mz, 2) -= Complex(dPdzRef_, 0);
-                } else {  // const bulk velocity [is pressure gradient grad(p0) constructed from input velocity field]
-                    // actual dPdx is unknown but defined by constraint of bulk velocity
-                    // Determine actual dPdx from Ubase + u.
-                    Real Ly = b_ - a_;
-                    diff(uk_, Ruk_);
-                    diff(wk_, Rwk_);
-                    Real dPdxAct = Re(Ruk_.eval_b() - Ruk_.eval_a()) / Ly;
-                    Real dPdzAct = Re(Rwk_.eval_b() - Rwk_.eval_a()) / Ly;
-                    ChebyCoeff Ubasey = diff(Ubase_);
-                    ChebyCoeff Wbasey = diff(Wbase_);
-                    if (Ubase_.length() != 0)
-                        dPdxAct += P1 * (Ubasey.eval_b() - Ubasey.eval_a()) / Ly;
-                    if (Wbase_.length() != 0)
-                        dPdzAct += P1 * (Wbasey.eval_b() - Wbasey.eval_a()) / Ly;
-                    // add press. gradient to linear term
-                    outfields[0].cmplx(mx, 0, mz, 0) -= Complex(dPdxAct, 0);
-                    outfields[0].cmplx(mx, 0, mz, 2) -= Complex(dPdzAct, 0);
-                }
-            }  // End of const. terms
+        }  // End of const. terms
 
-            #ifdef P5
+        if (Heat) {
             // Compute linear heat equation terms
             //================================
             // Goal is to compute
@@ -396,16 +531,16 @@ void DDE::linear(const std::vector<FlowField>& infields, std::vector<FlowField>&
 
             // Extract relevant Fourier modes of T: use Pk and Rxk
             for (int ny = 0; ny < Nyd_; ++ny)
-                Tk_.set(ny, infields[1].cmplx(mx, ny, mz, 0));
+                ws.Tk.set(ny, infields[1].cmplx(mx, ny, mz, 0));
 
-            // (1) Put kappa T" into in R. (Pyk_ is used as tmp workspace)
-            diff2(Tk_, Rtk_, Pyk_);
+            // (1) Put kappa T" into in R. (ws.Pyk is used as tmp workspace)
+            diff2(ws.Tk, ws.Rtk, ws.Pyk);
 
             // (2+3) Summation of both diffusive terms and linear advection of temperature.
             // k2 and Dx were defined above for the current Fourier mode
             for (int ny = 0; ny < Nyd_; ++ny)
-                // from nonlinear:  - Dx*Tk_[ny]*Complex(Ubase_[ny],0)/kappa;
-                outfields[1].cmplx(mx, ny, mz, 0) = P5*Rtk_[ny] - P5*k2 * Tk_[ny];
+                // from nonlinear:  - Dx*ws.Tk[ny]*Complex(Ubase_[ny],0)/kappa;
+                outfields[1].cmplx(mx, ny, mz, 0) = p5*ws.Rtk[ny] - p5*k2 * ws.Tk[ny];
 
             // (4) Add const. terms [don't need this, because Ct=d2y2Tbase=0]
             if (kx == 0 && kz == 0) {
@@ -414,26 +549,31 @@ void DDE::linear(const std::vector<FlowField>& infields, std::vector<FlowField>&
                     for (int ny = 0; ny < My_; ++ny)
                         outfields[1].cmplx(mx, ny, mz, 0) += Ct_[ny];
             }
-            #endif
+        }
 
-            #ifdef P6
+        if (Salt) {
             // Compute linear salt equation terms
             //================================
             // Goal is to compute
-            // L = 1/Le*S" - kappa^2 *1/Le*S [+ d2y2Sbase]
+            // L = 1/Le*S" - kappa^2 *1/Le*S [+ P7*(T" - kappa^2*T)] [+ d2y2Sbase]
 
             // Extract relevant Fourier modes of S: use Sk and Rsk
             for (int ny = 0; ny < Nyd_; ++ny)
-                Sk_.set(ny, infields[2].cmplx(mx, ny, mz, 0));
+                ws.Sk.set(ny, infields[2].cmplx(mx, ny, mz, 0));
 
-            // (1) Put S" into in R. (Pyk_ is used as tmp workspace)
-            diff2(Sk_, Rsk_, Pyk_);
+            // (1) Put S" into in R. (ws.Pyk is used as tmp workspace)
+            diff2(ws.Sk, ws.Rsk, ws.Pyk);
 
             // (2+3) Summation of both diffusive terms and linear advection of temperature.
             // k2 and Dx were defined above for the current Fourier mode
             for (int ny = 0; ny < Nyd_; ++ny)
-                // from nonlinear:  - Dx*Tk_[ny]*Complex(Ubase_[ny],0)/kappa;
-                outfields[2].cmplx(mx, ny, mz, 0) =  P6*Rsk_[ny] -  P6*k2*Sk_[ny];
+                // from nonlinear:  - Dx*ws.Tk[ny]*Complex(Ubase_[ny],0)/kappa;
+                outfields[2].cmplx(mx, ny, mz, 0) =  p6*ws.Rsk[ny] -  p6*k2*ws.Sk[ny];
+
+            // (3b) Cross-diffusion P7*lap(T), T and T" are still in ws.Tk and ws.Rtk from the heat equation
+            if (Soret)
+                for (int ny = 0; ny < Nyd_; ++ny)
+                    outfields[2].cmplx(mx, ny, mz, 0) += p7 * (ws.Rtk[ny] - k2 * ws.Tk[ny]);
 
             // (4) Add const. terms [don't need this, because Cs=d2y2Sbase=0]
             if (kx == 0 && kz == 0) {
@@ -442,7 +582,6 @@ void DDE::linear(const std::vector<FlowField>& infields, std::vector<FlowField>&
                     for (int ny = 0; ny < My_; ++ny)
                         outfields[2].cmplx(mx, ny, mz, 0) += Cs_[ny];
             }
-            #endif
         }
     }  // End of loop over Fourier modes
 }
@@ -454,253 +593,311 @@ void DDE::solve(std::vector<FlowField>& outfields, const std::vector<FlowField>&
     assert(outfields.size() == (rhs.size() + 1));
     const int kxmax = outfields[0].kxmax();
     const int kzmax = outfields[0].kzmax();
-
-    // Update each Fourier mode with solution of the implicit problem
-    for (lint ix = 0; ix < Mxloc_; ++ix) {
+    DDESolverSet& solvers = solvercache_[substepsolver_[s]];
+
+    // Update each Fourier mode with solution of the implicit problem.
+    // The modes are independent, so with OpenMP the (mx,mz) pairs are distributed over the threads,
+    // each thread working on its own scratch profiles. Nothing to do if the momentum equation is deselected.
+    const lint Nmodes = selmomentum_ ? Mxloc_ * Mzloc_ : 0;
+#ifdef _OPENMP
+    const int nthreads = modeThreads();
+#pragma omp parallel for schedule(dynamic, 16) num_threads(nthreads)
+#endif
+    for (lint imode = 0; imode < Nmodes; ++imode) {
+        const lint ix = imode / Mzloc_;
+        const lint iz = imode % Mzloc_;
         const lint mx = ix + mxlocmin_;
         const int kx = outfields[0].kx(mx);
+        const lint mz = iz + mzlocmin_;
+        const int kz = outfields[0].kz(mz);
 
-        for (lint iz = 0; iz < Mzloc_; ++iz) {
-            const lint mz = iz + mzlocmin_;
-            const int kz = outfields[0].kz(mz);
+        // Skip last and aliased modes
+        if ((kx == kxmax || kz == kzmax) || (flags_.dealias_xz() && isAliasedMode(kx, kz)))
+            continue;
 
-            // Skip last and aliased modes
-            if ((kx == kxmax || kz == kzmax) || (flags_.dealias_xz() && isAliasedMode(kx, kz)))
-                break;
+#ifdef _OPENMP
+        DDEModeWorkspace& ws = modews_[omp_get_thread_num()];
+#else
+        DDEModeWorkspace& ws = modews_[0];
+#endif
 
-            // Construct ComplexChebyCoeff
-            for (int ny = 0; ny < Nyd_; ++ny) {
-                Ruk_.set(ny, rhs[0].cmplx(mx, ny, mz, 0));
-                Rvk_.set(ny, rhs[0].cmplx(mx, ny, mz, 1));
-                Rwk_.set(ny, rhs[0].cmplx(mx, ny, mz, 2));
-                // negative RHS because HelmholtzSolver solves the negative problem
-                #ifdef P5
-                Rtk_.set(ny, -rhs[1].cmplx(mx, ny, mz, 0));
-                #endif
-                #ifdef P6
-                Rsk_.set(ny, -rhs[2].cmplx(mx, ny, mz, 0));
-                #endif
-            }
+        // Construct ComplexChebyCoeff
+        for (int ny = 0; ny < Nyd_; ++ny) {
+            ws.Ruk.set(ny, rhs[0].cmplx(mx, ny, mz, 0));
+            ws.Rvk.set(ny, rhs[0].cmplx(mx, ny, mz, 1));
+            ws.Rwk.set(ny, rhs[0].cmplx(mx, ny, mz, 2));
+        }
 
-            
-            // Solve the tau equations for momentum
-            //=============================
-            if (kx != 0 || kz != 0)
-                tausolver_[s][ix][iz].solve(uk_, vk_, wk_, Pk_, Ruk_, Rvk_, Rwk_);
-            // 	solve(ix,iz,uk_,vk_,wk_,Pk_, Ruk_,Rvk_,Rwk_);
-            else {  // kx,kz == 0,0
-                // LHS includes also the constant terms C which can be added to RHS
-                if (nonzCu_ || nonzCw_) {
-                    for (int ny = 0; ny < My_; ++ny) {
-                        Ruk_.re[ny] += Cu_.re[ny];
-                        Rwk_.re[ny] += Cw_.re[ny];
-                    }
-                }
-                
-                
-                if (flags_.constraint == PressureGradient) {
-                    // pressure is supplied, put on RHS of tau eqn
-                    Ruk_.re[0] -= dPdxRef_;
-                    Rwk_.re[0] -= dPdzRef_;
-                    tausolver_[s][ix][iz].solve(uk_, vk_, wk_, Pk_, Ruk_, Rvk_, Rwk_);
-                    // 	  solve(ix,iz,uk_, vk_, wk_, Pk_, Ruk_,Rvk_,Rwk_);
-                    // Bulk vel is free variable determined from soln of tau eqn //TODO: write method that computes
-                    // UbulkAct everytime it is needed
-
-                } else {  // const bulk velocity
-                    // bulk velocity is supplied, use alternative tau solver
-
-                    // Use tausolver with additional variable and constraint:
-                    // free variable: dPdxAct at next time-step,
-                    // constraint:    UbulkBase + mean(u) = UbulkRef.
-                    tausolver_[s][ix][iz].solve(uk_, vk_, wk_, Pk_, dPdxAct_, dPdzAct_, Ruk_, Rvk_, Rwk_,
-                                                UbulkRef_ - UbulkBase_, WbulkRef_ - WbulkBase_);
-                    // 	  solve(ix,iz,uk_, vk_, wk_, Pk_, dPdxAct_, dPdzAct_,
-                    // 				    Ruk_, Rvk_, Rwk_,
-                    // 				    UbulkRef_ - UbulkBase_,
-                    // 				    WbulkRef_ - WbulkBase_);
-
-                    // test if UbulkRef == UbulkAct = UbulkBase_ + uk_.re.mean()
-                    assert((UbulkRef_ - UbulkBase_ - uk_.re.mean()) < 1e-15);
-                    // test if WbulkRef == WbulkAct = WbulkBase_ + wk_.re.mean()
-                    assert((WbulkRef_ - WbulkBase_ - wk_.re.mean()) < 1e-15);
+        
+        // Solve the tau equations for momentum
+        //=============================
+        if (kx != 0 || kz != 0)
+            solvers.tau(0, ix, iz).solve(ws.uk, ws.vk, ws.wk, ws.Pk, ws.Ruk, ws.Rvk, ws.Rwk);
+        // 	solve(ix,iz,ws.uk,ws.vk,ws.wk,ws.Pk, ws.Ruk,ws.Rvk,ws.Rwk);
+        else {  // kx,kz == 0,0
+            // LHS includes also the constant terms C which can be added to RHS
+            if (nonzCu_ || nonzCw_) {
+                for (int ny = 0; ny < My_; ++ny) {
+                    ws.Ruk.re[ny] += Cu_.re[ny];
+                    ws.Rwk.re[ny] += Cw_.re[ny];
                 }
-                    
             }
-            // Load solutions into u and p.
-            // Because of FFTW complex symmetries
-            // The 0,0 mode must be real.
-            // For Nx even, the kxmax,0 mode must be real
-            // For Nz even, the 0,kzmax mode must be real
-            // For Nx,Nz even, the kxmax,kzmax mode must be real
-            if ((kx == 0 && kz == 0) || (outfields[0].Nx() % 2 == 0 && kx == kxmax && kz == 0) ||
-                (outfields[0].Nz() % 2 == 0 && kz == kzmax && kx == 0) ||
-                (outfields[0].Nx() % 2 == 0 && outfields[0].Nz() % 2 == 0 && kx == kxmax && kz == kzmax)) {
-                for (int ny = 0; ny < Nyd_; ++ny) {
-                    outfields[0].cmplx(mx, ny, mz, 0) = Complex(Re(uk_[ny]), 0.0);
-                    outfields[0].cmplx(mx, ny, mz, 1) = Complex(Re(vk_[ny]), 0.0);
-                    outfields[0].cmplx(mx, ny, mz, 2) = Complex(Re(wk_[ny]), 0.0);
-                    outfields[3].cmplx(mx, ny, mz, 0) = Complex(Re(Pk_[ny]), 0.0);
-                }
+            
+            
+            if (flags_.constraint == PressureGradient) {
+                // pressure is supplied, put on RHS of tau eqn
+                ws.Ruk.re[0] -= dPdxRef_;
+                ws.Rwk.re[0] -= dPdzRef_;
+                solvers.tau(0, ix, iz).solve(ws.uk, ws.vk, ws.wk, ws.Pk, ws.Ruk, ws.Rvk, ws.Rwk);
+                // 	  solve(ix,iz,ws.uk, ws.vk, ws.wk, ws.Pk, ws.Ruk,ws.Rvk,ws.Rwk);
+                // Bulk vel is free variable determined from soln of tau eqn //TODO: write method that computes
+                // UbulkAct everytime it is needed
+
+            } else {  // const bulk velocity
+                // bulk velocity is supplied, use alternative tau solver
+
+                // Use tausolver with additional variable and constraint:
+                // free variable: dPdxAct at next time-step,
+                // constraint:    UbulkBase + mean(u) = UbulkRef.
+                solvers.tau(0, ix, iz).solve(ws.uk, ws.vk, ws.wk, ws.Pk, dPdxAct_, dPdzAct_, ws.Ruk, ws.Rvk, ws.Rwk,
+                                            UbulkRef_ - UbulkBase_, WbulkRef_ - WbulkBase_);
+                // 	  solve(ix,iz,ws.uk, ws.vk, ws.wk, ws.Pk, dPdxAct_, dPdzAct_,
+                // 				    ws.Ruk, ws.Rvk, ws.Rwk,
+                // 				    UbulkRef_ - UbulkBase_,
+                // 				    WbulkRef_ - WbulkBase_);
+
+                // test if UbulkRef == UbulkAct = UbulkBase_ + ws.uk.re.mean()
+                assert((UbulkRef_ - UbulkBase_ - ws.uk.re.mean()) < 1e-15);
+                // test if WbulkRef == WbulkAct = WbulkBase_ + ws.wk.re.mean()
+                assert((WbulkRef_ - WbulkBase_ - ws.wk.re.mean()) < 1e-15);
             }
-            // The normal case, for general kx,kz
-            else
-                for (int ny = 0; ny < Nyd_; ++ny) {
-                    outfields[0].cmplx(mx, ny, mz, 0) = uk_[ny];
-                    outfields[0].cmplx(mx, ny, mz, 1) = vk_[ny];
-                    outfields[0].cmplx(mx, ny, mz, 2) = wk_[ny];
-                    outfields[3].cmplx(mx, ny, mz, 0) = Pk_[ny];
-                }
-
-            #ifdef P5
-            // Solve the helmholtz problem for the heat equation
-            //=============================
-            if (kx != 0 || kz != 0) {
-                heatsolver_[s][ix][iz].solve(Tk_.re, Rtk_.re, 0, 0);  // BC are considered through the base profile
-                heatsolver_[s][ix][iz].solve(Tk_.im, Rtk_.im, 0, 0);
-            } else {  // kx,kz == 0,0
-                // LHS includes also the constant term C=kappa Tbase_yy, which can be added to RHS
-                if (nonzCt_) {
-                    for (int ny = 0; ny < My_; ++ny)
-                        Rtk_.re[ny] -= Ct_.re[ny];
-                }
-
-                heatsolver_[s][ix][iz].solve(Tk_.re, Rtk_.re, 0, 0);
-                heatsolver_[s][ix][iz].solve(Tk_.im, Rtk_.im, 0, 0);
+                
+        }
+        // Load solutions into u and p.
+        // Because of FFTW complex symmetries
+        // The 0,0 mode must be real.
+        // For Nx even, the kxmax,0 mode must be real
+        // For Nz even, the 0,kzmax mode must be real
+        // For Nx,Nz even, the kxmax,kzmax mode must be real
+        if ((kx == 0 && kz == 0) || (outfields[0].Nx() % 2 == 0 && kx == kxmax && kz == 0) ||
+            (outfields[0].Nz() % 2 == 0 && kz == kzmax && kx == 0) ||
+            (outfields[0].Nx() % 2 == 0 && outfields[0].Nz() % 2 == 0 && kx == kxmax && kz == kzmax)) {
+            for (int ny = 0; ny < Nyd_; ++ny) {
+                outfields[0].cmplx(mx, ny, mz, 0) = Complex(Re(ws.uk[ny]), 0.0);
+                outfields[0].cmplx(mx, ny, mz, 1) = Complex(Re(ws.vk[ny]), 0.0);
+                outfields[0].cmplx(mx, ny, mz, 2) = Complex(Re(ws.wk[ny]), 0.0);
+                outfields[3].cmplx(mx, ny, mz, 0) = Complex(Re(ws.Pk[ny]), 0.0);
             }
-
-            // Load solution into T.
-            // Because of FFTW complex symmetries
-            // The 0,0 mode must be real.
-            // For Nx even, the kxmax,0 mode must be real
-            // For Nz even, the 0,kzmax mode must be real
-            // For Nx,Nz even, the kxmax,kzmax mode must be real
-            if ((kx == 0 && kz == 0) || (outfields[1].Nx() % 2 == 0 && kx == kxmax && kz == 0) ||
-                (outfields[1].Nz() % 2 == 0 && kz == kzmax && kx == 0) ||
-                (outfields[1].Nx() % 2 == 0 && outfields[1].Nz() % 2 == 0 && kx == kxmax && kz == kzmax)) {
-                for (int ny = 0; ny < Nyd_; ++ny)
-                    outfields[1].cmplx(mx, ny, mz, 0) = Complex(Re(Tk_[ny]), 0.0);
-
+        }
+        // The normal case, for general kx,kz
+        else
+            for (int ny = 0; ny < Nyd_; ++ny) {
+                outfields[0].cmplx(mx, ny, mz, 0) = ws.uk[ny];
+                outfields[0].cmplx(mx, ny, mz, 1) = ws.vk[ny];
+                outfields[0].cmplx(mx, ny, mz, 2) = ws.wk[ny];
+                outfields[3].cmplx(mx, ny, mz, 0) = ws.Pk[ny];
             }
-            // The normal case, for general kx,kz
-            else
-                for (int ny = 0; ny < Nyd_; ++ny)
-                    outfields[1].cmplx(mx, ny, mz, 0) = Tk_[ny];
-            #endif
-            
-            #ifdef P6
-            // Solve the helmholtz problem for the salt equation
-            //=============================
-            if (kx != 0 || kz != 0) {
-                saltsolver_[s][ix][iz].solve(Sk_.re, Rsk_.re, 0, 0);  // BC are considered through the base profile
-                saltsolver_[s][ix][iz].solve(Sk_.im, Rsk_.im, 0, 0);
-            } else {  // kx,kz == 0,0
-                // LHS includes also the constant term C=1/Le Sbase_yy, which can be added to RHS
-                if (nonzCs_) {
-                    for (int ny = 0; ny < My_; ++ny)
-                        Rsk_.re[ny] -= Cs_.re[ny];
-                }
 
-                saltsolver_[s][ix][iz].solve(Sk_.re, Rsk_.re, 0, 0);
-                saltsolver_[s][ix][iz].solve(Sk_.im, Rsk_.im, 0, 0);
-            }
+    }  // End of loop over Fourier modes
 
-            // Load solution into S.
-            // Because of FFTW complex symmetries
-            // The 0,0 mode must be real.
-            // For Nx even, the kxmax,0 mode must be real
-            // For Nz even, the 0,kzmax mode must be real
-            // For Nx,Nz even, the kxmax,kzmax mode must be real
-            if ((kx == 0 && kz == 0) || (outfields[2].Nx() % 2 == 0 && kx == kxmax && kz == 0) ||
-                (outfields[2].Nz() % 2 == 0 && kz == kzmax && kx == 0) ||
-                (outfields[2].Nx() % 2 == 0 && outfields[2].Nz() % 2 == 0 && kx == kxmax && kz == kzmax)) {
-                for (int ny = 0; ny < Nyd_; ++ny)
-                    outfields[2].cmplx(mx, ny, mz, 0) = Complex(Re(Sk_[ny]), 0.0);
+    if (nlctx_.temperature && selheat_) {
+        // Solve the helmholtz problems of the heat equation for all modes at once
+        //=============================
+        // LHS includes also the constant term C=kappa Tbase_yy, which is added to RHS in packScalarRHS
+        packScalarRHS(rhs[1], Ct_, nonzCt_);
+        solvers.heat.solve(batchure_.data(), batchuim_.data(), batchfre_.data(), batchfim_.data());
+        unpackScalar(outfields[1]);
+    }
 
+    if (!nlctx_.salinity || !selsalt_)
+        return;
+
+    // Solve the helmholtz problems of the salt equation for all modes at once
+    //=============================
+    packScalarRHS(rhs[2], Cs_, nonzCs_);
+    if (nlctx_.crossdiffusion) {
+        // The cross-diffusion P7*lap(T) couples the new temperature into the salt equation
+        // (lower block triangular system): put -P7*lap(T) of the just solved T (still in batchu) on the negative RHS.
+        const lint Nb = scalarmodes_.size();
+#ifdef _OPENMP
+        const int nthreads = modeThreads();
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+#endif
+        for (lint m = 0; m < Nb; ++m) {
+#ifdef _OPENMP
+            DDEModeWorkspace& ws = modews_[omp_get_thread_num()];
+#else
+            DDEModeWorkspace& ws = modews_[0];
+#endif
+            const int kx = kxloc_[scalarmodes_[m] / Mzloc_];
+            const int kz = kzloc_[scalarmodes_[m] % Mzloc_];
+            const Real k2 = 4 * pi * pi * (square(kx / Lx_) + square(kz / Lz_));
+            for (int ny = 0; ny < Nyd_; ++ny)
+                ws.Tk.set(ny, Complex(batchure_[ny * Nb + m], batchuim_[ny * Nb + m]));
+            diff2(ws.Tk, ws.Rtk, ws.Pyk);
+            for (int ny = 0; ny < Nyd_; ++ny) {
+                const Complex lapT = ws.Rtk[ny] - k2 * ws.Tk[ny];
+                batchfre_[ny * Nb + m] -= nlctx_.p7 * Re(lapT);
+                batchfim_[ny * Nb + m] -= nlctx_.p7 * Im(lapT);
             }
-            // The normal case, for general kx,kz
-            else
-                for (int ny = 0; ny < Nyd_; ++ny)
-                    outfields[2].cmplx(mx, ny, mz, 0) = Sk_[ny];
-            #endif
-
-        }  // End of loop over Fourier modes
+        }
     }
-    
+    solvers.salt.solve(batchure_.data(), batchuim_.data(), batchfre_.data(), batchfim_.data());
+    unpackScalar(outfields[2]);
 }
 
-void DDE::reset_lambda(std::vector<Real> lambda_t) {
-    lambda_t_ = lambda_t;
-    if (tausolver_ == 0) {  // TauSolver need to be constructed
-        // Allocate memory for [Nsubsteps x Mx_ x Mz_] Tausolver cfarray
-        tausolver_ = new TauSolver**[lambda_t.size()];  // new #1
-        for (uint j = 0; j < lambda_t.size(); ++j) {
-            tausolver_[j] = new TauSolver*[Mxloc_];  // new #2
-            for (int mx = 0; mx < Mxloc_; ++mx)
-                tausolver_[j][mx] = new TauSolver[Mzloc_];  // new #3
+void DDE::packScalarRHS(const FlowField& rhs, const ComplexChebyCoeff& C, bool nonzC) {
+    // negative RHS because the Helmholtz solvers solve the negative problem
+    const lint Nb = scalarmodes_.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (lint m = 0; m < Nb; ++m) {
+        const lint mx = mxlocmin_ + scalarmodes_[m] / Mzloc_;
+        const lint mz = mzlocmin_ + scalarmodes_[m] % Mzloc_;
+        for (int ny = 0; ny < Nyd_; ++ny) {
+            const Complex f = rhs.cmplx(mx, ny, mz, 0);
+            batchfre_[ny * Nb + m] = -Re(f);
+            batchfim_[ny * Nb + m] = -Im(f);
         }
+        // kx,kz == 0,0: LHS includes also the constant term C, which can be added to RHS
+        if (nonzC && rhs.kx(mx) == 0 && rhs.kz(mz) == 0)
+            for (int ny = 0; ny < My_; ++ny)
+                batchfre_[ny * Nb + m] -= C.re[ny];
     }
-    #ifdef P5
-    if (heatsolver_ == 0) {
-        heatsolver_ = new HelmholtzSolver**[lambda_t.size()];  // new #1
-        for (uint j = 0; j < lambda_t.size(); ++j) {
-            heatsolver_[j] = new HelmholtzSolver*[Mxloc_];  // new #2
-            for (int mx = 0; mx < Mxloc_; ++mx)
-                heatsolver_[j][mx] = new HelmholtzSolver[Mzloc_];  // new #3
+}
+
+void DDE::unpackScalar(FlowField& f) const {
+    const lint Nb = scalarmodes_.size();
+    const int kxmax = f.kxmax();
+    const int kzmax = f.kzmax();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (lint m = 0; m < Nb; ++m) {
+        const lint mx = mxlocmin_ + scalarmodes_[m] / Mzloc_;
+        const lint mz = mzlocmin_ + scalarmodes_[m] % Mzloc_;
+        const int kx = f.kx(mx);
+        const int kz = f.kz(mz);
+
+        // Because of FFTW complex symmetries
+        // The 0,0 mode must be real.
+        // For Nx even, the kxmax,0 mode must be real
+        // For Nz even, the 0,kzmax mode must be real
+        // For Nx,Nz even, the kxmax,kzmax mode must be real
+        if ((kx == 0 && kz == 0) || (f.Nx() % 2 == 0 && kx == kxmax && kz == 0) ||
+            (f.Nz() % 2 == 0 && kz == kzmax && kx == 0) ||
+            (f.Nx() % 2 == 0 && f.Nz() % 2 == 0 && kx == kxmax && kz == kzmax)) {
+            for (int ny = 0; ny < Nyd_; ++ny)
+                f.cmplx(mx, ny, mz, 0) = Complex(batchure_[ny * Nb + m], 0.0);
         }
+        // The normal case, for general kx,kz
+        else
+            for (int ny = 0; ny < Nyd_; ++ny)
+                f.cmplx(mx, ny, mz, 0) = Complex(batchure_[ny * Nb + m], batchuim_[ny * Nb + m]);
     }
-    #endif
-    #ifdef P6
-    if (saltsolver_ == 0) {
-        saltsolver_ = new HelmholtzSolver**[lambda_t.size()];  // new #1
-        for (uint j = 0; j < lambda_t.size(); ++j) {
-            saltsolver_[j] = new HelmholtzSolver*[Mxloc_];  // new #2
-            for (int mx = 0; mx < Mxloc_; ++mx)
-                saltsolver_[j][mx] = new HelmholtzSolver[Mzloc_];  // new #3
+}
+
+void DDE::reset_lambda(std::vector<Real> lambda_t) {
+    lambda_t_ = lambda_t;
+    ++solveruse_;
+
+    // Look up the solvers of every substep in the cache and factorize only the missing ones.
+    // lambda_t is a function of dt and the scheme coefficients only, hence a dt that was used before
+    // reproduces it bit by bit and the exact comparison is intended.
+    substepsolver_.assign(lambda_t.size(), -1);
+    for (uint j = 0; j < lambda_t.size(); ++j) {
+        for (uint i = 0; i < solvercache_.size(); ++i)
+            if (solvercache_[i].lambda == lambda_t[j])
+                substepsolver_[j] = i;
+        if (substepsolver_[j] < 0) {
+            solvercache_.emplace_back();
+            createSolverSet(lambda_t[j], solvercache_.back());
+            substepsolver_[j] = solvercache_.size() - 1;
+            *flags_.logstream << "DDE solvers: factorized lambda_t = " << lambda_t[j] << ", "
+                              << solvercache_.back().bytes() << " bytes" << std::endl;
         }
+        solvercache_[substepsolver_[j]].lastuse = solveruse_;
     }
-    #endif
 
-    // Configure tausolvers
-    //   FlowField u=fields_[0];
+    // Release the least recently used sets beyond the cache size. Sets of the current substeps are never released.
+    const uint maxsets = std::max(flags_.solvercache, 0);
+    bool evicted = false;
+    for (;;) {
+        int lru = -1;
+        for (uint i = 0; i < solvercache_.size(); ++i)
+            if (solvercache_[i].lastuse != solveruse_ && (lru < 0 || solvercache_[i].lastuse < solvercache_[lru].lastuse))
+                lru = i;
+        if (lru < 0 || solvercache_.size() <= maxsets)
+            break;
+        solvercache_.erase(solvercache_.begin() + lru);
+        evicted = true;
+    }
+    if (evicted)
+        for (uint j = 0; j < lambda_t.size(); ++j)
+            for (uint i = 0; i < solvercache_.size(); ++i)
+                if (solvercache_[i].lambda == lambda_t[j])
+                    substepsolver_[j] = i;
+}
 
-    const Real Rey = flags_.Rey;
-    const Real Pr = flags_.Pr;
-    const Real Le = flags_.Le;
-    const Real Ra = flags_.Ra;
-    const Real Rrho = flags_.Rrho;
-    const Real Ri = flags_.Ri;
-    // const Real Tau = flags_.Tau;
+void DDE::createSolverSet(Real lambda_t, DDESolverSet& set) const {
+    const Real p1 = nlctx_.p1;
+    const Real p5 = nlctx_.p5;
+    const Real p6 = nlctx_.p6;
     const Real c = 4.0 * square(pi);
-    //   const int kxmax = u.kxmax();
-    //   const int kzmax = u.kzmax();
-    for (uint j = 0; j < lambda_t.size(); ++j) {
-        for (int mx = 0; mx < Mxloc_; ++mx) {
-            int kx = kxloc_[mx];
-            for (int mz = 0; mz < Mzloc_; ++mz) {
-                int kz = kzloc_[mz];
-                Real lambda_tau = lambda_t[j] + P1 * c * (square(kx / Lx_) + square(kz / Lz_));
-                #ifdef P5
-                Real lambda_heat = lambda_t[j] + P5 * c * (square(kx / Lx_) + square(kz / Lz_));
-                #endif
-                #ifdef P6
-                Real lambda_salt = lambda_t[j] + P6 * c * (square(kx / Lx_) + square(kz / Lz_));
-                #endif
-                if ((kx != kxmax_ || kz != kzmax_) && (!flags_.dealias_xz() || !isAliasedMode(kx, kz))) {
-                    tausolver_[j][mx][mz] =
-                        TauSolver(kx, kz, Lx_, Lz_, a_, b_, lambda_tau, P1, Nyd_, flags_.taucorrection);
-                    #ifdef P5
-                    heatsolver_[j][mx][mz] = HelmholtzSolver(Nyd_, a_, b_, lambda_heat, P5);
-                    #endif
-                    #ifdef P6
-                    saltsolver_[j][mx][mz] = HelmholtzSolver(Nyd_, a_, b_, lambda_salt, P6);
-                    #endif
-                }
+    set.lambda = lambda_t;
+
+    // One contiguous [Mxloc_ x Mzloc_] block of TauSolvers
+    set.tau = SolverArena<TauSolver>(1, Mxloc_, Mzloc_);
+    for (int mx = 0; mx < Mxloc_; ++mx) {
+        int kx = kxloc_[mx];
+        for (int mz = 0; mz < Mzloc_; ++mz) {
+            int kz = kzloc_[mz];
+            Real lambda_tau = lambda_t + p1 * c * (square(kx / Lx_) + square(kz / Lz_));
+            if ((kx != kxmax_ || kz != kzmax_) && (!flags_.dealias_xz() || !isAliasedMode(kx, kz))) {
+                set.tau(0, mx, mz) = TauSolver(kx, kz, Lx_, Lz_, a_, b_, lambda_tau, p1, Nyd_, flags_.taucorrection);
             }
         }
     }
+
+    // Batched solvers of the scalar equations
+    const lint Nb = scalarmodes_.size();
+    std::vector<Real> k2(Nb);
+    for (lint m = 0; m < Nb; ++m)
+        k2[m] = c * (square(kxloc_[scalarmodes_[m] / Mzloc_] / Lx_) + square(kzloc_[scalarmodes_[m] % Mzloc_] / Lz_));
+    std::vector<Real> lambda(Nb);
+    if (nlctx_.temperature) {
+        for (lint m = 0; m < Nb; ++m)
+            lambda[m] = lambda_t + p5 * k2[m];
+        set.heat = HelmholtzBatch(Nyd_, a_, b_, p5, lambda);
+    }
+    if (nlctx_.salinity) {
+        for (lint m = 0; m < Nb; ++m)
+            lambda[m] = lambda_t + p6 * k2[m];
+        set.salt = HelmholtzBatch(Nyd_, a_, b_, p6, lambda);
+    }
+}
+
+size_t DDESolverSet::bytes() const {
+    // TauSolver objects are counted without the memory owned by their banded matrices
+    return tau.bytes() + heat.bytes() + salt.bytes();
 }
 
+size_t DDE::solverBytes() const {
+    size_t bytes = 0;
+    for (uint i = 0; i < solvercache_.size(); ++i)
+        bytes += solvercache_[i].bytes();
+    return bytes;
+}
+
+void DDE::selectEquations(bool momentum, bool heat, bool salt) {
+    // the salt solve reads the new temperature from the heat batch
+    if (nlctx_.crossdiffusion && salt && !heat)
+        cferror("DDE::selectEquations: with cross-diffusion the salt equation needs the heat equation");
+    selmomentum_ = momentum;
+    selheat_ = heat;
+    selsalt_ = salt;
+}
 
 const ChebyCoeff& DDE::Ubase() const { return Ubase_; }
 const ChebyCoeff& DDE::Wbase() const { return Wbase_; }
@@ -730,49 +927,17 @@ std::vector<cfarray<FieldSymmetry>> DDE::createSymmVec() const {
 }
 
 void DDE::createDDCBaseFlow() {
-    Real ulowerwall = flags_.ulowerwall;
-    Real uupperwall = flags_.uupperwall;
-    Real wlowerwall = flags_.wlowerwall;
-    Real wupperwall = flags_.wupperwall;
-
-    switch (flags_.baseflow) {
-        case ZeroBase:
-            Ubase_ = ChebyCoeff(My_, a_, b_, Spectral);
-            Wbase_ = ChebyCoeff(My_, a_, b_, Spectral);
-            Tbase_ = ChebyCoeff(My_, a_, b_, Spectral);
-            Sbase_ = ChebyCoeff(My_, a_, b_, Spectral);
-            break;
-        case LinearBase:
-            std::cerr << "error in DDE::createBaseFlow :\n";
-            std::cerr << "LinearBase is not defined in DDC.\n";
-            break;
-        case ParabolicBase:
-            std::cerr << "error in DDE::createBaseFlow :\n";
-            std::cerr << "ParabolicBase is not defined in DDC.\n";
-            break;
-        case SuctionBase:
-            std::cerr << "error in DDE::createBaseFlow :\n";
-            std::cerr << "ParabolicBase is not defined in DDC.\n";
-            break;
-        case LaminarBase:
-            Ubase_ = laminarVelocityProfile(flags_.gammax, flags_.dPdx, flags_.Ubulk, ulowerwall, uupperwall, a_, b_, My_, flags_);
-            Wbase_ = laminarVelocityProfile(0.0, flags_.dPdz, flags_.Wbulk, wlowerwall, wupperwall, a_, b_, My_, flags_);
-
-            Tbase_ = linearTemperatureProfile(a_, b_, My_, flags_);
-            Sbase_ = linearSalinityProfile(a_, b_, My_, flags_);
-
-            break;
-        case ArbitraryBase:
-            std::cerr << "error in NSE::createBaseFlow :\n";
-            std::cerr << "flags.baseflow is ArbitraryBase.\n";
-            std::cerr << "Please provide {Ubase, Wbase} when constructing DNS.\n";
-            cferror("");
-        default:
-            std::cerr << "error in NSE::createBaseFlow :\n";
-            std::cerr << "flags.baseflow should be ZeroBase, LinearBase, ParabolicBase, LaminarBase, SuctionBase.\n";
-            std::cerr << "Other cases require use of the DNS::DNS(fields, base, flags) constructor.\n";
-            cferror("");
-    }
+    // profiles and derivatives are shared with all other users of the same parameters
+    const std::shared_ptr<const DDCBaseFlow> base = ddcBaseFlow(My_, a_, b_, flags_);
+    Ubase_ = base->U;
+    Wbase_ = base->W;
+    Tbase_ = base->T;
+    Sbase_ = base->S;
+    Ubaseyy_ = base->Uyy;
+    Wbaseyy_ = base->Wyy;
+    Tbaseyy_ = base->Tyy;
+    Sbaseyy_ = base->Syy;
+    Pbasey_ = base->Py;
     baseflow_ = true;
 }
 
@@ -781,20 +946,18 @@ void DDE::createConstants() {
         std::cerr << "DDE::createConstants: Not all base flow members have been initialized." << std::endl;
 
     ComplexChebyCoeff c(My_, a_, b_, Spectral);
-    Real Rey = flags_.Rey;
-    Real Pr = flags_.Pr;
-    Real Le = flags_.Le;
-    Real Ra = flags_.Ra;
-    Real Rrho = flags_.Rrho;
-    Real Ri = flags_.Ri;
+    const Real p1 = nlctx_.p1;
+    const Real p5 = nlctx_.p5;
+    const Real p6 = nlctx_.p6;
+    const Real p7 = nlctx_.crossdiffusion ? nlctx_.p7 : 0.0;
 
     // constant u-term
     if (Ubaseyy_.length() > 0) {
-        c[0] = Complex(P1 * Ubaseyy_[0], 0);
+        c[0] = Complex(p1 * Ubaseyy_[0], 0);
         if ((abs(c[0]) > 1e-15) && !nonzCu_)
             nonzCu_ = true;
         for (int ny = 1; ny < My_; ++ny) {
-            c[ny] = Complex(P1 * Ubaseyy_[ny], 0);
+            c[ny] = Complex(p1 * Ubaseyy_[ny], 0);
             if ((abs(c[ny]) > 1e-15) && !nonzCu_)
                 nonzCu_ = true;
         }
@@ -815,7 +978,7 @@ void DDE::createConstants() {
     // constant w-term:
     if (Wbaseyy_.length() > 0) {
         for (int ny = 0; ny < My_; ++ny) {
-            c[ny] = Complex(P1 * Wbaseyy_[ny], 0);
+            c[ny] = Complex(p1 * Wbaseyy_[ny], 0);
             if ((abs(c[ny]) > 1e-15) && !nonzCw_)
                 nonzCw_ = true;
         }
@@ -825,11 +988,10 @@ void DDE::createConstants() {
         *flags_.logstream << "DDC with nonzero W-const." << std::endl;
     }
 
-    #ifdef P5
     // constant t-term:
-    if (Tbaseyy_.length() > 0) {
+    if (nlctx_.temperature && Tbaseyy_.length() > 0) {
         for (int ny = 1; ny < My_; ++ny) {
-            c[ny] = Complex(P5*Tbaseyy_[ny], 0);
+            c[ny] = Complex(p5*Tbaseyy_[ny], 0);
             if ((abs(c[ny]) > 1e-15) && !nonzCt_)
                 nonzCt_ = true;
         }
@@ -838,17 +1000,11 @@ void DDE::createConstants() {
         Ct_ = c;
         *flags_.logstream << "DDC with nonzero T-const." << std::endl;
     }
-    #endif
 
-    #ifdef P6
     // constant s-term:
-    if (Sbaseyy_.length() > 0) {
+    if (nlctx_.salinity && Sbaseyy_.length() > 0) {
         for (int ny = 1; ny < My_; ++ny) {
-            c[ny] = Complex(P6*Sbaseyy_[ny]
-            #ifdef P7
-                + P7*Tbaseyy_[ny]
-            #endif
-            , 0);
+            c[ny] = Complex(p6*Sbaseyy_[ny] + p7*Tbaseyy_[ny], 0);
             if ((abs(c[ny]) > 1e-15) && !nonzCs_)
                 nonzCs_ = true;
         }
@@ -857,27 +1013,28 @@ void DDE::createConstants() {
         Cs_ = c;
         *flags_.logstream << "DDC with nonzero S-const." << std::endl;
     }
-    #endif
 }
 
 void DDE::initDDCConstraint(const FlowField& u) {
     if (!baseflow_)
         std::cerr << "DDE::initConstraint: Base flow has not been created." << std::endl;
 
-    // Calculate Ubaseyy_ and related quantities
+    // Calculate Ubaseyy_ and related quantities, unless they come with the cached base flow
     UbulkBase_ = Ubase_.mean();
     ChebyCoeff Ubasey = diff(Ubase_);
-    Ubaseyy_ = diff(Ubasey);
 
     WbulkBase_ = Wbase_.mean();
     ChebyCoeff Wbasey = diff(Wbase_);
-    Wbaseyy_ = diff(Wbasey);
 
-    ChebyCoeff Tbasey = diff(Tbase_);
-    Tbaseyy_ = diff(Tbasey);
-
-    ChebyCoeff Sbasey = diff(Sbase_);
-    Sbaseyy_ = diff(Sbasey);
+    // NSE(fields, base, flags) computes the velocity derivatives only, the scalar ones are checked separately
+    if (Ubaseyy_.length() == 0) {
+        Ubaseyy_ = diff(Ubasey);
+        Wbaseyy_ = diff(Wbasey);
+    }
+    if (Tbaseyy_.length() == 0)
+        Tbaseyy_ = diff(diff(Tbase_));
+    if (Sbaseyy_.length() == 0)
+        Sbaseyy_ = diff(diff(Sbase_));
 
     // Determine actual Ubulk and dPdx from initial data Ubase + u.
     Real Ly = b_ - a_;
@@ -933,17 +1090,162 @@ void DDE::initDDCConstraint(const FlowField& u) {
 }
 
 
+DDEModeWorkspace::DDEModeWorkspace(int Ny, Real a, Real b)
+    : uk(Ny, a, b, Spectral),
+      vk(Ny, a, b, Spectral),
+      wk(Ny, a, b, Spectral),
+      Pk(Ny, a, b, Spectral),
+      Pyk(Ny, a, b, Spectral),
+      Ruk(Ny, a, b, Spectral),
+      Rvk(Ny, a, b, Spectral),
+      Rwk(Ny, a, b, Spectral),
+      Tk(Ny, a, b, Spectral),
+      Rtk(Ny, a, b, Spectral),
+      Sk(Ny, a, b, Spectral),
+      Rsk(Ny, a, b, Spectral) {}
+
+void DDE::initModeWorkspace() {
+    // one set of scratch profiles per thread working on the Fourier-mode loops
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+    modews_.assign(nthreads, DDEModeWorkspace(Nyd_, a_, b_));
+
+    // modes of the batched scalar solves: same selection as in reset_lambda and solve
+    scalarmodes_.clear();
+    for (lint ix = 0; ix < Mxloc_; ++ix)
+        for (lint iz = 0; iz < Mzloc_; ++iz) {
+            const int kx = kxloc_[ix];
+            const int kz = kzloc_[iz];
+            if ((kx != kxmax_ && kz != kzmax_) && (!flags_.dealias_xz() || !isAliasedMode(kx, kz)))
+                scalarmodes_.push_back(ix * Mzloc_ + iz);
+        }
+    batchfre_.assign(Nyd_ * scalarmodes_.size(), 0.0);
+    batchfim_.assign(Nyd_ * scalarmodes_.size(), 0.0);
+    batchure_.assign(Nyd_ * scalarmodes_.size(), 0.0);
+    batchuim_.assign(Nyd_ * scalarmodes_.size(), 0.0);
+}
+
+int DDE::modeThreads() {
+    // the thread count may have been raised since construction (omp_set_num_threads): grow the scratch profiles
+    // to the threads of the next parallel region, which is pinned to this count
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+    if (nthreads > int(modews_.size()))
+        modews_.resize(nthreads, DDEModeWorkspace(Nyd_, a_, b_));
+    return nthreads;
+}
+
+void DDE::initNLWorkspace(const FlowField& u) {
+    // number of stacked components of the fused nonlinear term: velocity plus active scalars
+    int Nd = 3;
+    if (nlctx_.temperature)
+        Nd += 1;
+    if (nlctx_.salinity)
+        Nd += 1;
+
+    nlu_ = FlowField(u.Nx(), u.Ny(), u.Nz(), 3, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi());
+    nlgradu_ = FlowField(u.Nx(), u.Ny(), u.Nz(), 9, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi());
+    if (nlctx_.temperature)
+        nlgradt_ = FlowField(u.Nx(), u.Ny(), u.Nz(), 3, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi());
+    if (nlctx_.salinity)
+        nlgrads_ = FlowField(u.Nx(), u.Ny(), u.Nz(), 3, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi());
+    nlf_ = FlowField(u.Nx(), u.Ny(), u.Nz(), Nd, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi());
+
+    // the base flow is known now, grid it for the advection terms
+    nlctx_.update();
+}
+
+
+DDCBaseFlow::DDCBaseFlow(int Ny, Real a, Real b, const DDCFlags& flags) {
+    switch (flags.baseflow) {
+        case ZeroBase:
+            U = ChebyCoeff(Ny, a, b, Spectral);
+            W = ChebyCoeff(Ny, a, b, Spectral);
+            T = ChebyCoeff(Ny, a, b, Spectral);
+            S = ChebyCoeff(Ny, a, b, Spectral);
+            break;
+        case LinearBase:
+            std::cerr << "error in DDCBaseFlow :\n";
+            std::cerr << "LinearBase is not defined in DDC.\n";
+            break;
+        case ParabolicBase:
+            std::cerr << "error in DDCBaseFlow :\n";
+            std::cerr << "ParabolicBase is not defined in DDC.\n";
+            break;
+        case SuctionBase:
+            std::cerr << "error in DDCBaseFlow :\n";
+            std::cerr << "ParabolicBase is not defined in DDC.\n";
+            break;
+        case LaminarBase:
+            U = laminarVelocityProfile(flags.gammax, flags.dPdx, flags.Ubulk, flags.ulowerwall, flags.uupperwall, a, b,
+                                       Ny, flags);
+            W = laminarVelocityProfile(0.0, flags.dPdz, flags.Wbulk, flags.wlowerwall, flags.wupperwall, a, b, Ny, flags);
+
+            T = linearTemperatureProfile(a, b, Ny, flags);
+            S = linearSalinityProfile(a, b, Ny, flags);
+
+            break;
+        case ArbitraryBase:
+            std::cerr << "error in DDCBaseFlow :\n";
+            std::cerr << "flags.baseflow is ArbitraryBase.\n";
+            std::cerr << "Please provide {Ubase, Wbase} when constructing DNS.\n";
+            cferror("");
+        default:
+            std::cerr << "error in DDCBaseFlow :\n";
+            std::cerr << "flags.baseflow should be ZeroBase, LinearBase, ParabolicBase, LaminarBase, SuctionBase.\n";
+            std::cerr << "Other cases require use of the DNS::DNS(fields, base, flags) constructor.\n";
+            cferror("");
+    }
+    if (U.length() > 0) {
+        Uyy = diff(diff(U));
+        Wyy = diff(diff(W));
+        Tyy = diff(diff(T));
+        Syy = diff(diff(S));
+    }
+    Py = hydrostaticPressureGradientY(T, S, flags);
+}
+
+std::shared_ptr<const DDCBaseFlow> ddcBaseFlow(int Ny, Real a, Real b, const DDCFlags& flags) {
+    // every parameter entering the profiles, the DDCSystem and its control parameters through p1..p7
+    const DDCCoefficients c = flags.coefficients();
+    const std::vector<Real> key = {Real(Ny), a, b, Real(flags.baseflow), Real(flags.constraint), flags.Vsuck,
+                                   flags.dPdx, flags.dPdz, flags.Ubulk, flags.Wbulk, flags.gammax,
+                                   flags.ulowerwall, flags.uupperwall, flags.wlowerwall, flags.wupperwall,
+                                   flags.tlowerwall, flags.tupperwall, flags.slowerwall, flags.supperwall,
+                                   c.p1, c.p2, c.p3, c.p4, c.p5, c.p6, c.p7};
+
+    // most recently used first, a few entries cover continuation steps and the init/main DDE
+    // shared by all threads, e.g. the statistics of the time stepping and a DDCSnapshotWriter writing state files
+    typedef std::pair<std::vector<Real>, std::shared_ptr<const DDCBaseFlow>> Entry;
+    static std::vector<Entry> cache;
+    static std::mutex cachemutex;
+    const uint cachesize = 4;
+    std::lock_guard<std::mutex> lock(cachemutex);
+    for (uint i = 0; i < cache.size(); ++i)
+        if (cache[i].first == key) {
+            std::rotate(cache.begin(), cache.begin() + i, cache.begin() + i + 1);
+            return cache[0].second;
+        }
+    cache.insert(cache.begin(), Entry(key, std::make_shared<const DDCBaseFlow>(Ny, a, b, flags)));
+    if (cache.size() > cachesize)
+        cache.pop_back();
+    return cache[0].second;
+}
+
 ChebyCoeff laminarVelocityProfile(Real gammax, Real dPdx, Real Ubulk, Real Ua, Real Ub, Real a, Real b, int Ny,
-                                  DDCFlags flags) {
+                                  const DDCFlags& flags) {
     MeanConstraint constraint = flags.constraint;
     Real Vsuck = flags.Vsuck;
 
-    Real Rey = flags.Rey;
-    Real Pr = flags.Pr;
-    Real Ra = flags.Ra;
-    Real Rrho = flags.Rrho;
-    Real Rsep = flags.Rsep;
-    Real Ri = flags.Ri;
+    const DDCCoefficients coeff = flags.coefficients();
+    const Real P1 = coeff.p1;
+    const Real P2 = coeff.p2;
+    const Real P3 = coeff.p3;
+    const Real P4 = coeff.p4;
     Real sgammax = sin(gammax);
     
     Real h = b-a;
@@ -964,7 +1266,7 @@ ChebyCoeff laminarVelocityProfile(Real gammax, Real dPdx, Real Ubulk, Real Ua, R
 
     Real ps1 = (Sb-Sa)/h;
     Real ps0 = (b*Sa-a*Sb)/h;
-    #if defined(P6)
+    // coefficients of inactive components are zero, e.g. P4 = 0 without salinity and P2 = 0 without scalars
     Real p3 = -1.0*P2*sgammax/(6.0*P1) * (P3*pt1-P4*ps1);
     Real p2 = -1.0*P2*sgammax/(2.0*P1) * (P3*pt0-P4*ps0);
     Real p1 = (Ub-Ua)/h 
@@ -972,20 +1274,6 @@ ChebyCoeff laminarVelocityProfile(Real gammax, Real dPdx, Real Ubulk, Real Ua, R
     Real p0 = 0.5*((Ub+Ua)-(Ub-Ua)*(b+a)/h)
             + P2*sgammax/(12.0*P1)*(P3*pt1-P4*ps1)*(plus3-minor3*(b+a)/h)
             + P2*sgammax/(4.0*P1)*(P3*pt0-P4*ps0)*(plus2-minor2*(b+a)/h);
-    #elif defined(P5)
-    Real p3 = -1.0*P2*sgammax/(6.0*P1) * (P3*pt1);
-    Real p2 = -1.0*P2*sgammax/(2.0*P1) * (P3*pt0);
-    Real p1 = (Ub-Ua)/h 
-            + P2*sgammax/(2.0*P1*h)*(1.0/3.0*(P3*pt1)*minor3 + (P3*pt0)*minor2);
-    Real p0 = 0.5*((Ub+Ua)-(Ub-Ua)*(b+a)/h)
-            + P2*sgammax/(12.0*P1)*(P3*pt1)*(plus3-minor3*(b+a)/h)
-            + P2*sgammax/(4.0*P1)*(P3*pt0)*(plus2-minor2*(b+a)/h);
-    #else
-    Real p3 = 0;
-    Real p2 = 0;
-    Real p1 = (Ub-Ua)/h;
-    Real p0 = 0.5*((Ub+Ua)-(Ub-Ua)*(b+a)/h);
-    #endif
     // printf("%f*y^3+%f*y^2+%f*y+%f\n",p3,p2,p1,p0);fflush(stdout);
 
     ChebyCoeff u(Ny, a, b, Spectral);
@@ -1008,7 +1296,7 @@ ChebyCoeff laminarVelocityProfile(Real gammax, Real dPdx, Real Ubulk, Real Ua, R
     }
     return u;
 }
-ChebyCoeff linearTemperatureProfile(Real a, Real b, int Ny, DDCFlags flags) {
+ChebyCoeff linearTemperatureProfile(Real a, Real b, int Ny, const DDCFlags& flags) {
     MeanConstraint constraint = flags.constraint;
 
     ChebyCoeff T(Ny, a, b, Spectral);
@@ -1037,7 +1325,7 @@ ChebyCoeff linearTemperatureProfile(Real a, Real b, int Ny, DDCFlags flags) {
     return T;
 }
 
-ChebyCoeff linearSalinityProfile(Real a, Real b, int Ny, DDCFlags flags) {
+ChebyCoeff linearSalinityProfile(Real a, Real b, int Ny, const DDCFlags& flags) {
     MeanConstraint constraint = flags.constraint;
 
     ChebyCoeff S(Ny, a, b, Spectral);
@@ -1065,13 +1353,11 @@ ChebyCoeff linearSalinityProfile(Real a, Real b, int Ny, DDCFlags flags) {
     }
     return S;
 }
-ChebyCoeff hydrostaticPressureGradientY(ChebyCoeff Tbase, ChebyCoeff Sbase, DDCFlags flags) {
-    Real Rey = flags.Rey;
-    Real Pr = flags.Pr;
-    Real Ra = flags.Ra;
-    Real Rrho = flags.Rrho;
-    Real Rsep = flags.Rsep;
-    Real Ri = flags.Ri;
+ChebyCoeff hydrostaticPressureGradientY(const ChebyCoeff& Tbase, const ChebyCoeff& Sbase, const DDCFlags& flags) {
+    const DDCCoefficients coeff = flags.coefficients();
+    const Real P2 = coeff.p2;
+    const Real P3 = coeff.p3;
+    const Real P4 = coeff.p4;
 
     MeanConstraint constraint = flags.constraint;
     Real Vsuck = flags.Vsuck;
@@ -1087,13 +1373,13 @@ ChebyCoeff hydrostaticPressureGradientY(ChebyCoeff Tbase, ChebyCoeff Sbase, DDCF
         if (Vsuck < 1e-14) {
             if (dPdx < 1e-14) {
                 // dxP(y) = P2*(P3*T0(y)-P4*S0(y))*cos(gammaX)
-                #if defined(P6)
-                Py[0] = P2*(P3*Tbase[0]-P4*Sbase[0])*cgamma;  // See documentation about base solution
-                Py[1] = P2*(P3*Tbase[1]-P4*Sbase[1])*cgamma;
-                #elif defined(P5)
-                Py[0] = P2*P3*Tbase[0]*cgamma;  // See documentation about base solution
-                Py[1] = P2*P3*Tbase[1]*cgamma;
-                #endif
+                if (coeff.salinity) {
+                    Py[0] = P2*(P3*Tbase[0]-P4*Sbase[0])*cgamma;  // See documentation about base solution
+                    Py[1] = P2*(P3*Tbase[1]-P4*Sbase[1])*cgamma;
+                } else if (coeff.temperature) {
+                    Py[0] = P2*P3*Tbase[0]*cgamma;  // See documentation about base solution
+                    Py[1] = P2*P3*Tbase[1]*cgamma;
+                }
             } else {
                 cferror("Using DDC with nonzero dPdx is not implemented yet");
             }
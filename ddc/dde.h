@@ -7,34 +7,117 @@
 #ifndef DDE_H
 #define DDE_H
 
+#include <memory>
 #include "channelflow/diffops.h"
 #include "channelflow/flowfield.h"
 #include "channelflow/nse.h"
 #include "channelflow/tausolver.h"
 #include "modules/ddc/ddcflags.h"
+#include "modules/ddc/helmholtzbatch.h"
+#include "modules/ddc/solverarena.h"
 
 namespace chflow {
 
+/**
+ * Parameters of the nonlinear terms, evaluated once per DDE instead of once per substep.
+ * Holds references to the base profiles and flags owned by the DDE, the coefficients
+ * P1..P7 of the selected DDCSystem (zero for inactive terms), the direction of gravity and
+ * the base profiles on the Chebyshev grid, which are added analytically to the physical-space
+ * products of the advection terms.
+ */
+struct DDCNLContext {
+    DDCNLContext(const ChebyCoeff& Ubase, const ChebyCoeff& Wbase, const ChebyCoeff& Tbase, const ChebyCoeff& Sbase,
+                 DDCFlags& flags);
+
+    // recomputes coefficients and gridded profiles after the flags or the base profiles have been changed
+    void update();
+
+    const ChebyCoeff& Ubase;
+    const ChebyCoeff& Wbase;
+    const ChebyCoeff& Tbase;
+    const ChebyCoeff& Sbase;
+    DDCFlags& flags;  // not const: navierstokesNL toggles the Alternating nonlinearity
+
+    Real p1, p2, p3, p4, p5, p6, p7;
+    bool temperature;     // T equation is integrated
+    bool salinity;        // S equation is integrated
+    bool crossdiffusion;  // S equation contains P7*lap(T)
+    Real sgammax;  // sin(gammax)
+    Real cgammax;  // cos(gammax)
+
+    // base profiles at the Chebyshev points y_n (physical), zero where a profile is empty
+    std::vector<Real> U;
+    std::vector<Real> W;
+    std::vector<Real> dUdy;
+    std::vector<Real> dWdy;
+    std::vector<Real> dTdy;
+    std::vector<Real> dSdy;
+};
+
+// scalar advection (u*grad)s of the total fields u+Ubase-Vsuck*ey and s+sbase, dsbasedy is d(sbase)/dy on the Chebyshev points.
+// The base flow is added inside the physical-space product, so u and s are not modified.
+void baseflowAdvectionNL(const FlowField& u, const FlowField& s, const std::vector<Real>& dsbasedy, FlowField& f,
+                         const DDCNLContext& ctx);
+
 // nonlinear term of NSE plus the linear coupling term to the temperature equation
-void momentumNL(const FlowField& u, const FlowField& T, const FlowField& S, 
-                ChebyCoeff Ubase, ChebyCoeff Wbase,
-                FlowField& f,FlowField& tmp, DDCFlags flags);
+void momentumNL(const FlowField& u, const FlowField& T, const FlowField& S,
+                FlowField& f, FlowField& tmp, const DDCNLContext& ctx);
 
 // nonlinear term of heat equation plus the linear coupling term to the momentum equation
-void temperatureNL(const FlowField& u, const FlowField& T, 
-                   ChebyCoeff Ubase, ChebyCoeff Wbase, ChebyCoeff Tbase,
-                   FlowField& f, FlowField& tmp, DDCFlags flags);
+void temperatureNL(const FlowField& u, const FlowField& T, FlowField& f, const DDCNLContext& ctx);
+
+// nonlinear term of salt equation (the cross-diffusion P7*lap(T) is treated implicitly by DDE)
+void salinityNL(const FlowField& u, const FlowField& T, const FlowField& S, FlowField& f, const DDCNLContext& ctx);
+
+// linear coupling term of temperature and salinity to the momentum equation: f -= P2*(P3*T-P4*S)*(sin(gammax)*ex+cos(gammax)*ey)
+void buoyancyNL(const FlowField& T, const FlowField& S, FlowField& f, const DDCNLContext& ctx);
 
-// nonlinear term of salt equation plus the linear coupling term to the momentum equation
-void salinityNL(const FlowField& u, const FlowField& T_, const FlowField& S_, 
-                ChebyCoeff Ubase, ChebyCoeff Wbase, ChebyCoeff Sbase,
-                FlowField& f, FlowField& tmp, DDCFlags flags);
+// scratch profiles of a single Fourier mode, DDE keeps one instance per thread
+struct DDEModeWorkspace {
+    DDEModeWorkspace(int Ny, Real a, Real b);
+
+    ComplexChebyCoeff uk, vk, wk, Pk, Pyk;  // velocity, pressure and pressure gradient
+    ComplexChebyCoeff Ruk, Rvk, Rwk;        // velocity RHS
+    ComplexChebyCoeff Tk, Rtk;              // temperature and its RHS
+    ComplexChebyCoeff Sk, Rsk;              // salinity and its RHS
+};
+
+// factorized solvers of all local Fourier modes for one time-stepping constant lambda_t
+struct DDESolverSet {
+    DDESolverSet() : lambda(0), lastuse(0) {}
+
+    size_t bytes() const;
+
+    Real lambda;
+    SolverArena<TauSolver> tau;  // tausolvers, indexed by (0,ix,iz) for local Fourier mode x,z
+    HelmholtzBatch heat;         // batched Helmholtz solvers of all scalar modes
+    HelmholtzBatch salt;
+    unsigned long lastuse;  // value of the DDE's reset_lambda counter when the set was last requested
+};
+
+/** \brief base profiles of flags.baseflow on the wall-normal grid (Ny, a, b) and their derivatives
+ *
+ * Obtained through ddcBaseFlow, which keeps the profiles of the recently used parameter sets, so that DDE,
+ * the total fields, the statistics and the DSI share one copy instead of each constructing a DDC.
+ */
+struct DDCBaseFlow {
+    DDCBaseFlow(int Ny, Real a, Real b, const DDCFlags& flags);
+
+    ChebyCoeff U, W, T, S;          // base profiles (spectral)
+    ChebyCoeff Uyy, Wyy, Tyy, Syy;  // their second derivatives
+    ChebyCoeff Py;                  // hydrostatic pressure gradient in y
+};
+
+// base flow of the grid and flags, computed only for parameter sets that are not among the last few requested
+std::shared_ptr<const DDCBaseFlow> ddcBaseFlow(int Ny, Real a, Real b, const DDCFlags& flags);
 
 class DDE : public NSE {
    public:
     
     DDE(const std::vector<FlowField>& fields, const DDCFlags& flags);
     DDE(const std::vector<FlowField>& fields, const std::vector<ChebyCoeff>& base, const DDCFlags& flags);
+    DDE(const DDE&) = delete;
+    DDE& operator=(const DDE&) = delete;
     virtual ~DDE();
 
     void nonlinear(const std::vector<FlowField>& infields, std::vector<FlowField>& outfields) override;
@@ -43,12 +126,21 @@ class DDE : public NSE {
     // calls a tausolver for each Fourier mode
     void solve(std::vector<FlowField>& outfields, const std::vector<FlowField>& infields, const int i = 0) override;
 
-    // redefines the tausolver objects with new time-stepping constant (allocates memory for tausolver at first use)
+    // selects the solvers of the new time-stepping constants; only constants that are not in the solver cache
+    // are factorized, least recently used sets beyond flags.solvercache are released
     void reset_lambda(const std::vector<Real> lambda_t) override;
 
     // vector of RHS is smaller than of fields because of missing pressure equation
     std::vector<FlowField> createRHS(const std::vector<FlowField>& fields) const override;
 
+    // bytes held by the tau and Helmholtz solvers of all cached solver sets
+    size_t solverBytes() const;
+
+    // restricts nonlinear and solve to a subset of the active equations, the outfields of the other equations
+    // are not touched (linear always evaluates all of them). Used by MultirateDDC to advance u,T and S with
+    // different time steps. The salt equation can only be deselected from the heat equation without cross-diffusion.
+    void selectEquations(bool momentum, bool heat, bool salt);
+
     // returns vector of symmetries confining the vector of fields to a subspace
     std::vector<cfarray<FieldSymmetry>> createSymmVec() const override;
 
@@ -59,8 +151,9 @@ class DDE : public NSE {
     const ChebyCoeff& Sbase() const; // constant
 
    protected:
-    HelmholtzSolver*** heatsolver_;  // 3d cfarray of tausolvers, indexed by [i][mx][mz] for substep, Fourier Mode x,z
-    HelmholtzSolver*** saltsolver_;
+    std::vector<DDESolverSet> solvercache_;  // factorized solvers of the current and recently used lambda_t
+    std::vector<int> substepsolver_;         // index into solvercache_ for each substep
+    unsigned long solveruse_;                // number of calls of reset_lambda
 
     DDCFlags flags_;  // User-defined integration parameters
     
@@ -83,28 +176,62 @@ class DDE : public NSE {
     bool nonzCt_;
     bool nonzCs_;
 
-    ComplexChebyCoeff Tk_;
-    ComplexChebyCoeff Rtk_;
+    // workspace of the fused nonlinear term (fluctuations, their gradients and the stacked result)
+    FlowField nlu_;      // velocity u
+    FlowField nlgradu_;  // grad(u), 9 components
+    FlowField nlgradt_;  // grad(T)
+    FlowField nlgrads_;  // grad(S)
+    FlowField nlf_;      // [(u*grad)u, (u*grad)T, (u*grad)S] of the total fields stacked into one field
 
-    ComplexChebyCoeff Sk_;
-    ComplexChebyCoeff Rsk_;
+    DDCNLContext nlctx_;  // refers to the members above, hence DDE must not be copied
+
+    std::vector<DDEModeWorkspace> modews_;  // scratch of the Fourier-mode loops, one per thread
+
+    // local modes ix*Mzloc_+iz solved by the heat and salt batches (last and aliased modes are skipped)
+    std::vector<lint> scalarmodes_;
+    // RHS and solution of the batched scalar solves, indexed [ny*scalarmodes_.size() + m]
+    std::vector<Real> batchfre_, batchfim_, batchure_, batchuim_;
+
+    // copies -rhs (minus the constant term C in mode 0,0) of all scalar modes into batchf
+    void packScalarRHS(const FlowField& rhs, const ComplexChebyCoeff& C, bool nonzC);
+    // copies the batched solution batchu into f
+    void unpackScalar(FlowField& f) const;
+
+    // computes the advection terms of velocity (if momentum is true), temperature and salinity in a single physical-space sweep
+    void advectionNL(const std::vector<FlowField>& infields, std::vector<FlowField>& outfields, bool momentum = true);
+
+    // kernels specialized for the active equations of the DDCSystem, selected once per call by advectionNL and linear
+    template <bool Momentum, bool Heat, bool Salt>
+    void advectionKernel(const std::vector<FlowField>& infields, std::vector<FlowField>& outfields);
+    template <bool Heat, bool Salt, bool Soret>
+    void linearKernel(const std::vector<FlowField>& infields, std::vector<FlowField>& outfields);
 
    private:
     void createDDCBaseFlow();
     void initDDCConstraint(const FlowField& u);  // method called only at construction
     void createConstants();
+    void initNLWorkspace(const FlowField& u);     // method called only at construction
+    void initModeWorkspace();                     // method called only at construction
+    int modeThreads();                            // threads of the next Fourier-mode loop, with modews_ grown to this count
+    void createSolverSet(Real lambda_t, DDESolverSet& set) const;
 
     bool baseflow_;
     bool constraint_;
+
+    // equations evaluated by nonlinear and solve, see selectEquations
+    bool selmomentum_;
+    bool selheat_;
+    bool selsalt_;
 };
 
 // Construct laminar flow profile for given flow parameters.
 // [a,b]   == y position of [lower, upper] walls
 
-ChebyCoeff laminarVelocityProfile(Real gammax, Real dPdx, Real Ubulk, Real Ua, Real Ub, Real a, Real b, int Ny, DDCFlags flags);
-ChebyCoeff linearTemperatureProfile(Real a, Real b, int Ny, DDCFlags flags);
-ChebyCoeff linearSalinityProfile(Real a, Real b, int Ny, DDCFlags flags);
-ChebyCoeff hydrostaticPressureGradientY(ChebyCoeff Tbase, ChebyCoeff Sbase, DDCFlags flags);
+ChebyCoeff laminarVelocityProfile(Real gammax, Real dPdx, Real Ubulk, Real Ua, Real Ub, Real a, Real b, int Ny,
+                                  const DDCFlags& flags);
+ChebyCoeff linearTemperatureProfile(Real a, Real b, int Ny, const DDCFlags& flags);
+ChebyCoeff linearSalinityProfile(Real a, Real b, int Ny, const DDCFlags& flags);
+ChebyCoeff hydrostaticPressureGradientY(const ChebyCoeff& Tbase, const ChebyCoeff& Sbase, const DDCFlags& flags);
 
 }  // namespace chflow
 #endif
\ No newline at end of file
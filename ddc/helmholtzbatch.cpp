@@ -0,0 +1,187 @@
+/**
+ * Batched Chebyshev-tau solver of Helmholtz problems for many Fourier modes at once
+ */
+#include "modules/ddc/helmholtzbatch.h"
+#include <algorithm>
+#include <cassert>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace chflow {
+
+HelmholtzBatch::HelmholtzBatch() : N_(0), Nmodes_(0), nu_(0) {}
+
+HelmholtzBatch::HelmholtzBatch(int Ny, Real a, Real b, Real nu, const std::vector<Real>& lambda)
+    : N_(Ny),
+      Nmodes_(lambda.size()),
+      nu_(nu * 4.0 / ((b - a) * (b - a))),  // d2/dy2 = (2/(b-a))^2 d2/dx2
+      lambda_(lambda),
+      upper_(Ny * lambda.size(), 0.0),
+      q_(Ny * lambda.size(), 0.0),
+      inv_(Ny * lambda.size(), 0.0),
+      sumQe_(lambda.size(), 1.0),
+      sumQo_(lambda.size(), 1.0),
+      Pre_(lambda.size(), 0.0),
+      Pim_(lambda.size(), 0.0),
+      sumre_(lambda.size(), 0.0),
+      sumim_(lambda.size(), 0.0) {
+    assert(Ny >= 3);
+    const int N = N_;
+    const int M = Nmodes_;
+
+    // Tau equations for the Chebyshev coefficients n = 2..N-1 (Gottlieb & Orszag), with h = u" = (f + lambda u)/nu:
+    //   u_n = c_{n-2}/(4n(n-1)) h_{n-2} - 1/(2(n^2-1)) h_n + 1/(4n(n+1)) h_{n+2},   h_n = 0 for n > N-3.
+    // Rows n of equal parity form a tridiagonal system in u, which is closed by the boundary condition
+    //   sum_{n even} u_n = sum_{n odd} u_n = 0.
+    // The UL factorization expresses u_n = p_n + q_n u_{n-2}, sweeping from n = N-1 downwards.
+    for (int n = N - 1; n >= 2; --n) {
+        const Real cm = (n == 2 ? 2.0 : 1.0) / (4.0 * n * (n - 1));
+        const Real c0 = (n <= N - 3) ? 1.0 / (2.0 * (n * n - 1)) : 0.0;
+        const Real cp = (n <= N - 5) ? 1.0 / (4.0 * n * (n + 1)) : 0.0;
+        for (int m = 0; m < M; ++m) {
+            const Real lower = -lambda_[m] * cm;
+            const Real diag = nu_ + lambda_[m] * c0;
+            const Real up = -lambda_[m] * cp;
+            const Real qnext = (n + 2 < N) ? q_[(n + 2) * M + m] : 0.0;
+            const Real inv = 1.0 / (diag + up * qnext);
+            upper_[n * M + m] = up;
+            inv_[n * M + m] = inv;
+            q_[n * M + m] = -lower * inv;
+        }
+    }
+
+    // Sum of the homogeneous solutions u_n = q_n u_{n-2} with u_0 = 1 (even) and u_1 = 1 (odd)
+    for (int m = 0; m < M; ++m) {
+        Real Q = 1.0;
+        for (int n = 2; n < N; n += 2) {
+            Q *= q_[n * M + m];
+            sumQe_[m] += Q;
+        }
+        Q = 1.0;
+        for (int n = 3; n < N; n += 2) {
+            Q *= q_[n * M + m];
+            sumQo_[m] += Q;
+        }
+    }
+}
+
+size_t HelmholtzBatch::bytes() const {
+    return sizeof(Real) * (lambda_.size() + upper_.size() + q_.size() + inv_.size() + sumQe_.size() + sumQo_.size() +
+                           Pre_.size() + Pim_.size() + sumre_.size() + sumim_.size());
+}
+
+void HelmholtzBatch::solve(Real* ure, Real* uim, const Real* fre, const Real* fim) const {
+    // The modes are independent: every thread sweeps its own contiguous range of modes.
+#ifdef _OPENMP
+#pragma omp parallel
+    {
+        const int nthreads = omp_get_num_threads();
+        const int chunk = ((Nmodes_ + nthreads - 1) / nthreads + 7) / 8 * 8;  // multiple of the SIMD width
+        const int m0 = std::min(Nmodes_, omp_get_thread_num() * chunk);
+        const int m1 = std::min(Nmodes_, m0 + chunk);
+        solve(m0, m1, ure, uim, fre, fim);
+    }
+#else
+    solve(0, Nmodes_, ure, uim, fre, fim);
+#endif
+}
+
+void HelmholtzBatch::solve(int m0, int m1, Real* ure, Real* uim, const Real* fre, const Real* fim) const {
+    const int N = N_;
+    const int M = Nmodes_;
+    Real* Pre = Pre_.data();
+    Real* Pim = Pim_.data();
+    Real* sumre = sumre_.data();
+    Real* sumim = sumim_.data();
+    const Real* upper = upper_.data();
+    const Real* q = q_.data();
+    const Real* inv = inv_.data();
+
+    for (int parity = 0; parity < 2; ++parity) {
+        const int nlast = ((N - 1) % 2 == parity) ? N - 1 : N - 2;
+
+        // (1) backward sweep: p_n = (r_n - upper_n p_{n+2}) / pivot_n, stored in u
+        for (int n = nlast; n >= parity + 2; n -= 2) {
+            const Real cm = (n == 2 ? 2.0 : 1.0) / (4.0 * n * (n - 1));
+            const Real c0 = (n <= N - 3) ? 1.0 / (2.0 * (n * n - 1)) : 0.0;
+            const Real cp = (n <= N - 5) ? 1.0 / (4.0 * n * (n + 1)) : 0.0;
+            const Real* fre_m = fre + (n - 2) * M;
+            const Real* fim_m = fim + (n - 2) * M;
+            const Real* fre_0 = fre + n * M;
+            const Real* fim_0 = fim + n * M;
+            const Real* up = upper + n * M;
+            const Real* iv = inv + n * M;
+            Real* ure_n = ure + n * M;
+            Real* uim_n = uim + n * M;
+            if (n + 2 < N) {
+                const Real* fre_p = fre + (n + 2) * M;
+                const Real* fim_p = fim + (n + 2) * M;
+                const Real* pre = ure + (n + 2) * M;
+                const Real* pim = uim + (n + 2) * M;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                for (int m = m0; m < m1; ++m) {
+                    ure_n[m] = (cm * fre_m[m] - c0 * fre_0[m] + cp * fre_p[m] - up[m] * pre[m]) * iv[m];
+                    uim_n[m] = (cm * fim_m[m] - c0 * fim_0[m] + cp * fim_p[m] - up[m] * pim[m]) * iv[m];
+                }
+            } else {
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                for (int m = m0; m < m1; ++m) {
+                    ure_n[m] = (cm * fre_m[m] - c0 * fre_0[m]) * iv[m];
+                    uim_n[m] = (cm * fim_m[m] - c0 * fim_0[m]) * iv[m];
+                }
+            }
+        }
+
+        // (2) particular solution P_n = p_n + q_n P_{n-2} with P_parity = 0, and its sum
+        for (int m = m0; m < m1; ++m) {
+            Pre[m] = Pim[m] = 0.0;
+            sumre[m] = sumim[m] = 0.0;
+        }
+        for (int n = parity + 2; n < N; n += 2) {
+            const Real* qn = q + n * M;
+            const Real* ure_n = ure + n * M;
+            const Real* uim_n = uim + n * M;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+            for (int m = m0; m < m1; ++m) {
+                Pre[m] = ure_n[m] + qn[m] * Pre[m];
+                Pim[m] = uim_n[m] + qn[m] * Pim[m];
+                sumre[m] += Pre[m];
+                sumim[m] += Pim[m];
+            }
+        }
+
+        // (3) boundary condition fixes u_parity: sum(P) + u_parity * sum(Q) = 0
+        const Real* sumQ = (parity == 0) ? sumQe_.data() : sumQo_.data();
+        Real* ure_0 = ure + parity * M;
+        Real* uim_0 = uim + parity * M;
+        for (int m = m0; m < m1; ++m) {
+            ure_0[m] = -sumre[m] / sumQ[m];
+            uim_0[m] = -sumim[m] / sumQ[m];
+        }
+
+        // (4) forward sweep: u_n = p_n + q_n u_{n-2}
+        for (int n = parity + 2; n < N; n += 2) {
+            const Real* qn = q + n * M;
+            const Real* ure_m = ure + (n - 2) * M;
+            const Real* uim_m = uim + (n - 2) * M;
+            Real* ure_n = ure + n * M;
+            Real* uim_n = uim + n * M;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+            for (int m = m0; m < m1; ++m) {
+                ure_n[m] += qn[m] * ure_m[m];
+                uim_n[m] += qn[m] * uim_m[m];
+            }
+        }
+    }
+}
+
+}  // namespace chflow
@@ -0,0 +1,60 @@
+/**
+ * Batched Chebyshev-tau solver of Helmholtz problems for many Fourier modes at once
+ *
+ * The scalar equations of the DDE lead to one Helmholtz problem  nu u'' - lambda_m u = f_m  per Fourier mode m,
+ * which differ only in lambda_m. HelmholtzBatch stores the factorized quasi-tridiagonal tau matrices of all modes
+ * in structure-of-arrays layout (mode index fastest), so that every sweep of the solve runs with unit stride
+ * over the modes and is vectorized by the compiler.
+ */
+
+#ifndef HELMHOLTZBATCH_H
+#define HELMHOLTZBATCH_H
+
+#include <vector>
+#include "cfbasics/mathdefs.h"
+
+namespace chflow {
+
+/** \brief Helmholtz solver for a batch of Fourier modes
+ *
+ * Solves nu u_m'' - lambda_m u_m = f_m on [a,b] with u_m(a) = u_m(b) = 0 for m = 0..Nmodes-1.
+ * Real and imaginary parts are solved in the same sweep. Coefficient arrays are stored as
+ * x[n*Nmodes + m] for Chebyshev coefficient n of mode m.
+ */
+class HelmholtzBatch {
+   public:
+    HelmholtzBatch();
+    HelmholtzBatch(int Ny, Real a, Real b, Real nu, const std::vector<Real>& lambda);
+
+    // u and f must not overlap. f is not modified. With OpenMP the modes are split among the threads.
+    void solve(Real* ure, Real* uim, const Real* fre, const Real* fim) const;
+
+    // solves modes m0 <= m < m1 only
+    void solve(int m0, int m1, Real* ure, Real* uim, const Real* fre, const Real* fim) const;
+
+    inline int Nmodes() const { return Nmodes_; }
+    inline int Ny() const { return N_; }
+    inline Real lambda(int m) const { return lambda_[m]; }
+
+    // heap memory held by the factorization and the accumulators
+    size_t bytes() const;
+
+   private:
+    int N_;       // number of Chebyshev coefficients
+    int Nmodes_;  // number of Fourier modes in the batch
+    Real nu_;     // diffusivity, scaled to the interval [-1,1]
+    std::vector<Real> lambda_;
+
+    // UL factorization of the even and odd tau systems, indexed [n*Nmodes + m] for rows n >= 2
+    std::vector<Real> upper_;  // superdiagonal of row n (couples u_{n+2})
+    std::vector<Real> q_;      // u_n = p_n + q_n u_{n-2}
+    std::vector<Real> inv_;    // inverse pivot of row n
+    std::vector<Real> sumQe_;  // sum of the even homogeneous solution, per mode
+    std::vector<Real> sumQo_;  // sum of the odd homogeneous solution, per mode
+
+    // per-mode accumulators of solve (disjoint mode ranges may be solved concurrently)
+    mutable std::vector<Real> Pre_, Pim_, sumre_, sumim_;
+};
+
+}  // namespace chflow
+#endif
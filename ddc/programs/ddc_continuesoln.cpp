@@ -11,6 +11,7 @@
 #include "cfbasics/cfbasics.h"
 #include "channelflow/flowfield.h"
 #include "modules/ddc/ddcdsi.h"
+#include "modules/ddc/ddcstate.h"
 #include "nsolver/nsolver.h"
 
 using namespace std;
@@ -82,12 +83,14 @@ int main(int argc, char* argv[]) {
             }
 
         } else {
-            uname =
-                args.getstr(3, "<flowfield>", "velocity field of initial solution from which to start continuation");
-            tname =
-                args.getstr(2, "<flowfield>", "temperature field of initial solution from which to start continuation");
-            sname =
-                args.getstr(1, "<flowfield>", "salinity field of initial solution from which to start continuation");
+            uname = args.getstr(3, "<flowfield>",
+                                "velocity field or DDC state file of initial solution from which to start continuation");
+            tname = args.getstr(2, "<flowfield>",
+                                "temperature field of initial solution from which to start continuation, "
+                                "ignored for a DDC state file");
+            sname = args.getstr(1, "<flowfield>",
+                                "salinity field of initial solution from which to start continuation, "
+                                "ignored for a DDC state file");
         }
         args.check();
 
@@ -186,9 +189,7 @@ int main(int argc, char* argv[]) {
             cout << endl << "loaded the following data..." << endl;
         } else {  // not a restart
             // Compute initial data points for extrapolation from perturbations of given solution
-            u[1] = FlowField(uname, cfmpi);
-            temp[1] = FlowField(tname, cfmpi);
-            salt[1] = FlowField(sname, cfmpi);
+            loadDDCFields(uname, tname, sname, u[1], temp[1], salt[1], cfmpi);
             project(ddcflags.symmetries, u[1], "initial value u", cout);
             project(ddcflags.tempsymmetries, temp[1], "initial value temp", cout);
             project(ddcflags.saltsymmetries, salt[1], "initial value salt", cout);
@@ -12,6 +12,7 @@
 #include "channelflow/poissonsolver.h"
 #include "channelflow/utilfuncs.h"
 #include "modules/ddc/ddcdsi.h"
+#include "modules/ddc/ddcstate.h"
 
 #include <sys/time.h>
 
@@ -64,6 +65,7 @@ class EdgetrackingFlags {
     Real saveInterval;
     bool saveUH;
     bool saveUL;
+    bool saveSeries;  // append uH, uL to the time series uH.nc, uL.nc instead of one file per field and time
     bool keepUL;
     bool checkConvergence;
     bool returnFieldAtMinEcf;
@@ -101,6 +103,8 @@ void ChooseNewLH(const FlowField& u0, const FlowField& temp0, const FlowField& s
                  const DDCFlags& ddcflags, ostream& os = std::cout);
 void SaveForContinuation(const FlowField& uL, const FlowField& uH, const FlowField& tempL, const FlowField& tempH, const FlowField& saltL, const FlowField& saltH,
                          const string dirBisections, Real t);
+void SaveLH(const vector<FlowField>& fields, const string& directory, const string& label, int t,
+            const EdgetrackingFlags& etflags, const DDCFlags& flags);
 
 Attractor CalcAttractor(const FlowField& u0, const FlowField& temp0, const FlowField& salt0, FlowField& returnUField, FlowField& returnTField, FlowField& returnSField,
                         const AttractorFlags& aflags, const TimeStep& dt, const DDCFlags& flags,
@@ -168,6 +172,8 @@ int main(int argc, char* argv[]) {
         etflags.saveInterval = args.getint("-s", "--saveInterval", 0, "save flowfield(s) to disk every s time units");
         etflags.saveUL = args.getbool("-saveUL", "--saveUL", false, "save uL");
         etflags.saveUH = args.getbool("-saveUH", "--saveUH", true, "save uH");
+        etflags.saveSeries = args.getflag("-series", "--timeseries",
+                                          "append saved uH, uL to the time series uH.nc, uL.nc of the save directory");
         etflags.saveMinima = args.getbool("-saveMin", "--saveMinima", false, "save at minima of cross flow energy");
         const int nproc0 =
             args.getint("-np0", "--nproc0", 0, "number of MPI-processes for transpose/number of parallel ffts");
@@ -692,28 +698,16 @@ bool AdvanceLH(FlowField& uL0, FlowField& uH0, FlowField& tempL0, FlowField& tem
                 // Save fields
                 bool saveIntervalReached = etflags.saveInterval != 0 && t % (int)etflags.saveInterval == 0;
                 if (saveIntervalReached) {
-                    if (etflags.saveUH) {
-                        fieldsH[0].save(etflags.directoryFF + "uH" + i2s((int)t));
-                        fieldsH[1].save(etflags.directoryFF + "tH" + i2s((int)t));
-                        fieldsH[2].save(etflags.directoryFF + "sH" + i2s((int)t));
-                    }
-                    if (etflags.saveUL) {
-                        fieldsL[0].save(etflags.directoryFF + "uL" + i2s((int)t));
-                        fieldsL[1].save(etflags.directoryFF + "tL" + i2s((int)t));
-                        fieldsL[2].save(etflags.directoryFF + "sL" + i2s((int)t));
-                    }
+                    if (etflags.saveUH)
+                        SaveLH(fieldsH, etflags.directoryFF, "H", t, etflags, flags);
+                    if (etflags.saveUL)
+                        SaveLH(fieldsL, etflags.directoryFF, "L", t, etflags, flags);
                 }
                 if (ecfMinimum && etflags.saveMinima) {
-                    if (etflags.saveUH) {
-                        fieldsH[0].save(etflags.directoryMinima + "uH" + i2s((int)t));
-                        fieldsH[1].save(etflags.directoryMinima + "tH" + i2s((int)t));
-                        fieldsH[2].save(etflags.directoryMinima + "sH" + i2s((int)t));
-                    }
-                    if (etflags.saveUL) {
-                        fieldsL[0].save(etflags.directoryMinima + "uL" + i2s((int)t));
-                        fieldsL[1].save(etflags.directoryMinima + "tL" + i2s((int)t));
-                        fieldsL[2].save(etflags.directoryMinima + "sL" + i2s((int)t));
-                    }
+                    if (etflags.saveUH)
+                        SaveLH(fieldsH, etflags.directoryMinima, "H", t, etflags, flags);
+                    if (etflags.saveUL)
+                        SaveLH(fieldsL, etflags.directoryMinima, "L", t, etflags, flags);
                 }
                 uL0 = fieldsL[0];
                 uH0 = fieldsH[0];
@@ -876,6 +870,21 @@ void SaveForContinuation(const FlowField& uL, const FlowField& uH, const FlowFie
     fftw_savewisdom();
 }
 
+/** Save uH or uL (label "H" or "L") to directory, as the fields u, t, s + label + t or as a record of the
+ * time series u + label + ".nc"
+ */
+void SaveLH(const vector<FlowField>& fields, const string& directory, const string& label, int t,
+            const EdgetrackingFlags& etflags, const DDCFlags& flags) {
+    if (etflags.saveSeries) {
+        DDCTimeSeries series(directory + "u" + label, fields, flags);
+        series.append(fields, t);
+    } else {
+        fields[0].save(directory + "u" + label + i2s(t));
+        fields[1].save(directory + "t" + label + i2s(t));
+        fields[2].save(directory + "s" + label + i2s(t));
+    }
+}
+
 EdgetrackingFlags::EdgetrackingFlags()
     : tLastWrite(0),
       epsilonAdvance(1e-4),
@@ -889,6 +898,7 @@ EdgetrackingFlags::EdgetrackingFlags()
       saveInterval(0),
       saveUH(true),
       saveUL(false),
+      saveSeries(false),
       keepUL(false),
       checkConvergence(false),
       returnFieldAtMinEcf(false),
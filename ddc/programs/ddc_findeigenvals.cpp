@@ -16,6 +16,7 @@
 #include "channelflow/symmetry.h"
 #include "channelflow/tausolver.h"
 #include "modules/ddc/ddcdsi.h"
+#include "modules/ddc/ddcstate.h"
 #include "nsolver/nsolver.h"
 
 using namespace std;
@@ -71,9 +72,12 @@ int main(int argc, char* argv[]) {
             args.getint("-np0", "--nproc0", 0, "number of MPI-processes for transpose/number of parallel ffts");
         const int nproc1 = args.getint("-np1", "--nproc1", 0, "number of MPI-processes for one fft");
 
-        const string uname = args.getstr(3, "<flowfield>", "filename for EQB, TW, or PO velocity solution");
-        const string tname = args.getstr(2, "<flowfield>", "filename for EQB, TW, or PO temperature solution");
-        const string sname = args.getstr(1, "<flowfield>", "filename for EQB, TW, or PO salinity solution");
+        const string uname =
+            args.getstr(3, "<flowfield>", "filename for EQB, TW, or PO velocity solution or a DDC state file");
+        const string tname = args.getstr(2, "<flowfield>",
+                                         "filename for EQB, TW, or PO temperature solution, ignored for a DDC state file");
+        const string sname = args.getstr(1, "<flowfield>",
+                                         "filename for EQB, TW, or PO salinity solution, ignored for a DDC state file");
 
         CfMPI* cfmpi = &CfMPI::getInstance(nproc0, nproc1);
 
@@ -88,9 +92,21 @@ int main(int argc, char* argv[]) {
 
         PoincareCondition* h = poincare ? new DragDissipation() : 0;
 
-        FlowField u(uname, cfmpi);  // u*, the solution of sigma f^T(u*) - u* = 0
-        FlowField temp(tname, cfmpi);  // temp*, the solution of sigma f^T(u*,temp*) - u*,temp* = 0
-        FlowField salt(sname, cfmpi);  // salt*, the solution of sigma f^T(u*,salt*) - u*,salt* = 0
+        // u*, temp*, salt*, the solution of sigma f^T(u*,temp*,salt*) - (u*,temp*,salt*) = 0
+        // scalars that are not integrated in the selected system are left empty and dropped from the eigenproblem
+        const DDCCoefficients coeff = ddcflags.coefficients();
+        FlowField u, temp, salt;
+        if (isDDCState(uname)) {
+            loadDDCFields(uname, tname, sname, u, temp, salt, cfmpi);
+            if (!coeff.temperature)
+                temp = FlowField();
+            if (!coeff.salinity)
+                salt = FlowField();
+        } else {
+            u = FlowField(uname, cfmpi);
+            temp = coeff.temperature ? FlowField(tname, cfmpi) : FlowField();
+            salt = coeff.salinity ? FlowField(sname, cfmpi) : FlowField();
+        }
 
         const int Nx = u.Nx();
         const int Ny = u.Ny();
@@ -243,27 +259,27 @@ int main(int argc, char* argv[]) {
             du = FlowField(duname, cfmpi);
         }
 
-        if (dtname.length() == 0) {
+        if (activeScalar(dtemp) && dtname.length() == 0) {
             cout << "Constructing dtemp..." << endl;
             bool meanflow_perturb = true;
             dtemp.addPerturbations(kxmax, kzmax, 1.0, decay, meanflow_perturb);
-        } else {
+        } else if (activeScalar(dtemp)) {
             dtemp = FlowField(dtname, cfmpi);
         }
 
-        if (dsname.length() == 0) {
+        if (activeScalar(dsalt) && dsname.length() == 0) {
             cout << "Constructing dsalt..." << endl;
             bool meanflow_perturb = true;
             dsalt.addPerturbations(kxmax, kzmax, 1.0, decay, meanflow_perturb);
-        } else {
+        } else if (activeScalar(dsalt)) {
             dsalt = FlowField(dsname, cfmpi);
         }
 
         if (ddcflags.symmetries.length() != 0)
             project(ddcflags.symmetries, du);
-        if (ddcflags.tempsymmetries.length() != 0)
+        if (ddcflags.tempsymmetries.length() != 0 && activeScalar(dtemp))
             project(ddcflags.tempsymmetries, dtemp);
-        if (ddcflags.saltsymmetries.length() != 0)
+        if (ddcflags.saltsymmetries.length() != 0 && activeScalar(dsalt))
             project(ddcflags.saltsymmetries, dsalt);
 
         printout("L2Norm(du) = " + r2s(L2Norm(du)));
@@ -271,15 +287,19 @@ int main(int argc, char* argv[]) {
         du *= EPS_du / L2Norm(du);
         printout("L2Norm(du) = " + r2s(L2Norm(du)));
 
-        printout("L2Norm(dtemp) = " + r2s(L2Norm(dtemp)));
-        printout("rescaling dtemp by eps_du = " + r2s(EPS_du));
-        dtemp *= EPS_du / L2Norm(dtemp);
-        printout("L2Norm(dtemp) = " + r2s(L2Norm(dtemp)));
+        if (activeScalar(dtemp)) {
+            printout("L2Norm(dtemp) = " + r2s(L2Norm(dtemp)));
+            printout("rescaling dtemp by eps_du = " + r2s(EPS_du));
+            dtemp *= EPS_du / L2Norm(dtemp);
+            printout("L2Norm(dtemp) = " + r2s(L2Norm(dtemp)));
+        }
 
-        printout("L2Norm(dsalt) = " + r2s(L2Norm(dsalt)));
-        printout("rescaling dsalt by eps_du = " + r2s(EPS_du));
-        dsalt *= EPS_du / L2Norm(dsalt);
-        printout("L2Norm(dsalt) = " + r2s(L2Norm(dsalt)));
+        if (activeScalar(dsalt)) {
+            printout("L2Norm(dsalt) = " + r2s(L2Norm(dsalt)));
+            printout("rescaling dsalt by eps_du = " + r2s(EPS_du));
+            dsalt *= EPS_du / L2Norm(dsalt);
+            printout("L2Norm(dsalt) = " + r2s(L2Norm(dsalt)));
+        }
 
         VectorXd dx;
         field2vector(du, dtemp, dsalt, dx);
@@ -10,6 +10,7 @@
 #include "cfbasics/cfbasics.h"
 #include "channelflow/flowfield.h"
 #include "modules/ddc/ddcdsi.h"
+#include "modules/ddc/ddcstate.h"
 #include "nsolver/nsolver.h"
 
 using namespace std;
@@ -53,9 +54,12 @@ int main(int argc, char* argv[]) {
         const int nproc1 = args.getint("-np1", "--nproc1", 0, "number of MPI-processes for one fft");
         const bool msinit =
             args.getflag("-MSinit", "--MSinitials", "read different files as the initial guesses for different shoots");
-        const string uname = args.getstr(3, "<flowfield>", "initial guess for the velocity solution");
-        const string tname = args.getstr(2, "<flowfield>", "initial guess for the temperature solution");
-        const string sname = args.getstr(1, "<flowfield>", "initial guess for the salinity solution");
+        const string uname =
+            args.getstr(3, "<flowfield>", "initial guess for the velocity solution or a DDC state file");
+        const string tname = args.getstr(2, "<flowfield>",
+                                         "initial guess for the temperature solution, ignored for a DDC state file");
+        const string sname = args.getstr(1, "<flowfield>",
+                                         "initial guess for the salinity solution, ignored for a DDC state file");
 
         args.check();
         args.save();
@@ -65,9 +69,8 @@ int main(int argc, char* argv[]) {
 
         CfMPI* cfmpi = &CfMPI::getInstance(nproc0, nproc1);
 
-        FlowField u(uname, cfmpi);
-        FlowField temp(tname, cfmpi);
-        FlowField salt(sname, cfmpi);
+        FlowField u, temp, salt;
+        loadDDCFields(uname, tname, sname, u, temp, salt, cfmpi);
 
         FieldSymmetry sigma;
         if (sigmastr.length() != 0)
@@ -8,9 +8,12 @@
 
 
 #include <sys/stat.h>
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
 
 #include "cfbasics/cfvector.h"
@@ -22,11 +25,13 @@
 #include "channelflow/symmetry.h"
 #include "channelflow/tausolver.h"
 #include "channelflow/utilfuncs.h"
-#include "modules/ddc/macros.h"
 #include "modules/ddc/ddcdsi.h"
 #include "modules/ddc/ddc.h"
 #include "modules/ddc/boundaryCondition.h"
 #include "modules/ddc/turbulenceStatistics.h"
+#include "modules/ddc/ddcwriter.h"
+#include "modules/ddc/ddcstate.h"
+#include "modules/ddc/ddcslices.h"
 using namespace std;
 using namespace chflow;
 
@@ -45,6 +50,7 @@ int main(int argc, char* argv[]) {
         ArgList args(argc, argv, purpose);
 
         DDCFlags flags(args);
+        const DDCCoefficients coeff = flags.coefficients();
         TimeStep dt(flags);
 
         args.section("Program options");
@@ -75,12 +81,46 @@ int main(int argc, char* argv[]) {
 
         const string outdir_profiles = args.getpath("-op", "--outdir_profiles", "profiles/", "output directory of mean profiles");
         const bool savetot = args.getflag("-savetot", "--savetotfields", "save total fields");
-
-        const string uname = args.getstr(3, "<flowfield>", "initial guess for the velocity solution");
-        const string tname = args.getstr(2, "<flowfield>", "initial guess for the temperature solution");
-        const string sname = args.getstr(1, "<flowfield>", "initial guess for the salinity solution");
+        const int writequeue = args.getint("-wq", "--writequeue", 2,
+                                           "snapshots queued for the writer thread while time stepping continues, "
+                                           "0: save synchronously. With MPI the snapshots are gathered on process "
+                                           "0, which needs memory for wq+1 complete snapshots");
+        const bool savestate = args.getflag("-state", "--savestate",
+                                            "save u, T, S and p of each snapshot into one DDC state file stateN.nc "
+                                            "instead of separate files (fluctuations only, -savetot is ignored)");
+        const bool saveseries = args.getflag("-series", "--timeseries",
+                                             "append u, T, S and p of each snapshot as a record to the time series "
+                                             "series.nc instead of separate files (fluctuations only, -savetot is "
+                                             "ignored), an existing series is continued");
+        const Real utol = args.getreal("-utol", "--utolerance", 0.0,
+                                       "with -state or -series: absolute error bound of the stored velocity "
+                                       "coefficients, 0: lossless, < 0: single precision");
+        const Real ttol = args.getreal("-ttol", "--ttolerance", 0.0, "as -utol for the temperature");
+        const Real stol = args.getreal("-stol", "--stolerance", 0.0, "as -utol for the salinity");
+        const Real ptol = args.getreal("-ptol", "--ptolerance", 0.0, "as -utol for the pressure");
+        const string slicespecs = args.getstr("-slices", "--slices", "",
+                                              "planes and lines extracted into slices.nc, separated by ';', e.g. "
+                                              "\"z=0.5;y=0;x=1,z=0.5\" (x-y plane, wall-parallel plane, line along y)");
+        const int sliceint = args.getint("-slint", "--sliceinterval", 1, "extract the slices every slint time steps");
+        const bool slicetot = args.getflag("-slicetot", "--slicetotal", "extract the total fields into the slices");
+        const int restartint = args.getint("-ri", "--restartinterval", 10,
+                                           "with lossy snapshots: write the lossless checkpoint restart.nc every "
+                                           "ri snapshots");
+
+        const string uname = args.getstr(3, "<flowfield>", "initial guess for the velocity solution or a DDC state file");
+        const string tname = args.getstr(2, "<flowfield>",
+                                         "initial guess for the temperature solution, ignored for a DDC state file");
+        const string sname = args.getstr(1, "<flowfield>",
+                                         "initial guess for the salinity solution, ignored for a DDC state file");
          
         args.check();
+        const DDCPrecision precision(utol, ttol, stol, ptol);
+        if (!precision.lossless() && !savestate && !saveseries)
+            cferror("-utol, -ttol, -stol and -ptol need the NetCDF output of -state or -series");
+        if (restartint <= 0)
+            cferror("-ri must be positive");
+        if (sliceint <= 0)
+            cferror("-slint must be positive");
         args.save("./");
         mkdir(outdir);
         args.save(outdir);
@@ -91,9 +131,8 @@ int main(int argc, char* argv[]) {
         CfMPI* cfmpi = &CfMPI::getInstance(nproc0, nproc1);
 
         printout("Constructing u,q, and optimizing FFTW...");
-        FlowField u(uname, cfmpi);
-        FlowField temp(tname, cfmpi);
-        FlowField salt(sname, cfmpi);
+        FlowField u, temp, salt;
+        loadDDCFields(uname, tname, sname, u, temp, salt, cfmpi);
         
         const int Nx = u.Nx();
         const int Ny = u.Ny();
@@ -111,26 +150,26 @@ int main(int argc, char* argv[]) {
         
 
         cout << "Parameters: " << endl;
+        cout << "system = " << ddcsystem2s(flags.system) << endl;
         cout << "Ra = " << flags.Ra << endl;
         cout << "Le = " << flags.Le << endl;
         cout << "Pr = " << flags.Pr << endl;
         cout << "Ri = " << flags.Ri << endl;
         cout << "Rrho = " << flags.Rrho << endl;
-        #ifdef P7
-        cout << "Rsep = " << flags.Rsep << endl;
-        #endif
+        if (coeff.crossdiffusion)
+            cout << "Rsep = " << flags.Rsep << endl;
         cout << "Ua = " << flags.ulowerwall << endl;
         cout << "Wa = " << flags.wlowerwall << endl;
         cout << "Ub = " << flags.uupperwall << endl;
         cout << "Wb = " << flags.wupperwall << endl;
-        #ifdef P5
-        cout << "Ta = " << flags.tlowerwall << endl;
-        cout << "Tb = " << flags.tupperwall << endl;
-        #endif
-        #ifdef P6
-        cout << "Sa = " << flags.slowerwall << endl;
-        cout << "Sb = " << flags.supperwall << endl;
-        #endif
+        if (coeff.temperature) {
+            cout << "Ta = " << flags.tlowerwall << endl;
+            cout << "Tb = " << flags.tupperwall << endl;
+        }
+        if (coeff.salinity) {
+            cout << "Sa = " << flags.slowerwall << endl;
+            cout << "Sb = " << flags.supperwall << endl;
+        }
 
         // Construct data fields: 3d velocity, 1d temperature, 1d salinity and 1d pressure
         vector<FlowField> fields = {u, temp, salt, q};// pressure
@@ -153,17 +192,43 @@ int main(int argc, char* argv[]) {
         ofstream eout, x0out;
         openfile(eout, outdir + "energy.asc", openflag);
         eout << ddcfieldstatsheader_t("t", flags) << endl;
+
+        // error-controlled steps replace the CFL adjustment of dt
+        const bool adaptive = flags.errortol > 0;
+        if (adaptive && (flags.imex == NoIMEX || flags.freezevelocity))
+            cferror("--errortol needs an IMEX scheme (--imex) and excludes --freezevelocity");
+        ofstream stepout;
+        if (adaptive) {
+            openfile(stepout, outdir + "steps.asc", openflag);
+            stepout << "% t dt err/errortol accepted" << endl;
+        }
         
-        #ifdef P6
-        #ifdef SAVESTATS
+        const bool savestats = flags.savestats && coeff.salinity;
         DDCTurbStats meanProfiles(Ny);
-        mkdir(outdir_profiles);
-        #endif
-        #endif
-
-        #ifdef FREEZEvelocity
-        FlowField u0 = u;
-        #endif
+        if (savestats)
+            mkdir(outdir_profiles);
+
+        const FlowField u0 = u;  // velocity kept fixed with flags.freezevelocity
+        // base profiles of the state files, resolved here so that the writer thread only writes
+        const std::shared_ptr<const DDCBaseFlow> statebaseflow = ddcBaseFlow(Ny, a, b, flags);
+        // the series outlives the writer, which appends the queued snapshots to it
+        std::unique_ptr<DDCTimeSeries> series;
+        if (saveseries)
+            series.reset(new DDCTimeSeries(outdir + "series", fields, flags, precision));
+        DDCSnapshotWriter writer(writequeue);
+
+        // in-situ extraction of planes and lines, every sliceint steps (adaptive dt: every dT)
+        std::unique_ptr<DDCSlices> slices;
+        if (!slicespecs.empty()) {
+            vector<string> specs;
+            stringstream ss(slicespecs);
+            string spec;
+            while (getline(ss, spec, ';'))
+                if (!spec.empty())
+                    specs.push_back(spec);
+            slices.reset(new DDCSlices(outdir + "slices", specs, fields, flags, slicetot, flags.t0 > 0));
+        }
+        int slicestep = 0;  // time steps since the start, the slices are extracted when it is a multiple of sliceint
         int count=0;
         for (Real t = flags.t0; t <= flags.T; t += dt.dT()) {
             string s;
@@ -174,60 +239,95 @@ int main(int argc, char* argv[]) {
             }
 
             cout << s;
+            if (flags.imex != NoIMEX)
+                cout << "        err == " << ddc.errorEstimate() << endl;
+            if (adaptive)
+                cout << "    next dt == " << ddc.adaptiveDt() << ", steps accepted == " << ddc.acceptedSteps()
+                     << ", rejected == " << ddc.rejectedSteps() << endl;
             s = ddcfieldstats_t(fields[0], fields[1], fields[2], t, flags);
             eout << s << endl;
 
-            #ifdef P6
-            #ifdef SAVESTATS
-            meanProfiles.addSnapshot(fields, flags);
-            // save horizontially averaged fields
-            meanProfiles.saveTurbStats(outdir_profiles + "meanprofile" + i2s(int(count)), fields);
-            #endif
-            #endif
+            if (savestats) {
+                meanProfiles.addSnapshot(fields, flags, dt.dT());
+                // save horizontially averaged fields
+                meanProfiles.saveTurbStats(outdir_profiles + "meanprofile" + i2s(int(count)), fields);
+            }
             
-            // Write velocity and modified pressure fields to disk
-            if(!savetot){
-                fields[0].save(outdir + ulabel + i2s(int(count)));//<<--- save only fluctuations
-                #ifdef P5
-                fields[1].save(outdir + tlabel + i2s(int(count)));
-                #endif
-                #ifdef P6
-                fields[2].save(outdir + slabel + i2s(int(count)));
-                #endif
+            // Write velocity, temperature and salinity fields to disk, overlapped with the next time steps
+            // (the pressure is not saved)
+            const vector<string> filebases = {outdir + ulabel + i2s(int(count)),
+                                              coeff.temperature ? outdir + tlabel + i2s(int(count)) : "",
+                                              coeff.salinity ? outdir + slabel + i2s(int(count)) : "", ""};
+            if (series) {
+                DDCTimeSeries* ts = series.get();
+                writer.save(fields, [ts, t](const vector<FlowField>& f) { ts->append(f, t); });
+            } else if (savestate) {
+                const string statebase = outdir + "state" + i2s(int(count));
+                const DDCFlags stateflags = flags;
+                writer.save(fields, [statebase, t, stateflags, precision, statebaseflow](const vector<FlowField>& f) {
+                    saveDDCState(statebase, f, t, stateflags, precision, statebaseflow);
+                });
+            } else if(!savetot){
+                writer.save(fields, filebases);//<<--- save only fluctuations
             }else{
-                FlowField u_tot = totalVelocity(fields[0], flags); u_tot.save(outdir + ulabel + i2s(int(count)));//<<--- save total fields
-                #ifdef P5
-                FlowField temp_tot = totalTemperature(fields[1], flags); temp_tot.save(outdir + tlabel + i2s(int(count)));
-                #endif
-                #ifdef P6
-                FlowField salt_tot = totalSalinity(fields[2], flags); salt_tot.save(outdir + slabel + i2s(int(count)));
-                #endif
+                vector<FlowField> totfields;//<<--- save total fields
+                totfields.push_back(totalVelocity(fields[0], flags));
+                totfields.push_back(coeff.temperature ? totalTemperature(fields[1], flags) : FlowField());
+                totfields.push_back(coeff.salinity ? totalSalinity(fields[2], flags) : FlowField());
+                totfields.push_back(FlowField());
+                writer.save(totfields, filebases);
+            }
+            // lossy snapshots cannot restart the run, keep a lossless checkpoint. It is written to restart.tmp.nc
+            // and renamed, so that a crash during the write leaves the previous restart.nc intact.
+            if (!precision.lossless() && count % restartint == 0) {
+                const string restartname = outdir + "restart.nc";
+                const string tmpname = outdir + "restart.tmp.nc";
+                const DDCFlags stateflags = flags;
+                writer.save(fields, [restartname, tmpname, t, stateflags, statebaseflow](const vector<FlowField>& f) {
+                    saveDDCState(tmpname, f, t, stateflags, DDCPrecision(), statebaseflow);
+                    if (f[0].taskid() == 0 && rename(tmpname.c_str(), restartname.c_str()) != 0)
+                        cferror("cannot rename " + tmpname + " to " + restartname);
+                });
             }
+            if (slices && (count == 0 || adaptive))
+                slices->extract(fields, t);
             count+=1;
 
-            #ifdef FREEZEvelocity
-            for (int step = 0; step < dt.n(); ++step) {
-                fields[0] = u0;
-                cout << "." << flush;
-                ddc.advance(fields, 1);
-            }  // End of time stepping loop
-            #else
-
-            // Take n steps of length dt
-            #ifndef FREESLIP
-            ddc.advance(fields, dt.n());
-            #endif
-            #ifdef FREESLIP // this is not really used
-            for (int step = 0; step < dt.n(); ++step) {
-                // cout << "." << flush;
-                freeslipBC(fields);// add free-slip boundary conditions
-                ddc.advance(fields, 1);
-            }  // End of time stepping loop
-            #endif
-
-            #endif
-
-            if (dt.variable() &&
+            if (flags.freezevelocity) {
+                for (int step = 0; step < dt.n(); ++step) {
+                    fields[0] = u0;
+                    cout << "." << flush;
+                    ddc.advance(fields, 1);
+                    if (slices && ++slicestep % sliceint == 0)
+                        slices->extract(fields, t + (step + 1) * dt.dt());
+                }  // End of time stepping loop
+            } else if (adaptive) {
+                ddc.advanceAdaptive(fields, dt.dT(), &stepout);
+                stepout << flush;
+            } else if (flags.freeslip && !ddc.imposesFreeslip()) { // multistep schemes impose it inside DDCAlgo
+                for (int step = 0; step < dt.n(); ++step) {
+                    // cout << "." << flush;
+                    freeslipBC(fields, flags);// add free-slip boundary conditions
+                    ddc.advance(fields, 1);
+                    if (slices && ++slicestep % sliceint == 0)
+                        slices->extract(fields, t + (step + 1) * dt.dt());
+                }  // End of time stepping loop
+            } else if (slices) {
+                // Take n steps of length dt in groups that end at the next multiple of sliceint steps
+                for (int step = 0; step < dt.n();) {
+                    const int nsteps = std::min(sliceint - slicestep % sliceint, dt.n() - step);
+                    ddc.advance(fields, nsteps);
+                    step += nsteps;
+                    slicestep += nsteps;
+                    if (slicestep % sliceint == 0)
+                        slices->extract(fields, t + step * dt.dt());
+                }
+            } else {
+                // Take n steps of length dt
+                ddc.advance(fields, dt.n());
+            }
+
+            if (!adaptive && dt.variable() &&
                 dt.adjust(ddc.CFL(fields[0])))  // TODO: dt.variable()==true is checked twice here, remove it.
                 ddc.reset_dt(dt);
             cout << endl;
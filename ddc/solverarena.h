@@ -0,0 +1,97 @@
+/**
+ * Contiguous storage of the per-mode solvers of the DDE
+ *
+ * SolverArena keeps the solver objects of all substeps and Fourier modes in a single cache-line aligned
+ * block, indexed by (substep, mx, mz), instead of three levels of new[].
+ */
+
+#ifndef SOLVERARENA_H
+#define SOLVERARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace chflow {
+
+/** \brief cache-line aligned 3d array of solver objects with RAII ownership
+ *
+ * Elements are default-constructed and laid out with mz fastest, so that the mode loops of DDE
+ * walk through memory linearly. The arena can be moved but not copied.
+ */
+template <class T>
+class SolverArena {
+   public:
+    static const size_t alignment = 64;  // cache-line size
+
+    SolverArena() : Nsub_(0), Mx_(0), Mz_(0), raw_(0), data_(0) {}
+
+    SolverArena(int Nsub, int Mx, int Mz) : Nsub_(Nsub), Mx_(Mx), Mz_(Mz), raw_(0), data_(0) {
+        const size_t n = size();
+        if (n == 0)
+            return;
+        size_t space = n * sizeof(T) + alignment;
+        raw_ = ::operator new(space);
+        void* p = raw_;
+        data_ = static_cast<T*>(std::align(alignment, n * sizeof(T), p, space));
+        size_t i = 0;
+        try {
+            for (; i < n; ++i)
+                new (data_ + i) T();
+        } catch (...) {
+            destroy(i);
+            throw;
+        }
+    }
+
+    SolverArena(SolverArena&& other) : SolverArena() { swap(other); }
+    SolverArena& operator=(SolverArena&& other) {
+        SolverArena tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+    SolverArena(const SolverArena&) = delete;
+    SolverArena& operator=(const SolverArena&) = delete;
+
+    ~SolverArena() { destroy(size()); }
+
+    inline T& operator()(int j, int mx, int mz) { return data_[(size_t(j) * Mx_ + mx) * Mz_ + mz]; }
+    inline const T& operator()(int j, int mx, int mz) const { return data_[(size_t(j) * Mx_ + mx) * Mz_ + mz]; }
+
+    inline int Nsubsteps() const { return Nsub_; }
+    inline int Mx() const { return Mx_; }
+    inline int Mz() const { return Mz_; }
+    inline size_t size() const { return size_t(Nsub_) * Mx_ * Mz_; }
+    inline bool empty() const { return size() == 0; }
+
+    // bytes of the contiguous block (memory owned by the elements themselves is not included)
+    inline size_t bytes() const { return raw_ ? size() * sizeof(T) + alignment : 0; }
+
+    void swap(SolverArena& other) {
+        std::swap(Nsub_, other.Nsub_);
+        std::swap(Mx_, other.Mx_);
+        std::swap(Mz_, other.Mz_);
+        std::swap(raw_, other.raw_);
+        std::swap(data_, other.data_);
+    }
+
+   private:
+    void destroy(size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            data_[i].~T();
+        ::operator delete(raw_);
+        raw_ = 0;
+        data_ = 0;
+        Nsub_ = Mx_ = Mz_ = 0;
+    }
+
+    int Nsub_;
+    int Mx_;
+    int Mz_;
+    void* raw_;  // block returned by operator new
+    T* data_;    // first aligned element inside raw_
+};
+
+}  // namespace chflow
+#endif
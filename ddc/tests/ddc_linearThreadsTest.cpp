@@ -0,0 +1,66 @@
+/**
+ * DDE::linear with 1, 2, 4, ... up to the available OpenMP threads against the serial evaluation
+ *
+ * Each Fourier mode runs the same arithmetic in the thread-local workspace of its thread, so every thread count
+ * has to reproduce the serial result exactly. The thread count is raised after the DDE is constructed, which
+ * also covers the growth of the workspace.
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "cfbasics/mathdefs.h"
+#include "channelflow/flowfield.h"
+#include "channelflow/utilfuncs.h"
+#include "modules/ddc/dde.h"
+#include "modules/ddc/validations/ddcfixture.h"
+using namespace std;
+using namespace chflow;
+
+int main(int argc, char* argv[]) {
+    cfMPI_Init(&argc, &argv);
+    bool success = true;
+    {
+        const DDCTestGrid grid = {24, 25, 24, 2 * pi, pi, -1.0, 1.0};
+        const DDCFlags flags = shearedLayerFlags(100.0);
+
+        vector<FlowField> fields = ddcTestFields(grid);
+        perturbFields(fields, 6, 0.1, 0.05, true);
+
+#ifdef _OPENMP
+        const int maxthreads = omp_get_max_threads();
+        omp_set_num_threads(1);
+#else
+        const int maxthreads = 1;
+#endif
+        DDE dde(fields, flags);
+        vector<FlowField> serial = dde.createRHS(fields);
+        vector<FlowField> linf = dde.createRHS(fields);
+        dde.linear(fields, serial);
+
+        // 2, 4, ... threads and the maximum
+        for (int threads = 2; threads <= maxthreads;
+             threads = (threads == maxthreads) ? maxthreads + 1 : std::min(2 * threads, maxthreads)) {
+#ifdef _OPENMP
+            omp_set_num_threads(threads);
+#endif
+            dde.linear(fields, linf);
+            bool identical = true;
+            for (uint l = 0; l < linf.size(); ++l)
+                identical = identical && L2Dist(linf[l], serial[l]) == 0;
+            cout << setw(8) << threads << " threads: " << (identical ? "identical" : "differs") << endl;
+            success = success && identical;
+        }
+        if (maxthreads == 1)
+            cout << "one thread available, nothing to compare" << endl;
+#ifdef _OPENMP
+        omp_set_num_threads(maxthreads);
+#endif
+    }
+    cfMPI_Finalize();
+    return testResult(success);
+}
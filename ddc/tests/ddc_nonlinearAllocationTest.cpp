@@ -0,0 +1,70 @@
+/**
+ * Heap allocations of DDE::nonlinear, counted by replacing the global operator new
+ *
+ * After a first call that sets up the workspace, DDE::nonlinear has to evaluate the nonlinear terms of all
+ * systems without allocating: the base profiles, flags and coefficients come from the DDCNLContext of the DDE.
+ * Prints the allocations per call for each DDCSystem and fails if any call allocates.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "cfbasics/mathdefs.h"
+#include "channelflow/flowfield.h"
+#include "channelflow/utilfuncs.h"
+#include "modules/ddc/dde.h"
+#include "modules/ddc/validations/ddcfixture.h"
+using namespace std;
+using namespace chflow;
+
+static std::atomic<long> allocations(0);
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char* argv[]) {
+    cfMPI_Init(&argc, &argv);
+    bool success = true;
+    {
+        const DDCTestGrid grid = {16, 17, 16, 2 * pi, pi, -1.0, 1.0};
+        const int calls = 5;
+
+        const vector<DDCSystem> systems = {ShearedDDC, BinaryFluid, Couette, StratifiedCouette, RayleighBenard};
+        for (DDCSystem system : systems) {
+            DDCFlags flags = shearedLayerFlags(100.0);
+            flags.system = system;
+
+            vector<FlowField> fields = ddcTestFields(grid);
+            perturbFields(fields, 4, 0.1, 0.05);
+
+            DDE dde(fields, flags);
+            vector<FlowField> nonlf = dde.createRHS(fields);
+            dde.nonlinear(fields, nonlf);
+
+            allocations = 0;
+            for (int n = 0; n < calls; ++n)
+                dde.nonlinear(fields, nonlf);
+            const long count = allocations;
+
+            cout << setw(20) << left << ddcsystem2s(system) << right << setw(10) << Real(count) / calls
+                 << " allocations per call" << endl;
+            if (count != 0)
+                success = false;
+        }
+    }
+    cfMPI_Finalize();
+    return testResult(success);
+}
@@ -0,0 +1,59 @@
+/**
+ * ddcstats against the separate channelflow diagnostics it replaces
+ *
+ * ddcstats accumulates all columns in one spectral sweep with one reduction. For perturbed fields of the
+ * double-diffusive systems every column has to agree with the former sequence of L2Norm, dissipation,
+ * wallshear, ... calls to round-off.
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "cfbasics/mathdefs.h"
+#include "channelflow/flowfield.h"
+#include "modules/ddc/ddcdsi.h"
+#include "modules/ddc/validations/ddcfixture.h"
+using namespace std;
+using namespace chflow;
+
+int main(int argc, char* argv[]) {
+    cfMPI_Init(&argc, &argv);
+    bool success = true;
+    {
+        const DDCTestGrid grid = {16, 25, 16, 2 * pi, pi, -1.0, 1.0};
+        const Real maxdiff = 1e-12;
+
+        const vector<DDCSystem> systems = {ShearedDDC, StationaryWallDDC, MovingWallDDC};
+        for (DDCSystem system : systems) {
+            DDCFlags flags = shearedLayerFlags(100.0);
+            flags.system = system;
+            flags.ystats = 0.25;
+
+            vector<FlowField> fields = ddcTestFields(grid);
+            perturbFields(fields, 4, 0.1, 0.05);
+
+            const vector<Real> fused = ddcstats(fields[0], fields[1], fields[2], flags);
+            const vector<Real> separate = separateStats(fields[0], fields[1], fields[2], flags);
+
+            cout << ddcsystem2s(system) << ":";
+            if (fused.size() != separate.size()) {
+                cout << " ddcstats returns " << fused.size() << " columns instead of " << separate.size() << endl;
+                success = false;
+                continue;
+            }
+            Real maxd = 0;
+            for (uint i = 0; i < fused.size(); ++i) {
+                const Real diff = abs(fused[i] - separate[i]) / (1 + abs(separate[i]));
+                if (!(diff < maxdiff)) {
+                    cout << " column " << i << ": " << setprecision(16) << fused[i] << " != " << separate[i];
+                    success = false;
+                }
+                maxd = std::max(maxd, diff);
+            }
+            cout << setprecision(6) << " max rel diff == " << maxd << endl;
+        }
+    }
+    cfMPI_Finalize();
+    return testResult(success);
+}
@@ -0,0 +1,87 @@
+/**
+ * Regression test of DDCAlgo against the MultistepDNS integration it replaces
+ *
+ * Both algorithms advance the same smooth double-diffusive perturbation of a sheared layer with CNFE1 and SBDF1-4
+ * on separate DDE instances, initialized with the same CNRK2 steps. The swap-based DDCAlgo has to reproduce the
+ * result of MultistepDNS up to round-off, and the fields it returns have to keep their shape.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cfbasics/mathdefs.h"
+#include "channelflow/dnsalgo.h"
+#include "channelflow/flowfield.h"
+#include "channelflow/utilfuncs.h"
+#include "modules/ddc/ddcalgo.h"
+#include "modules/ddc/dde.h"
+#include "modules/ddc/validations/ddcfixture.h"
+using namespace std;
+using namespace chflow;
+
+int main(int argc, char* argv[]) {
+    cfMPI_Init(&argc, &argv);
+    bool success = true;
+    {
+        const DDCTestGrid grid = {12, 25, 10, 2 * pi, pi, -1.0, 1.0};
+
+        DDCFlags flags = shearedLayerFlags(10.0);
+        flags.dt = 0.01;
+        flags.verbosity = Silent;
+        flags.initstepping = CNRK2;
+
+        vector<FlowField> fields0 = ddcTestFields(grid);
+        perturbFields(fields0, 3, 0.1, 0.05);
+
+        const int Nsteps = 20;
+        const Real maxdist = 1e-12;
+        const vector<TimeStepMethod> schemes = {CNFE1, SBDF1, SBDF2, SBDF3, SBDF4};
+        const char* names[] = {"u", "T", "S"};
+
+        for (TimeStepMethod scheme : schemes) {
+            flags.timestepping = scheme;
+            vector<FlowField> fieldsm = fields0;
+            vector<FlowField> fieldsd = fields0;
+
+            shared_ptr<DDE> ddem = make_shared<DDE>(fieldsm, flags);
+            shared_ptr<DDE> dded = make_shared<DDE>(fieldsd, flags);
+            MultistepDNS multistep(fieldsm, ddem, flags);
+            DDCAlgo ddcalgo(fieldsd, dded, flags);
+
+            // both algorithms get the same history from CNRK2
+            DDCFlags initflags = flags;
+            initflags.timestepping = CNRK2;
+            shared_ptr<DDE> ddei = make_shared<DDE>(fieldsm, initflags);
+            RungeKuttaDNS init(fieldsm, ddei, initflags);
+            for (int n = 0; n <= multistep.Ninitsteps(); ++n) {
+                multistep.push(fieldsm);
+                ddcalgo.push(fieldsm);
+                if (multistep.full())
+                    break;
+                init.advance(fieldsm, 1);
+            }
+            fieldsd = fieldsm;
+
+            multistep.advance(fieldsm, Nsteps);
+            ddcalgo.advance(fieldsd, Nsteps / 2);
+            ddcalgo.advance(fieldsd, Nsteps - Nsteps / 2);
+
+            cout << "scheme " << scheme << ":";
+            for (int l = 0; l < 3; ++l) {
+                if (!fieldsd[l].congruent(fieldsm[l])) {
+                    cout << " " << names[l] << " changed its shape";
+                    success = false;
+                    continue;
+                }
+                const Real dist = L2Dist(fieldsd[l], fieldsm[l]) / (1 + L2Norm(fieldsm[l]));
+                cout << " L2Dist(" << names[l] << ") == " << dist;
+                if (!(dist < maxdist))
+                    success = false;
+            }
+            cout << endl;
+        }
+    }
+    cfMPI_Finalize();
+    return testResult(success);
+}
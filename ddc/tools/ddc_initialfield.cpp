@@ -9,7 +9,7 @@
 #include "channelflow/flowfield.h"
 #include "channelflow/symmetry.h"
 #include "channelflow/utilfuncs.h"
-#include "modules/ddc/macros.h"
+#include "modules/ddc/ddcflags.h"
 #include "modules/ddc/addPerturbations.h"
 using namespace std;
 using namespace chflow;
@@ -22,6 +22,9 @@ int main(int argc, char* argv[]) {
 
         ArgList args(argc, argv, purpose);
         const string modelabel = args.getstr("-m", "--modelabel", "nor", "problem/mode of initial conditions");
+        DDCFlags flags;
+        flags.system = s2ddcsystem(args.getstr("-sys", "--system", "sheared", "governing equations, see ddc_simulateflow"));
+        const DDCCoefficients coeff = flags.coefficients();
         const int Nx = args.getint("-Nx", "--Nx", "# x gridpoints");
         const int Ny = args.getint("-Ny", "--Ny", "# y gridpoints");
         const int Nz = args.getint("-Nz", "--Nz", "# z gridpoints");
@@ -60,36 +63,28 @@ int main(int argc, char* argv[]) {
         cout << "Perturbing velocity, temperature, and salinity fields of " << modelabel << " mode ... " << flush;
         if(modelabel=="yang2021jfm_case3"){// define initial contions of Yang2021JFM's simulation
             addRandomPerturbations(u,1e-3);
-            #ifdef P5
-            addSinusoidalPerturbations(temp,-0.05,6.0);
-            #endif
-            #ifdef P6
-            addSinusoidalPerturbations(salt,-0.05,6.0);
-            #endif
+            if (coeff.temperature)
+                addSinusoidalPerturbations(temp,-0.05,6.0);
+            if (coeff.salinity)
+                addSinusoidalPerturbations(salt,-0.05,6.0);
         } else if(modelabel=="yang2021jfm_case5"){// define initial contions of Yang2021JFM's simulation
             addRandomPerturbations(u,1e-3);
-            #ifdef P5
-            addSinusoidalPerturbations(temp,-0.025,8.0);
-            #endif
-            #ifdef P6
-            addSinusoidalPerturbations(salt,-0.025,8.0);
-            #endif
+            if (coeff.temperature)
+                addSinusoidalPerturbations(temp,-0.025,8.0);
+            if (coeff.salinity)
+                addSinusoidalPerturbations(salt,-0.025,8.0);
         } else if (modelabel=="eaves2016jfm"){
             addRandomPerturbations(u,1e-4);
-            #ifdef P5
-            addSinusoidalPerturbations(temp,-0.05,6.0);
-            #endif
-            #ifdef P6
-            addSinusoidalPerturbations(salt,-0.05,6.0);
-            #endif
+            if (coeff.temperature)
+                addSinusoidalPerturbations(temp,-0.05,6.0);
+            if (coeff.salinity)
+                addSinusoidalPerturbations(salt,-0.05,6.0);
         } else{// mormal mode
             addRandomPerturbations(u,1e-3);
-            #ifdef P5
-            addRandomPerturbations(temp,1e-3);
-            #endif
-            #ifdef P6
-            addRandomPerturbations(salt,1e-3);
-            #endif
+            if (coeff.temperature)
+                addRandomPerturbations(temp,1e-3);
+            if (coeff.salinity)
+                addRandomPerturbations(salt,1e-3);
 
             // addSinusoidalPerturbations(u,-0.2,1.0);
             // #ifdef P5
@@ -8,105 +8,155 @@
 #define TUR_STATS_H
 
 #include "channelflow/turbstats.h"
+#include "channelflow/diffops.h"
 #include "channelflow/flowfield.h"
-#include "modules/ddc/macros.h"
-#ifdef P6
-#ifdef SAVESTATS
+#include "modules/ddc/ddcflags.h"
+#include "modules/ddc/dde.h"
 namespace chflow {
+    /** \brief horizontally averaged scalar profiles of the total fields
+     *
+     * addSnapshot evaluates the profiles of the current fields in physical space on buffers that are allocated
+     * once, reduces all of them with a single collective and updates their running time averages. Each snapshot
+     * enters the averages with the time interval it represents, e.g. dT, so unevenly spaced snapshots are
+     * weighted correctly.
+     */
     class DDCTurbStats : public TurbStats {
         public:
-        DDCTurbStats(const int Ny): 
-            temp_m(Ny),
-            salt_m(Ny),
-            temp_grad(Ny),
-            salt_grad(Ny),
-            temp_flux(Ny),
-            salt_flux(Ny) { };
+        // profiles, stored one after the other in the packed vectors below
+        enum Profile {
+            TempMean,  // horizontally averaged profile of temperature [<T>h]
+            SaltMean,  // horizontally averaged profile of salinity [<S>h]
+            TempGrad,  // horizontally averaged profile of temperature gradient [<dT/dy>h]
+            SaltGrad,  // horizontally averaged profile of salinity gradient [<dS/dy>h]
+            TempFlux,  // horizontally averaged profile of temperature's convective flux [<v*T>h]
+            SaltFlux,  // horizontally averaged profile of salinity's convective flux [<v*S>h]
+            NumProfiles
+        };
+
+        DDCTurbStats(const int Ny):
+            Ny_(Ny),
+            nsnapshots_(0),
+            time_(0),
+            profiles_(NumProfiles * Ny, 0.0),
+            average_(NumProfiles * Ny, 0.0) { };
+
         void saveTurbStats(const string& filebase, vector<FlowField>& fieldsn){
             string filename(filebase);
             filename += string(".csv");
             ofstream os(filename.c_str());
             os << setprecision(REAL_DIGITS);
             char s = ',';
-            int Ny = temp_m.length();
             Vector y = fieldsn[0].ygridpts();
-            
-            os  << "ypoints" << s
-                << "temp_m" << s << "salt_m" << s 
-                << "temp_grad" << s << "salt_grad" << s 
-                << "temp_flux" << s << "salt_flux" << '\n' ;
-            for (int ny = 0; ny < Ny; ++ny) {
-                os  << y[ny] << s
-                    << temp_m[ny] << s << salt_m[ny] << s
-                    << temp_grad[ny] << s << salt_grad[ny] << s
-                    << temp_flux[ny] << s << salt_flux[ny] << '\n';
+            const char* names[NumProfiles] = {"temp_m", "salt_m", "temp_grad", "salt_grad", "temp_flux", "salt_flux"};
+
+            // instantaneous profiles of the last snapshot, then their averages over all snapshots
+            os << "ypoints";
+            for (int i = 0; i < NumProfiles; ++i)
+                os << s << names[i];
+            for (int i = 0; i < NumProfiles; ++i)
+                os << s << names[i] << "_tavg";
+            os << '\n';
+            for (int ny = 0; ny < Ny_; ++ny) {
+                os << y[ny];
+                for (int i = 0; i < NumProfiles; ++i)
+                    os << s << profiles_[i * Ny_ + ny];
+                for (int i = 0; i < NumProfiles; ++i)
+                    os << s << average_[i * Ny_ + ny];
+                os << '\n';
             }
         };
-        void addSnapshot(vector<FlowField>& fieldsn, const DDCFlags flags){
-            FlowField u = totalVelocity(fieldsn[0], flags);
-            FlowField t = totalTemperature(fieldsn[1], flags);
-            FlowField dtdy = ydiff(t);
-            FlowField s = totalSalinity(fieldsn[2], flags);
-            FlowField dsdy = ydiff(s);
-            
-            u.makePhysical();
-            t.makePhysical();
-            dtdy.makePhysical();
-            s.makePhysical();
-            dsdy.makePhysical();
+
+        // dt: time interval represented by the snapshot, its weight in the time averages
+        void addSnapshot(vector<FlowField>& fieldsn, const DDCFlags flags, Real dt = 1.0){
+            const FlowField& u = fieldsn[0];
+            const FlowField& t = fieldsn[1];
+            const FlowField& s = fieldsn[2];
+            if (v_.Nd() == 0) {
+                v_ = FlowField(u.Nx(), u.Ny(), u.Nz(), 1, u.Lx(), u.Lz(), u.a(), u.b(), u.cfmpi());
+                t_ = v_;
+                s_ = v_;
+                dtdy_ = v_;
+                dsdy_ = v_;
+            }
+
+            // total fields in the reused buffers: only v enters the fluxes, the base flow sits in the (0,0) mode
+            const std::shared_ptr<const DDCBaseFlow> base = ddcBaseFlow(u.Ny(), u.a(), u.b(), flags);
+            v_.setState(Spectral, Spectral);
+            t_.setState(Spectral, Spectral);
+            s_.setState(Spectral, Spectral);
+            for (lint mx = u.mxlocmin(); mx < u.mxlocmin() + u.Mxloc(); ++mx)
+                for (lint mz = u.mzlocmin(); mz < u.mzlocmin() + u.Mzloc(); ++mz)
+                    for (int ny = 0; ny < u.Ny(); ++ny) {
+                        v_.cmplx(mx, ny, mz, 0) = u.cmplx(mx, ny, mz, 1);
+                        t_.cmplx(mx, ny, mz, 0) = t.cmplx(mx, ny, mz, 0);
+                        s_.cmplx(mx, ny, mz, 0) = s.cmplx(mx, ny, mz, 0);
+                    }
+            if (u.taskid() == u.task_coeff(0, 0)) {
+                v_.cmplx(0, 0, 0, 0) -= Complex(flags.Vsuck, 0.);
+                for (int ny = 0; ny < u.Ny(); ++ny) {
+                    t_.cmplx(0, ny, 0, 0) += Complex(base->T[ny], 0.0);
+                    s_.cmplx(0, ny, 0, 0) += Complex(base->S[ny], 0.0);
+                }
+            }
+            ydiff(t_, dtdy_);
+            ydiff(s_, dsdy_);
+
+            v_.makePhysical();
+            t_.makePhysical();
+            dtdy_.makePhysical();
+            s_.makePhysical();
+            dsdy_.makePhysical();
+
+            // local sums of all rows, reduced at once
             lint Nx = u.Nx();
-            lint Ny = u.Ny();
             lint Nz = u.Nz();
-            lint nxlocmin = u.nxlocmin();
-            lint nxlocmax = u.nxlocmin() + u.Nxloc();
-            lint nylocmin = u.nylocmin();
-            lint nylocmax = u.nylocmax();
-            for (lint ny = 0; ny < Ny; ++ny){
-                Vector sum(6);
-                if (nylocmin <= ny && ny < nylocmax){
-                    for (lint nx = nxlocmin; nx < nxlocmax; ++nx)
-                        for (lint nz = 0; nz < Nz; ++nz) {
-                            sum[0] += t(nx,ny,nz,0);
-                            sum[1] += s(nx,ny,nz,0);
-                            sum[2] += dtdy(nx,ny,nz,0);
-                            sum[3] += dsdy(nx,ny,nz,0);
-                            sum[4] += u(nx,ny,nz,1)*t(nx,ny,nz,0);
-                            sum[5] += u(nx,ny,nz,1)*s(nx,ny,nz,0);
-                        }
-                }
-                // Sum up results from all processes    
-                #ifdef HAVE_MPI
-                Vector tmp(sum) ;
-                MPI_Allreduce(&tmp[0], &sum[0], 1, MPI_DOUBLE, MPI_SUM, *u.comm_world());
-                MPI_Allreduce(&tmp[1], &sum[1], 1, MPI_DOUBLE, MPI_SUM, *u.comm_world());
-                MPI_Allreduce(&tmp[2], &sum[2], 1, MPI_DOUBLE, MPI_SUM, *u.comm_world());
-                MPI_Allreduce(&tmp[3], &sum[3], 1, MPI_DOUBLE, MPI_SUM, *u.comm_world());
-                MPI_Allreduce(&tmp[4], &sum[4], 1, MPI_DOUBLE, MPI_SUM, *u.comm_world());
-                MPI_Allreduce(&tmp[5], &sum[5], 1, MPI_DOUBLE, MPI_SUM, *u.comm_world());
-                #endif
-                temp_m[ny] = sum[0]/(Nx*Nz);
-                salt_m[ny] = sum[1]/(Nx*Nz);
-                temp_grad[ny] = sum[2]/(Nx*Nz);
-                salt_grad[ny] = sum[3]/(Nx*Nz);
-                temp_flux[ny] = sum[4]/(Nx*Nz);
-                salt_flux[ny] = sum[5]/(Nx*Nz);
+            lint nxlocmin = v_.nxlocmin();
+            lint nxlocmax = v_.nxlocmin() + v_.Nxloc();
+            lint nylocmin = v_.nylocmin();
+            lint nylocmax = v_.nylocmax();
+            std::fill(profiles_.begin(), profiles_.end(), 0.0);
+            for (lint ny = nylocmin; ny < nylocmax; ++ny)
+                for (lint nx = nxlocmin; nx < nxlocmax; ++nx)
+                    for (lint nz = 0; nz < Nz; ++nz) {
+                        const Real tn = t_(nx, ny, nz, 0);
+                        const Real sn = s_(nx, ny, nz, 0);
+                        const Real vn = v_(nx, ny, nz, 0);
+                        profiles_[TempMean * Ny_ + ny] += tn;
+                        profiles_[SaltMean * Ny_ + ny] += sn;
+                        profiles_[TempGrad * Ny_ + ny] += dtdy_(nx, ny, nz, 0);
+                        profiles_[SaltGrad * Ny_ + ny] += dsdy_(nx, ny, nz, 0);
+                        profiles_[TempFlux * Ny_ + ny] += vn * tn;
+                        profiles_[SaltFlux * Ny_ + ny] += vn * sn;
+                    }
+            #ifdef HAVE_MPI
+            MPI_Allreduce(MPI_IN_PLACE, profiles_.data(), profiles_.size(), MPI_DOUBLE, MPI_SUM, *u.comm_world());
+            #endif
+
+            // running time average over all snapshots, weighted by their time intervals
+            ++nsnapshots_;
+            time_ += dt;
+            const Real w = dt / time_;
+            for (uint i = 0; i < profiles_.size(); ++i) {
+                profiles_[i] /= Nx * Nz;
+                average_[i] += w * (profiles_[i] - average_[i]);
             }
         };
 
+        // number of snapshots in the time averages and the time interval they cover
+        int numSnapshots() const { return nsnapshots_; }
+        Real averagingTime() const { return time_; }
+
         private:
-        Vector temp_m;// horizontally averaged profile of temperature [<T>h]
-        Vector salt_m;// horizontally averaged profile of salinity [<S>h]
+        int Ny_;
+        int nsnapshots_;
+        Real time_;
+        std::vector<Real> profiles_;  // profiles of the last snapshot, [profile * Ny + ny]
+        std::vector<Real> average_;   // running time averages of the profiles
         // horizontally averaged profile of density [<S-Rrho*T>h/(1-Rrho)]
-
-        Vector temp_grad;// horizontally averaged profile of temperature gradient [<dT/dy>h]
-        Vector salt_grad;// horizontally averaged profile of salinity gradient [<dS/dy>h]
-
-        Vector temp_flux;// horizontally averaged profile of temperature's convective flux [<v*T>h]
-        Vector salt_flux;// horizontally averaged profile of salinity's convective flux [<v*S>h]
-    
         // horizontally averaged profiles of turbulent diffusivity [<v*T>h/<dT/dy>h] and [<v*S>h/<dS/dy>h]
+
+        // physical-space buffers of the total v, T, S and of dT/dy, dS/dy, allocated by the first snapshot
+        FlowField v_, t_, s_, dtdy_, dsdy_;
     };
 }  // namespace chflow
 #endif
-#endif
-#endif
\ No newline at end of file
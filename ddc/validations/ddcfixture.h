@@ -0,0 +1,107 @@
+/**
+ * Common setup of the validations and tests of the DDC module
+ *
+ * The validations and tests evaluate or integrate smooth random perturbations of a sheared, double-diffusively
+ * stratified layer. shearedLayerFlags, ddcTestFields and perturbFields set them up, separateStats gives the
+ * reference values of ddcstats and testResult reports the outcome in the format of the channelflow tests.
+ */
+
+#ifndef DDCFIXTURE_H
+#define DDCFIXTURE_H
+
+#include <iostream>
+#include <vector>
+
+#include "cfbasics/mathdefs.h"
+#include "channelflow/diffops.h"
+#include "channelflow/flowfield.h"
+#include "modules/ddc/ddcdsi.h"
+#include "modules/ddc/ddcflags.h"
+
+namespace chflow {
+
+// geometry of the fields of a validation or test
+struct DDCTestGrid {
+    int Nx;
+    int Ny;
+    int Nz;
+    Real Lx;
+    Real Lz;
+    Real a;
+    Real b;
+};
+
+// Pr 7, Rrho 2, Ra 1e3 and Le, walls moving with -+0.5, T and S are 1 at the lower and 0 at the upper wall
+inline DDCFlags shearedLayerFlags(Real Le) {
+    DDCFlags flags;
+    flags.Pr = 7.0;
+    flags.Rrho = 2.0;
+    flags.Ra = 1e3;
+    flags.Le = Le;
+    flags.uupperwall = 0.5;
+    flags.ulowerwall = -0.5;
+    flags.tupperwall = 0.0;
+    flags.tlowerwall = 1.0;
+    flags.supperwall = 0.0;
+    flags.slowerwall = 1.0;
+    return flags;
+}
+
+// zero fields [u, T, S, p] on grid
+inline std::vector<FlowField> ddcTestFields(const DDCTestGrid& g) {
+    return {FlowField(g.Nx, g.Ny, g.Nz, 3, g.Lx, g.Lz, g.a, g.b), FlowField(g.Nx, g.Ny, g.Nz, 1, g.Lx, g.Lz, g.a, g.b),
+            FlowField(g.Nx, g.Ny, g.Nz, 1, g.Lx, g.Lz, g.a, g.b), FlowField(g.Nx, g.Ny, g.Nz, 1, g.Lx, g.Lz, g.a, g.b)};
+}
+
+// adds smooth random perturbations of the modes |kx|, |kz| <= kmax, of magnitude umag to u and smag to T, S (and p)
+inline void perturbFields(std::vector<FlowField>& fields, int kmax, Real umag, Real smag, bool pressure = false) {
+    fields[0].addPerturbations(kmax, kmax, umag, 0.5);
+    for (uint l = 1; l < fields.size() && l < (pressure ? 4u : 3u); ++l)
+        if (fields[l].Nd() > 0)
+            fields[l].addPerturbations(kmax, kmax, smag, 0.5);
+}
+
+// the columns of ddcstats computed with one channelflow call per quantity, as ddcstats did before
+inline std::vector<Real> separateStats(const FlowField& u, const FlowField& temp, const FlowField& salt,
+                                       const DDCFlags& flags) {
+    FlowField u_tot = totalVelocity(u, flags);
+    FlowField temp_tot = totalTemperature(temp, flags);
+    FlowField salt_tot = totalSalinity(salt, flags);
+
+    std::vector<Real> stats;
+    const Real KE = 0.5 * L2Norm2(u);
+    const Real PE = 0.5 * flags.Ri * L2Norm2(temp);
+    stats.push_back(KE);
+    stats.push_back(PE);
+    stats.push_back(KE + PE);
+    stats.push_back(dissipation(u_tot));
+    stats.push_back(wallshearUpper(u_tot));
+    stats.push_back(wallshear(u_tot));
+    stats.push_back(L2Norm(u));
+    stats.push_back(L2Norm(u_tot));
+    stats.push_back(L2Norm3d(u));
+    stats.push_back(Ecf(u));
+    stats.push_back(getUbulk(u));
+    stats.push_back(getWbulk(u));
+    stats.push_back(L2Norm(temp));
+    stats.push_back(L2Norm(temp_tot));
+    stats.push_back(heatcontent(temp_tot, flags));
+    stats.push_back(L2Norm(salt));
+    stats.push_back(L2Norm(salt_tot));
+    stats.push_back(saltcontent(salt_tot, flags));
+    return stats;
+}
+
+// prints the result like the channelflow tests and returns the exit code
+inline int testResult(bool success) {
+    if (success) {
+        std::cerr << "\t   pass   " << std::endl;
+        return 0;
+    } else {
+        std::cerr << "\t** FAIL **" << std::endl;
+        return 1;
+    }
+}
+
+}  // namespace chflow
+#endif
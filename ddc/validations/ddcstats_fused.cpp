@@ -0,0 +1,51 @@
+/**
+ * Cost of the fused ddcstats against the separate channelflow diagnostics it replaces
+ *
+ * Evaluates ddcstats, which accumulates all quantities in one spectral sweep with one reduction, and the former
+ * sequence of L2Norm, dissipation, wallshear, ... calls on the total fields for a perturbed sheared layer. Both
+ * are timed over repeated evaluations and the speedup is printed. The agreement of the columns is checked by
+ * the test ddc_statsTest.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "cfbasics/mathdefs.h"
+#include "channelflow/flowfield.h"
+#include "modules/ddc/ddcdsi.h"
+#include "modules/ddc/validations/ddcfixture.h"
+using namespace std;
+using namespace chflow;
+
+int main(int argc, char* argv[]) {
+    cfMPI_Init(&argc, &argv);
+    {
+        const DDCTestGrid grid = {64, 65, 64, 2 * pi, pi, -1.0, 1.0};
+        DDCFlags flags = shearedLayerFlags(100.0);
+        flags.ystats = 0.25;
+
+        vector<FlowField> fields = ddcTestFields(grid);
+        perturbFields(fields, 8, 0.1, 0.05);
+        const FlowField& u = fields[0];
+        const FlowField& temp = fields[1];
+        const FlowField& salt = fields[2];
+
+        const int repetitions = 20;
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < repetitions; ++n)
+            ddcstats(u, temp, salt, flags);
+        const Real tfused = std::chrono::duration<Real>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        for (int n = 0; n < repetitions; ++n)
+            separateStats(u, temp, salt, flags);
+        const Real tseparate = std::chrono::duration<Real>(std::chrono::steady_clock::now() - start).count();
+
+        cout << "grid " << grid.Nx << " x " << grid.Ny << " x " << grid.Nz << ", " << repetitions << " evaluations"
+             << endl;
+        cout << "fused    " << tfused / repetitions << " s per evaluation" << endl;
+        cout << "separate " << tseparate / repetitions << " s per evaluation" << endl;
+        cout << "speedup  " << tseparate / tfused << endl;
+    }
+    cfMPI_Finalize();
+}
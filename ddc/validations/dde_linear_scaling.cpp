@@ -0,0 +1,73 @@
+/**
+ * Thread scaling of DDE::linear on a 3d finger-convection grid
+ *
+ * Evaluates the linear operator with 1, 2, 4, ... up to the available OpenMP threads and prints the time per
+ * call and the speedup over one thread. That every thread count reproduces the serial result is checked by the
+ * test ddc_linearThreadsTest.
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "cfbasics/mathdefs.h"
+#include "channelflow/flowfield.h"
+#include "modules/ddc/dde.h"
+#include "modules/ddc/validations/ddcfixture.h"
+using namespace std;
+using namespace chflow;
+
+int main(int argc, char* argv[]) {
+    cfMPI_Init(&argc, &argv);
+    {
+        // grid and parameters of examples/3d_finger_convection
+        const DDCTestGrid grid = {100, 101, 100, 1.0, 1.0, 0.0, 1.0};
+        DDCFlags flags;
+        flags.Pr = 7.0;
+        flags.Rrho = 2.0;
+        flags.Ra = 1e3;
+        flags.Le = 100.0;
+        flags.tlowerwall = 0.0;
+        flags.tupperwall = 1.0;
+        flags.slowerwall = 0.0;
+        flags.supperwall = 1.0;
+
+        vector<FlowField> fields = ddcTestFields(grid);
+        perturbFields(fields, 8, 0.1, 0.05, true);
+
+        DDE dde(fields, flags);
+        vector<FlowField> linf = dde.createRHS(fields);
+        const int calls = 20;
+
+#ifdef _OPENMP
+        const int maxthreads = omp_get_max_threads();
+#else
+        const int maxthreads = 1;
+#endif
+        Real t1 = 0;
+        cout << setw(8) << "threads" << setw(14) << "s per call" << setw(10) << "speedup" << endl;
+        // 1, 2, 4, ... threads and the maximum
+        for (int threads = 1; threads <= maxthreads;
+             threads = (threads == maxthreads) ? maxthreads + 1 : std::min(2 * threads, maxthreads)) {
+#ifdef _OPENMP
+            omp_set_num_threads(threads);
+#endif
+            dde.linear(fields, linf);
+            const auto start = std::chrono::steady_clock::now();
+            for (int n = 0; n < calls; ++n)
+                dde.linear(fields, linf);
+            const Real t = std::chrono::duration<Real>(std::chrono::steady_clock::now() - start).count() / calls;
+            if (threads == 1)
+                t1 = t;
+            cout << setw(8) << threads << setw(14) << t << setw(10) << t1 / t << endl;
+        }
+#ifdef _OPENMP
+        omp_set_num_threads(maxthreads);
+#endif
+    }
+    cfMPI_Finalize();
+}
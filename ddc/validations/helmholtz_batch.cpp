@@ -0,0 +1,97 @@
+/**
+ * Batched Helmholtz solves of the scalar equations against one HelmholtzSolver per Fourier mode
+ *
+ * Sets up the heat equation problems nu u'' - (lambda_t + nu kappa^2) u = f of all modes of a 3d grid, solves
+ * them with the per-mode HelmholtzSolvers DDE used before (real and imaginary part separately) and with one
+ * HelmholtzBatch, checks that the solutions agree and prints the time per solve of all modes and the speedup.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "cfbasics/mathdefs.h"
+#include "channelflow/chebyshev.h"
+#include "channelflow/tausolver.h"
+#include "modules/ddc/helmholtzbatch.h"
+#include "modules/ddc/validations/ddcfixture.h"
+using namespace std;
+using namespace chflow;
+
+int main(int argc, char* argv[]) {
+    // modes of a 128 x 65 x 128 grid after 2/3 dealiasing, heat equation of a Pr = 7 fluid with SBDF3 and dt = 0.01
+    const int Ny = 65;
+    const int Kx = 42;
+    const int Kz = 42;
+    const Real Lx = 2 * pi;
+    const Real Lz = pi;
+    const Real a = -1.0;
+    const Real b = 1.0;
+    const Real nu = 1.0;
+    const Real lambdat = 11.0 / 6.0 / 0.01;
+    const int solves = 20;
+
+    vector<Real> lambda;
+    for (int kx = -Kx; kx <= Kx; ++kx)
+        for (int kz = 0; kz <= Kz; ++kz) {
+            const Real alpha = 2 * pi * kx / Lx;
+            const Real beta = 2 * pi * kz / Lz;
+            lambda.push_back(lambdat + nu * (alpha * alpha + beta * beta));
+        }
+    const int Nmodes = lambda.size();
+
+    // smooth random right-hand sides, indexed [ny*Nmodes + m]
+    vector<Real> fre(Ny * Nmodes), fim(Ny * Nmodes);
+    srand(1);
+    for (int ny = 0; ny < Ny; ++ny)
+        for (int m = 0; m < Nmodes; ++m) {
+            fre[ny * Nmodes + m] = (2.0 * rand() / RAND_MAX - 1) * pow(0.8, ny);
+            fim[ny * Nmodes + m] = (2.0 * rand() / RAND_MAX - 1) * pow(0.8, ny);
+        }
+
+    // per mode: one HelmholtzSolver, real and imaginary part solved one after the other
+    vector<HelmholtzSolver> solvers;
+    for (int m = 0; m < Nmodes; ++m)
+        solvers.push_back(HelmholtzSolver(Ny, a, b, lambda[m], nu));
+    vector<Real> ure(Ny * Nmodes), uim(Ny * Nmodes);
+    ChebyCoeff f(Ny, a, b, Spectral), u(Ny, a, b, Spectral);
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < solves; ++n)
+        for (int m = 0; m < Nmodes; ++m) {
+            for (int ny = 0; ny < Ny; ++ny)
+                f[ny] = fre[ny * Nmodes + m];
+            solvers[m].solve(u, f, 0, 0);
+            for (int ny = 0; ny < Ny; ++ny)
+                ure[ny * Nmodes + m] = u[ny];
+            for (int ny = 0; ny < Ny; ++ny)
+                f[ny] = fim[ny * Nmodes + m];
+            solvers[m].solve(u, f, 0, 0);
+            for (int ny = 0; ny < Ny; ++ny)
+                uim[ny * Nmodes + m] = u[ny];
+        }
+    const Real tmodes = std::chrono::duration<Real>(std::chrono::steady_clock::now() - start).count() / solves;
+
+    const HelmholtzBatch batch(Ny, a, b, nu, lambda);
+    vector<Real> bre(Ny * Nmodes), bim(Ny * Nmodes);
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < solves; ++n)
+        batch.solve(bre.data(), bim.data(), fre.data(), fim.data());
+    const Real tbatch = std::chrono::duration<Real>(std::chrono::steady_clock::now() - start).count() / solves;
+
+    Real maxdiff = 0, maxu = 0;
+    for (int i = 0; i < Ny * Nmodes; ++i) {
+        maxdiff = std::max(maxdiff, std::max(abs(bre[i] - ure[i]), abs(bim[i] - uim[i])));
+        maxu = std::max(maxu, std::max(abs(ure[i]), abs(uim[i])));
+    }
+    const bool success = maxdiff <= 1e-12 * maxu;
+
+    cout << Nmodes << " modes, Ny == " << Ny << endl;
+    cout << "HelmholtzSolver per mode " << setw(12) << tmodes << " s per solve of all modes" << endl;
+    cout << "HelmholtzBatch           " << setw(12) << tbatch << " s per solve of all modes" << endl;
+    cout << "speedup " << tmodes / tbatch << ", max |difference| == " << maxdiff << " (max |u| == " << maxu << ")"
+         << endl;
+    return testResult(success);
+}
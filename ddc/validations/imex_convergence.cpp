@@ -0,0 +1,87 @@
+/**
+ * Temporal convergence order of the IMEX Runge-Kutta schemes of IMEXRungeKuttaDDC
+ *
+ * Integrates a smooth double-diffusive perturbation of a sheared layer over a fixed time with halved time steps
+ * and compares against a run with a much smaller step. The observed orders of u, T and S have to approach the
+ * orders of ARS(4,4,3) and ARS(2,2,2), and the final velocities have to be divergence-free.
+ */
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cfbasics/mathdefs.h"
+#include "channelflow/diffops.h"
+#include "channelflow/flowfield.h"
+#include "channelflow/utilfuncs.h"
+#include "modules/ddc/ddc.h"
+#include "modules/ddc/validations/ddcfixture.h"
+using namespace std;
+using namespace chflow;
+
+// advances fields by T with steps dt of the given scheme
+vector<FlowField> integrate(const vector<FlowField>& fields0, DDCFlags flags, DDCIMEXScheme scheme, Real dt, Real T) {
+    vector<FlowField> fields = fields0;
+    flags.imex = scheme;
+    flags.dt = dt;
+    flags.dtmin = dt;
+    flags.dtmax = dt;
+    flags.verbosity = Silent;
+    DDC ddc(fields, flags);
+    ddc.advance(fields, iround(T / dt));
+    return fields;
+}
+
+int main(int argc, char* argv[]) {
+    cfMPI_Init(&argc, &argv);
+    bool success = true;
+    {
+        const DDCTestGrid grid = {16, 33, 16, 2 * pi, pi, -1.0, 1.0};
+        const DDCFlags flags = shearedLayerFlags(10.0);
+
+        vector<FlowField> fields0 = ddcTestFields(grid);
+        perturbFields(fields0, 3, 0.1, 0.05);
+
+        const Real T = 0.4;
+        const vector<Real> dts = {0.04, 0.02, 0.01, 0.005};
+        const vector<DDCIMEXScheme> schemes = {ARS443, ARS222};
+        const vector<int> orders = {3, 2};
+        const char* names[] = {"u", "T", "S"};
+
+        for (uint s = 0; s < schemes.size(); ++s) {
+            cout << "scheme " << imexscheme2s(schemes[s]) << ", expected order " << orders[s] << endl;
+            const vector<FlowField> ref = integrate(fields0, flags, schemes[s], dts.back() / 16, T);
+
+            vector<vector<Real>> err(3);
+            for (uint k = 0; k < dts.size(); ++k) {
+                const vector<FlowField> fields = integrate(fields0, flags, schemes[s], dts[k], T);
+                cout << "  dt == " << setw(8) << dts[k];
+                for (int l = 0; l < 3; ++l) {
+                    err[l].push_back(L2Dist(fields[l], ref[l]));
+                    cout << "  err(" << names[l] << ") == " << setw(12) << err[l].back();
+                    if (k > 0)
+                        cout << " order " << setw(5) << setprecision(3)
+                             << log(err[l][k - 1] / err[l][k]) / log(dts[k - 1] / dts[k]) << setprecision(6);
+                }
+                cout << "  divNorm(u) == " << divNorm(fields[0]) << endl;
+                if (divNorm(fields[0]) > 1e-8) {
+                    cout << "  u is not divergence-free" << endl;
+                    success = false;
+                }
+            }
+            // the finest refinement decides, the error of S may sit at round-off already
+            const int k = dts.size() - 1;
+            for (int l = 0; l < 3; ++l) {
+                const Real order = log(err[l][k - 1] / err[l][k]) / log(dts[k - 1] / dts[k]);
+                if (err[l][k] > 1e-12 && order < orders[s] - 0.3) {
+                    cout << "  order of " << names[l] << " is " << order << endl;
+                    success = false;
+                }
+            }
+        }
+    }
+    cfMPI_Finalize();
+    return testResult(success);
+}
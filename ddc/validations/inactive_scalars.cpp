@@ -0,0 +1,78 @@
+/**
+ * Newton-Krylov vector size and cost with inactive scalars dropped
+ *
+ * For Couette (no scalar), stratified Couette (temperature only) and sheared DDC (both scalars) the inactive
+ * scalars are carried as empty FlowFields. Compares the length of the vector of field2vector, the memory of the
+ * fields and the time of a field2vector/vector2field round trip with the Krylov operations of one GMRES
+ * iteration (a dot product and an axpy per basis vector) against carrying both scalars as full fields.
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "cfbasics/mathdefs.h"
+#include "channelflow/flowfield.h"
+#include "channelflow/utilfuncs.h"
+#include "modules/ddc/ddc.h"
+#include "modules/ddc/validations/ddcfixture.h"
+using namespace std;
+using namespace chflow;
+
+// seconds per round trip of u, temp, salt through a vector plus nbasis dot products and axpys of its length
+Real roundTrip(FlowField& u, FlowField& temp, FlowField& salt, int nbasis, int& length) {
+    Eigen::VectorXd x;
+    field2vector(u, temp, salt, x);
+    length = x.size();
+    vector<Eigen::VectorXd> basis(nbasis, x);
+    const int repetitions = 10;
+    const auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < repetitions; ++n) {
+        field2vector(u, temp, salt, x);
+        for (int k = 0; k < nbasis; ++k)
+            x -= x.dot(basis[k]) / basis[k].squaredNorm() * basis[k];
+        vector2field(x, u, temp, salt);
+    }
+    return std::chrono::duration<Real>(std::chrono::steady_clock::now() - start).count() / repetitions;
+}
+
+int main(int argc, char* argv[]) {
+    cfMPI_Init(&argc, &argv);
+    {
+        const DDCTestGrid grid = {48, 49, 48, 2 * pi, pi, -1.0, 1.0};
+        const int nbasis = 30;  // Krylov basis vectors touched per iteration
+
+        const vector<DDCSystem> systems = {Couette, StratifiedCouette, ShearedDDC};
+        cout << setw(20) << left << "system" << right << setw(12) << "length" << setw(12) << "full" << setw(10)
+             << "saved" << setw(14) << "MB fields" << setw(14) << "MB full" << setw(12) << "s/iter" << setw(12)
+             << "full s/iter" << endl;
+        for (DDCSystem system : systems) {
+            DDCFlags flags;
+            flags.system = system;
+            const DDCCoefficients coeff = flags.coefficients();
+
+            vector<FlowField> fields = ddcTestFields(grid);
+            perturbFields(fields, 4, 0.1, 0.05);
+            FlowField& u = fields[0];
+            FlowField& tfull = fields[1];
+            FlowField& sfull = fields[2];
+            FlowField temp = coeff.temperature ? tfull : FlowField();
+            FlowField salt = coeff.salinity ? sfull : FlowField();
+
+            int length, fulllength;
+            const Real t = roundTrip(u, temp, salt, nbasis, length);
+            const Real tfullrt = roundTrip(u, tfull, sfull, nbasis, fulllength);
+
+            const Real MB = 8.0 / (1 << 20);
+            const Real fieldpoints = Real(grid.Nx) * grid.Ny * grid.Nz;
+            const Real mb = (3 + coeff.temperature + coeff.salinity) * fieldpoints * MB;
+            const Real mbfull = 5 * fieldpoints * MB;
+            cout << setw(20) << left << ddcsystem2s(system) << right << setw(12) << length << setw(12) << fulllength
+                 << setw(9) << 100.0 * (fulllength - length) / fulllength << "%" << setw(14) << mb << setw(14)
+                 << mbfull << setw(12) << t << setw(12) << tfullrt << endl;
+        }
+    }
+    cfMPI_Finalize();
+}
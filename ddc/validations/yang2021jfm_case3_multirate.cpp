@@ -0,0 +1,110 @@
+/**
+ * Stability and accuracy of the multirate integration on the sheared diffusive convection of
+ * Y Yang, R Verzicco, D Lohse, CP Caulfield. Journal of Fluid Mechanics, 2022 (case 3, see yang2021jfm_case3_2d)
+ *
+ * Starts from the initial condition of yang2021jfm_case3_2d on a coarsened grid and integrates it over a short
+ * time with single-rate IMEX Euler (SBDF1) at the fine and the coarse step and with MultirateDDC for
+ * several substep counts, S or u,T taking the substeps. Every run is compared against an ARS(4,4,3) reference
+ * with a quarter of the fine step. Prints the error of u, T and S, the wall time and whether the run stayed
+ * bounded.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cfbasics/mathdefs.h"
+#include "channelflow/flowfield.h"
+#include "channelflow/utilfuncs.h"
+#include "modules/ddc/ddc.h"
+#include "modules/ddc/addPerturbations.h"
+#include "modules/ddc/validations/ddcfixture.h"
+using namespace std;
+using namespace chflow;
+
+struct Run {
+    string name;
+    vector<FlowField> fields;
+    Real seconds;
+};
+
+// advances fields0 by T with steps of dt, returns the fields and the wall time
+Run integrate(const string& name, const vector<FlowField>& fields0, DDCFlags flags, Real dt, Real T) {
+    Run run = {name, fields0, 0};
+    flags.dt = dt;
+    flags.dtmin = dt;
+    flags.dtmax = dt;
+    flags.verbosity = Silent;
+    const auto start = std::chrono::steady_clock::now();
+    DDC ddc(run.fields, flags);
+    ddc.advance(run.fields, iround(T / dt));
+    run.seconds = std::chrono::duration<Real>(std::chrono::steady_clock::now() - start).count();
+    return run;
+}
+
+int main(int argc, char* argv[]) {
+    cfMPI_Init(&argc, &argv);
+    {
+        // grid of yang2021jfm_case3_2d coarsened by 4 in x and y
+        const DDCTestGrid grid = {96, 97, 6, 2.0, 0.004, 0.0, 1.0};
+
+        DDCFlags flags;
+        flags.Pr = 10.0;
+        flags.Rrho = 2.0;
+        flags.Ra = 1e3;
+        flags.Le = 100.0;
+        flags.uupperwall = 0.5;
+        flags.ulowerwall = -0.5;
+        flags.wupperwall = 0.0;
+        flags.wlowerwall = 0.0;
+        flags.tupperwall = 0.0;
+        flags.tlowerwall = 1.0;
+        flags.supperwall = 0.0;
+        flags.slowerwall = 1.0;
+
+        vector<FlowField> fields0 = ddcTestFields(grid);
+        addRandomPerturbations(fields0[0], 1e-5);
+        addSinusoidalPerturbations(fields0[1], -0.05, 6.0);
+        addSinusoidalPerturbations(fields0[2], -0.05, 6.0);
+
+        const Real dt = 0.005;  // step of yang2021jfm_case3_2d
+        const Real T = 1.0;
+        const vector<int> rates = {2, 4, 8};
+
+        DDCFlags refflags = flags;
+        refflags.imex = ARS443;
+        const Run ref = integrate("reference ars443", fields0, refflags, dt / 4, T);
+
+        DDCFlags sbdf1 = flags;
+        sbdf1.timestepping = SBDF1;
+        vector<Run> runs;
+        runs.push_back(integrate("sbdf1 dt", fields0, sbdf1, dt, T));
+        for (int mr : rates) {
+            runs.push_back(integrate("sbdf1 " + i2s(mr) + "dt", fields0, sbdf1, mr * dt, T));
+            DDCFlags mrflags = flags;
+            mrflags.multirate = mr;
+            mrflags.multirateflow = true;
+            runs.push_back(integrate("multirate u,T dt, S " + i2s(mr) + "dt", fields0, mrflags, mr * dt, T));
+            mrflags.multirateflow = false;
+            runs.push_back(integrate("multirate u,T dt, S dt/" + i2s(mr), fields0, mrflags, dt, T));
+        }
+
+        cout << "reference: ARS(4,4,3) with dt == " << dt / 4 << ", " << ref.seconds << " s" << endl;
+        cout << setw(36) << left << "scheme" << right << setw(14) << "err(u)" << setw(14) << "err(T)" << setw(14)
+             << "err(S)" << setw(10) << "time/s" << "  bounded" << endl;
+        for (const Run& run : runs) {
+            cout << setw(36) << left << run.name << right;
+            bool bounded = true;
+            for (int l = 0; l < 3; ++l) {
+                const Real err = L2Dist(run.fields[l], ref.fields[l]);
+                bounded = bounded && std::isfinite(err) && err < 1e3 * (1 + L2Norm(ref.fields[l]));
+                cout << setw(14) << err;
+            }
+            cout << setw(10) << run.seconds << "  " << (bounded ? "yes" : "no") << endl;
+        }
+    }
+    cfMPI_Finalize();
+}